@@ -0,0 +1,711 @@
+/*
+ * bench.c
+ *
+ * Host microbenchmark for the time log hot path
+ *
+ * Times parseTimelog(), the framer and parser together, the CRC-32 engines
+ * and the GPS to system time conversion over a corpus of time log frames, next to copies of the
+ * original strtok/strtold parser, bitwise CRC and long double conversion.
+ * The corpus is the three test logs from tools.c, synthetic TIMEA and
+ * TIMESYNCA frames and optionally recorded logs given on the command line,
+ * one frame per line. Every operation is timed on its own, so the report
+ * has ns/op, latency percentiles and heap allocations per operation.
+ * Allocations are counted by wrapping malloc, calloc and realloc at link
+ * time (-Wl,--wrap), so only calls from our code and static libraries are
+ * seen.
+ *
+ * Build and run natively with "make bench".
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <fcntl.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Clock.h"
+#include "CRC32.h"
+#include "Framer.h"
+#include "GPSTime.h"
+#include "PPSEdge.h"
+#include "tools.h"
+
+#define BENCHROUNDS 200  // Default passes over the corpus per benchmark
+#define BENCHWARMUP 20   // Untimed passes before each benchmark
+#define CORPUSMAX 256    // Frames in the corpus
+#define SYNTHETIC 64     // Synthetic frames of each type
+#define CRCDIGITS 8      // Hex digits in the CRC after '*'
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// One corpus frame
+struct benchframe
+{
+	char text[TIMELOGMAX + 1];	// NUL terminated frame from '#' to '\r'
+	size_t length;				// Frame length including '\r'
+	int legacy;					// The original parser can take this frame
+	struct gpstime utctime;		// UTC time of the frame
+	long double utcseconds;		// Same in long double GPS seconds
+	struct ppsedge edge;		// PPS edge near the frame time
+};
+
+// Operation on one corpus frame, the result keeps it from being optimized out
+typedef int64_t (*benchop)(const struct benchframe*);
+
+// One benchmark
+struct benchmark
+{
+	const char* name;
+	benchop op;
+	int legacyonly;	// Run only on frames the original parser can take
+};
+
+/****************************************************************
+ * Globals
+ ****************************************************************/
+static struct benchframe corpus[CORPUSMAX];
+static int corpussize;
+static char scratch[TIMELOGMAX + 1];
+static struct framer framer;
+static volatile int64_t sink;
+static unsigned long allocations;
+
+/****************************************************************
+ * Allocation counting
+ ****************************************************************/
+void* __real_malloc(size_t);
+void* __real_calloc(size_t, size_t);
+void* __real_realloc(void*, size_t);
+
+void* __wrap_malloc(size_t size)
+{
+	allocations++;
+	return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size)
+{
+	allocations++;
+	return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size)
+{
+	allocations++;
+	return __real_realloc(ptr, size);
+}
+
+/****************************************************************
+ * Original implementations for comparison
+ ****************************************************************/
+/**
+ * \brief Original bitwise CRC value calculation
+ *
+ * \param i - CRC input value
+ *
+ * \return CRC value
+ *
+ */
+static unsigned long legacyCRC32Value(int i)
+{
+	int j;
+	unsigned long ulCRC;
+	ulCRC = i;
+
+	for (j = 8; j > 0; j--)
+	{
+		if (ulCRC & 1)
+			ulCRC = (ulCRC >> 1) ^ CRC32_POLYNOMIAL;
+		else
+			ulCRC >>= 1;
+	}
+	return ulCRC;
+}
+
+/**
+ * \brief Original block CRC-32
+ *
+ * \param ulCount - Number of bytes in the data block
+ * \param ucBuffer - Data block
+ *
+ * \return CRC-32 value
+ *
+ */
+static unsigned long legacyBlockCRC32(unsigned long ulCount, const unsigned char* ucBuffer)
+{
+	unsigned long ulCRC = 0;
+
+	while (ulCount-- != 0)
+	{
+		unsigned long ulTemp1;
+		unsigned long ulTemp2;
+		ulTemp1 = (ulCRC >> 8) & 0x00FFFFFFL;
+		ulTemp2 = legacyCRC32Value(((int)ulCRC ^ *ucBuffer++) & 0xFF);
+		ulCRC = ulTemp1 ^ ulTemp2;
+	}
+	return ulCRC;
+}
+
+/**
+ * \brief Original strtok/strtold time log parser
+ *
+ * Same steps as the first version in tools.c, with its UTC offset sign.
+ * Only TIMEA shaped frames, strtok returns NULL for shorter data.
+ *
+ * \param logbuffer - Time log string, modified
+ * \param oututcseconds - Return UTC time in seconds
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int legacyParseTimelog(char* logbuffer, long double* oututcseconds)
+{
+	unsigned char ucbuffer[200];
+	unsigned long crcref;
+	unsigned long crccalc;
+	int crclength;
+	const char* clockstatus;
+	int refweeks;
+	long double refseconds;
+	long double offset;
+	long double utcoffset;
+	long double utcseconds;
+	const char* stringtoken;
+	int result = EXIT_SUCCESS;
+
+	stringtoken = strtok(logbuffer, "*");
+	crclength = strlen(stringtoken) - 1;
+	memcpy(ucbuffer, logbuffer + 1, crclength);
+	stringtoken = strtok(NULL, "\r");
+	crcref = strtol(stringtoken, NULL, 16);
+	crccalc = legacyBlockCRC32(crclength, ucbuffer);
+
+	strtok(logbuffer, ",");
+	strtok(NULL, ",");
+	strtok(NULL, ",");
+	strtok(NULL, ",");
+	strtok(NULL, ",");
+	stringtoken = strtok(NULL, ",");
+	refweeks = strtol(stringtoken, NULL, 10);
+	stringtoken = strtok(NULL, ",");
+	refseconds = strtold(stringtoken, NULL);
+	strtok(NULL, ";");
+	clockstatus = strtok(NULL, ",");
+	stringtoken = strtok(NULL, ",");
+	offset = strtold(stringtoken, NULL);
+	strtok(NULL, ",");
+	stringtoken = strtok(NULL, ",");
+	utcoffset = strtold(stringtoken, NULL);
+
+	utcseconds = refseconds - offset - utcoffset;
+	if (refseconds >= 0 && utcseconds < 0)
+	{
+		refweeks--;
+	}
+	*oututcseconds = utcseconds + (long double)refweeks * 604800L;
+
+	if (crcref != crccalc)
+	{
+		printf("CRC32 fail. Reference : 0x%.8X, Calculated : 0x%.8X \r\n", (unsigned int)crcref, (unsigned int)crccalc);
+		result = EXIT_FAILURE;
+	}
+	if (strcmp(clockstatus, "VALID"))
+	{
+		printf("Clock not ready: %s \r\n", clockstatus);
+		result = EXIT_FAILURE;
+	}
+	if (result == EXIT_FAILURE)
+	{
+		fprintf(stderr, "Time log data not valid\r\n");
+	}
+	return result;
+}
+
+/**
+ * \brief Original long double offset calculation
+ *
+ * \param utcseconds - UTC time in GPS seconds
+ * \param edge - PPS edge in CLOCK_REALTIME
+ *
+ * \return System time minus GPS time at the edge in ns
+ *
+ */
+static int64_t legacyOffset(long double utcseconds, const struct ppsedge* edge)
+{
+	struct timespec gpstime;
+	long double frag;
+	long double integr;
+
+	utcseconds += 315964800L;
+	frag = modfl(utcseconds, &integr);
+	gpstime.tv_sec = (long)integr;
+	gpstime.tv_nsec = (long)(frag * GPSTIME_NS);
+	return (int64_t)(edge->stamp.tv_sec - gpstime.tv_sec) * GPSTIME_NS + (edge->stamp.tv_nsec - gpstime.tv_nsec);
+}
+
+/****************************************************************
+ * Operations
+ ****************************************************************/
+static int64_t opLegacyParse(const struct benchframe* frame)
+{
+	long double utcseconds = 0;
+
+	memcpy(scratch, frame->text, frame->length + 1); // strtok modifies the frame
+	return legacyParseTimelog(scratch, &utcseconds) + (int64_t)utcseconds;
+}
+
+static int64_t opParseTimelog(const struct benchframe* frame)
+{
+	struct gpstime utctime = {0};
+
+	memcpy(scratch, frame->text, frame->length + 1); // Same copy as the original
+	return parseTimelog(scratch, &utctime) + utctime.ns;
+}
+
+static int64_t opParseFrame(const struct benchframe* frame)
+{
+	struct timelog log;
+	struct gpstime utctime = {0};
+
+	if (parseTimelogFrame(frame->text, frame->length, &log) == EXIT_FAILURE)
+	{
+		return -1;
+	}
+	return timelogUtcTime(&log, &utctime) + utctime.ns;
+}
+
+static int64_t opFrameParse(const struct benchframe* frame)
+{
+	struct timelog log;
+	struct gpstime utctime = {0};
+	char* text;
+	size_t length;
+
+	// As received: into the ring, framed and parsed with the CRC
+	framerReset(&framer);
+	framerWrite(&framer, (const unsigned char*)frame->text, frame->length);
+	if (!framerNext(&framer, &text, &length) || parseTimelogFrame(text, length, &log) == EXIT_FAILURE)
+	{
+		return -1;
+	}
+	return timelogUtcTime(&log, &utctime) + utctime.ns;
+}
+
+static int64_t opCrcLegacy(const struct benchframe* frame)
+{
+	return legacyBlockCRC32(frame->length - CRCDIGITS - 3, (const unsigned char*)frame->text + 1);
+}
+
+static int64_t opCrcBytewise(const struct benchframe* frame)
+{
+	return crc32Bytewise(0, (const unsigned char*)frame->text + 1, frame->length - CRCDIGITS - 3);
+}
+
+static int64_t opCrcSlice8(const struct benchframe* frame)
+{
+	return crc32Slice8(0, (const unsigned char*)frame->text + 1, frame->length - CRCDIGITS - 3);
+}
+
+static int64_t opCrcSlice16(const struct benchframe* frame)
+{
+	return crc32Slice16(0, (const unsigned char*)frame->text + 1, frame->length - CRCDIGITS - 3);
+}
+
+static int64_t opCrcClmul(const struct benchframe* frame)
+{
+	return crc32Clmul(0, (const unsigned char*)frame->text + 1, frame->length - CRCDIGITS - 3);
+}
+
+static int64_t opCrcBlock(const struct benchframe* frame)
+{
+	return calculateBlockCRC32(frame->length - CRCDIGITS - 3, (unsigned char*)frame->text + 1);
+}
+
+static int64_t opLegacyConvert(const struct benchframe* frame)
+{
+	return legacyOffset(frame->utcseconds, &frame->edge);
+}
+
+static int64_t opConvert(const struct benchframe* frame)
+{
+	int64_t offset = 0;
+
+	gpsSectoSystemTime(&frame->utctime, &frame->edge, &offset);
+	return offset;
+}
+
+static const struct benchmark benchmarks[] =
+{
+	{"parse legacy strtok/strtold", opLegacyParse, 1},
+	{"parse parseTimelog", opParseTimelog, 1},
+	{"parse parseTimelogFrame", opParseFrame, 1},
+	{"parse parseTimelogFrame all", opParseFrame, 0},
+	{"parse framer+parseTimelogFrame", opFrameParse, 0},
+	{"crc legacy bitwise", opCrcLegacy, 0},
+	{"crc bytewise table", opCrcBytewise, 0},
+	{"crc slice-by-8", opCrcSlice8, 0},
+	{"crc slice-by-16", opCrcSlice16, 0},
+	{"crc clmul", opCrcClmul, 0},
+	{"crc calculateBlockCRC32", opCrcBlock, 0},
+	{"convert legacy long double", opLegacyConvert, 0},
+	{"convert gpsSectoSystemTime", opConvert, 0},
+};
+
+/****************************************************************
+ * Corpus
+ ****************************************************************/
+/**
+ * \brief Add a frame to the corpus
+ *
+ * Complete the derived fields: whether the original parser can take it,
+ * its UTC time and a PPS edge 250us after it.
+ *
+ * \param text - Frame from '#', '\r' is added if missing
+ *
+ */
+static void corpusAdd(const char* text)
+{
+	struct benchframe* frame;
+	struct timelog log;
+	const char* data;
+	size_t length = strcspn(text, "\r\n");
+	int commas = 0;
+
+	if (corpussize >= CORPUSMAX || length < CRCDIGITS + 3 || length >= TIMELOGMAX || text[0] != '#')
+	{
+		return;
+	}
+	frame = &corpus[corpussize++];
+	memcpy(frame->text, text, length);
+	frame->text[length] = '\r';
+	frame->text[length + 1] = '\0';
+	frame->length = length + 1;
+
+	data = strchr(frame->text, ';');
+	for (; data != NULL && *data != '*' && *data != '\0'; data++)
+	{
+		commas += (*data == ',');
+	}
+	frame->legacy = (commas >= 3 && strchr(frame->text, '*') != NULL);
+
+	memset(&log, 0, sizeof(log));
+	parseTimelogFrame(frame->text, frame->length, &log);
+	gpsTimeFromWeek(log.week, log.seconds - log.offset + (log.hasutc ? log.utcoffset : -GPSUTCLEAPSECONDS * GPSTIME_NS), &frame->utctime);
+	frame->utcseconds = (long double)frame->utctime.ns / GPSTIME_NS;
+	gpsTimeToTimespec(&frame->utctime, &frame->edge.stamp);
+	frame->edge.stamp.tv_nsec = (frame->edge.stamp.tv_nsec + 250000) % GPSTIME_NS;
+	frame->edge.clock = CLOCK_REALTIME;
+	frame->edge.sequence = corpussize;
+}
+
+/**
+ * \brief Add a synthetic frame with a valid CRC
+ *
+ * \param body - Frame text between '#' and '*'
+ *
+ */
+static void corpusAddBody(const char* body)
+{
+	char text[TIMELOGMAX + 1];
+
+	snprintf(text, sizeof(text), "#%s*%08x\r", body, (unsigned int)crc32Bytewise(0, (const unsigned char*)body, strlen(body)));
+	corpusAdd(text);
+}
+
+/**
+ * \brief Build the corpus
+ *
+ * The test logs from tools.c, then synthetic TIMEA and TIMESYNCA frames
+ * spread over a week with varying offsets.
+ *
+ */
+static void corpusBuild(void)
+{
+	char body[TIMELOGMAX];
+	unsigned long seed = 12345;
+	int week;
+	long ms;
+	int i;
+
+	// Good reference
+	corpusAdd("#TIMEA,USB1,0,50.5,FINESTEERING,2209,515163.000,02000020,9924,16809;VALID,-2.501488425e-09,6.133312031e-10,-17.99999999630,2022,5,13,23,5,45000,VALID*1100ad64\r");
+	// Failed ID, seconds go negative
+	corpusAdd("#TIMEB,USB1,0,50.5,FINESTEERING,2209,1000.000,02000020,9924,16809;VALID,-2.501488425e-09,6.133312031e-10,2000.9999,2022,5,13,23,5,45000,VALID*1100ad64\r");
+	// Clock not valid, seconds roll over
+	corpusAdd("#TIMEA,USB1,0,50.5,FINESTEERING,2209,515163.000,02000020,9924,16809;CONVERGING,-2.501488425e-09,6.133312031e-10,-17.99999999630,2022,5,13,23,5,45000,VALID*1100ad64\r");
+
+	for (i = 0; i < SYNTHETIC; i++)
+	{
+		seed = seed * 1103515245UL + 12345UL;
+		week = 2209 + i / 16;
+		ms = (long)((seed >> 8) % (604800UL * 1000UL)) / 1000 * 1000;
+		snprintf(body, sizeof(body),
+			"TIMEA,COM1,0,50.5,FINESTEERING,%d,%ld.%03ld,02000020,9924,16809;VALID,%.9e,%.9e,-17.99999999630,2022,5,13,23,5,45000,VALID",
+			week, ms / 1000, ms % 1000,
+			((double)(seed % 20001) - 10000.0) * 1e-12, (double)(seed % 997) * 1e-12);
+		corpusAddBody(body);
+		snprintf(body, sizeof(body),
+			"TIMESYNCA,COM1,0,72.0,FINESTEERING,%d,%ld.%03ld,02000000,bbd6,16809;%d,%ld,FINESTEERING",
+			week, ms / 1000, ms % 1000, week, ms);
+		corpusAddBody(body);
+	}
+}
+
+/**
+ * \brief Add recorded frames from a file
+ *
+ * \param path - Text file, one time log per line, other lines ignored
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if the file can't be read
+ *
+ */
+static int corpusLoad(const char* path)
+{
+	char line[TIMELOGMAX + 2];
+	FILE* file;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+	{
+		perror(path);
+		return EXIT_FAILURE;
+	}
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		corpusAdd(line);
+	}
+	fclose(file);
+	return EXIT_SUCCESS;
+}
+
+/****************************************************************
+ * Measurement
+ ****************************************************************/
+static int compareSamples(const void* a, const void* b)
+{
+	int64_t x = *(const int64_t*)a;
+	int64_t y = *(const int64_t*)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * \brief Median cost of reading the clock twice
+ *
+ * \param samples - Sample buffer
+ * \param count - Samples to take
+ *
+ * \return Overhead in ns, subtracted from every sample
+ *
+ */
+static int64_t timerOverhead(int64_t* samples, size_t count)
+{
+	size_t i;
+	int64_t start;
+
+	for (i = 0; i < count; i++)
+	{
+		start = clockMonotonicNs();
+		samples[i] = clockMonotonicNs() - start;
+	}
+	qsort(samples, count, sizeof(samples[0]), compareSamples);
+	return samples[count / 2];
+}
+
+/**
+ * \brief Send stdout and stderr to /dev/null
+ *
+ * \param devnull - Descriptor of /dev/null
+ * \param saved - Return the original descriptors
+ *
+ */
+static void outputOff(int devnull, int saved[2])
+{
+	fflush(stdout);
+	fflush(stderr);
+	saved[0] = dup(STDOUT_FILENO);
+	saved[1] = dup(STDERR_FILENO);
+	dup2(devnull, STDOUT_FILENO);
+	dup2(devnull, STDERR_FILENO);
+}
+
+/**
+ * \brief Restore stdout and stderr
+ *
+ * \param saved - Descriptors from outputOff()
+ *
+ */
+static void outputOn(int saved[2])
+{
+	fflush(stdout);
+	fflush(stderr);
+	dup2(saved[0], STDOUT_FILENO);
+	dup2(saved[1], STDERR_FILENO);
+	close(saved[0]);
+	close(saved[1]);
+}
+
+/**
+ * \brief Run one benchmark and print its line
+ *
+ * Output of the operations goes to /dev/null, failing frames print errors.
+ *
+ * \param bench - Benchmark
+ * \param rounds - Passes over the corpus
+ * \param samples - Sample buffer for rounds * corpus size samples
+ * \param overhead - Timer overhead in ns
+ * \param devnull - Descriptor of /dev/null
+ *
+ */
+static void benchRun(const struct benchmark* bench, int rounds, int64_t* samples, int64_t overhead, int devnull)
+{
+	int saved[2];
+	unsigned long allocs;
+	size_t count = 0;
+	int64_t start, total = 0;
+	int round, i;
+
+	outputOff(devnull, saved);
+	for (round = 0; round < BENCHWARMUP; round++)
+	{
+		for (i = 0; i < corpussize; i++)
+		{
+			if (!bench->legacyonly || corpus[i].legacy)
+			{
+				sink += bench->op(&corpus[i]);
+			}
+		}
+	}
+	allocations = 0;
+	for (round = 0; round < rounds; round++)
+	{
+		for (i = 0; i < corpussize; i++)
+		{
+			if (bench->legacyonly && !corpus[i].legacy)
+			{
+				continue;
+			}
+			start = clockMonotonicNs();
+			sink += bench->op(&corpus[i]);
+			samples[count] = clockMonotonicNs() - start - overhead;
+			if (samples[count] < 0)
+			{
+				samples[count] = 0;
+			}
+			total += samples[count];
+			count++;
+		}
+	}
+	allocs = allocations;
+	outputOn(saved);
+
+	if (count == 0)
+	{
+		printf("%-30s %10s\n", bench->name, "no frames");
+		return;
+	}
+	qsort(samples, count, sizeof(samples[0]), compareSamples);
+	printf("%-30s %8.1f %8lld %8lld %8lld %8lld %9.2f\n", bench->name,
+		(double)total / count,
+		(long long)samples[count / 2],
+		(long long)samples[count * 90 / 100],
+		(long long)samples[count * 99 / 100],
+		(long long)samples[count - 1],
+		(double)allocs / count);
+}
+
+/**
+ * \brief Main
+ *
+ * bench [-n rounds] [recorded.log ...]
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int main(int argc, char* argv[])
+{
+	int64_t* samples;
+	int64_t overhead;
+	int rounds = BENCHROUNDS;
+	int legacy = 0;
+	int devnull;
+	int saved[2];
+	int opt;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "n:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			rounds = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-n rounds] [recorded.log ...]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (rounds < 1)
+	{
+		rounds = 1;
+	}
+
+	devnull = open("/dev/null", O_WRONLY);
+	if (devnull < 0)
+	{
+		perror("/dev/null");
+		return EXIT_FAILURE;
+	}
+
+	crc32Init();
+	for (; optind < argc; optind++)
+	{
+		if (corpusLoad(argv[optind]) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+	}
+	// The test logs print their errors when parsed
+	outputOff(devnull, saved);
+	corpusBuild();
+	outputOn(saved);
+	for (i = 0; i < (size_t)corpussize; i++)
+	{
+		legacy += corpus[i].legacy;
+	}
+
+	samples = malloc(sizeof(samples[0]) * (size_t)rounds * corpussize);
+	if (samples == NULL)
+	{
+		perror("malloc failed:");
+		return EXIT_FAILURE;
+	}
+	overhead = timerOverhead(samples, 10000);
+
+	printf("corpus %d frames (%d TIMEA shaped), %d rounds, CRC engine %s, timer overhead %lld ns subtracted\n",
+		corpussize, legacy, rounds, crc32Engine(), (long long)overhead);
+	printf("%-30s %8s %8s %8s %8s %8s %9s\n", "benchmark", "ns/op", "p50", "p90", "p99", "max", "allocs/op");
+	for (i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+	{
+		if (benchmarks[i].op == opCrcClmul && !crc32HasClmul())
+		{
+			continue;
+		}
+		benchRun(&benchmarks[i], rounds, samples, overhead, devnull);
+	}
+
+	close(devnull);
+	free(samples);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,796 @@
+/*
+ * gpssim.c
+ *
+ * GPS receiver emulator for testing without hardware
+ *
+ * Stands in for the receiver on /dev/ttyS1 and the PPS on P9.23. The
+ * receiver side is a pseudo terminal, PPSTime opens it with -u. The
+ * emulator answers UNLOGALL, COM and LOG commands with "<OK" and sends
+ * TIMESYNCA, TIMEA or TIMEB frames with correct CRCs every second, paced
+ * at the link rate. The PPS is a gpio-sim line: writing its sysfs pull
+ * file makes the kernel time stamp a rising edge, which PPSTime reads with
+ * -s gpiochip.
+ *
+ * The emulated GPS time runs on CLOCK_MONOTONIC_RAW with an optional
+ * offset and frequency error, so it is independent of the clock PPSTime
+ * disciplines. At every edge CLOCK_REALTIME is compared to it, which is
+ * the end-to-end accuracy of the synchronization.
+ *
+ * A link rate mismatch is emulated too. The pty shares its termios with
+ * the master side, so if PPSTime's speed is not the emulated receiver
+ * rate, commands are ignored and output is garbled.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#define _GNU_SOURCE
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "CRC32.h"
+#include "GPSTime.h"
+
+#define SIMBAUD 9600          // Receiver rate at start, factory default
+#define SIMDELAYMS 50         // Default log delay after the edge in ms
+#define SIMPULSEMS 100        // PPS pulse width in ms
+#define SIMSPINNS 2000000LL   // Busy wait the last 2ms before an edge
+#define SIMLEAPSECONDS 18     // GPS - UTC
+#define CMDMAX 128            // Longest command line
+#define FRAMEBUF 512          // Longest frame
+#define WEEKSECONDS 604800LL
+#define UNIXGPSSECONDS 315964800LL
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Requested log
+enum simlog
+{
+	SIMLOG_NONE,
+	SIMLOG_TIMESYNCA,
+	SIMLOG_TIMEA,
+	SIMLOG_TIMEB
+};
+
+// Emulator configuration
+struct simconfig
+{
+	const char* link;	// Symbolic link to the pty slave
+	const char* pull;	// gpio-sim pull file of the PPS line
+	int delayms;		// Log delay after the edge in ms
+	int jitterms;		// Random log delay variation, +- ms
+	int droppct;		// Edges dropped in percent
+	int corruptpct;		// Frames with a broken CRC in percent
+	int64_t offsetns;	// Emulated GPS time ahead of CLOCK_REALTIME at start in ns
+	double ppb;			// Emulated GPS clock rate error against CLOCK_MONOTONIC_RAW in ppb
+	long seconds;		// Seconds to run, 0 = until SIGINT
+	unsigned int seed;	// Random seed
+};
+
+// Emulator state
+struct simstate
+{
+	int master;				// pty master
+	int slave;				// pty slave, kept open so the pty never hangs up
+	int pull;				// gpio-sim pull file, -1 = no PPS
+	int baud;				// Emulated receiver link rate
+	enum simlog log;		// Log requested with ONTIME 1
+	char command[CMDMAX];	// Command being received
+	int commandlength;
+	int64_t baseraw;		// CLOCK_MONOTONIC_RAW at start
+	int64_t baseutc;		// Emulated UTC at start, ns since the Unix epoch
+	unsigned long edges;
+	unsigned long dropped;
+	unsigned long corrupted;
+	unsigned long frames;
+	int64_t errorsum;		// Sum of CLOCK_REALTIME minus emulated time at the edges
+	int64_t errormin;
+	int64_t errormax;
+	unsigned int seed;		// rand_r() state
+};
+
+/****************************************************************
+ * Globals
+ ****************************************************************/
+static volatile sig_atomic_t running = 1;
+
+/**
+ * \brief Stop on SIGINT or SIGTERM
+ *
+ * \param signum - Signal number
+ *
+ */
+static void stopHandler(int signum)
+{
+	(void)signum;
+	running = 0;
+}
+
+/**
+ * \brief Clock in ns
+ *
+ * \param clock - Clock to read
+ *
+ * \return Time in ns
+ *
+ */
+static int64_t clockNs(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return (int64_t)ts.tv_sec * GPSTIME_NS + ts.tv_nsec;
+}
+
+/**
+ * \brief Emulated UTC at a raw clock time
+ *
+ * \param sim - Emulator state
+ * \param config - Configuration
+ * \param raw - CLOCK_MONOTONIC_RAW in ns
+ *
+ * \return Emulated UTC in ns since the Unix epoch
+ *
+ */
+static int64_t simUtc(const struct simstate* sim, const struct simconfig* config, int64_t raw)
+{
+	int64_t elapsed = raw - sim->baseraw;
+
+	return sim->baseutc + elapsed + (int64_t)(elapsed * config->ppb * 1e-9);
+}
+
+/**
+ * \brief Raw clock time of an emulated UTC time
+ *
+ * \param sim - Emulator state
+ * \param config - Configuration
+ * \param utc - Emulated UTC in ns since the Unix epoch
+ *
+ * \return CLOCK_MONOTONIC_RAW in ns
+ *
+ */
+static int64_t simRaw(const struct simstate* sim, const struct simconfig* config, int64_t utc)
+{
+	return sim->baseraw + (int64_t)((utc - sim->baseutc) / (1.0 + config->ppb * 1e-9));
+}
+
+/**
+ * \brief Bps to termios speed
+ *
+ * \param baud - Rate in bps
+ *
+ * \return Speed, B0 if not supported
+ *
+ */
+static speed_t simSpeed(int baud)
+{
+	switch (baud)
+	{
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	case 230400: return B230400;
+	case 460800: return B460800;
+	case 921600: return B921600;
+	default: return B0;
+	}
+}
+
+/**
+ * \brief Check that both ends use the same rate
+ *
+ * \param sim - Emulator state
+ *
+ * \return 1 if the pty speed matches the receiver rate
+ *
+ */
+static int simLinkMatched(const struct simstate* sim)
+{
+	struct termios config;
+
+	if (tcgetattr(sim->master, &config) < 0)
+	{
+		return 1;
+	}
+	return cfgetospeed(&config) == simSpeed(sim->baud);
+}
+
+/**
+ * \brief Write to the pty at the link rate
+ *
+ * One character is 10 bits. Bytes are released as their transmission time
+ * passes, so the last byte arrives when it would on a real UART. If the
+ * rates don't match the bytes are garbled. Bytes nobody reads are dropped.
+ *
+ * \param sim - Emulator state
+ * \param data - Bytes to send
+ * \param length - Number of bytes
+ *
+ */
+static void simSend(struct simstate* sim, const unsigned char* data, size_t length)
+{
+	unsigned char garbled[FRAMEBUF];
+	const unsigned char* out = data;
+	struct timespec pause;
+	int64_t start = clockNs(CLOCK_MONOTONIC_RAW);
+	int64_t bytens = 10 * GPSTIME_NS / sim->baud;
+	size_t sent = 0;
+	size_t due;
+	size_t i;
+
+	if (!simLinkMatched(sim) && length <= sizeof(garbled))
+	{
+		for (i = 0; i < length; i++)
+		{
+			garbled[i] = data[i] ^ 0xA5;
+		}
+		out = garbled;
+	}
+
+	while (sent < length)
+	{
+		due = (size_t)((clockNs(CLOCK_MONOTONIC_RAW) - start) / bytens) + 1;
+		if (due > length)
+		{
+			due = length;
+		}
+		if (due > sent)
+		{
+			if (write(sim->master, out + sent, due - sent) < 0 && errno != EAGAIN)
+			{
+				perror("pty write failed:");
+				return;
+			}
+			sent = due;
+			continue;
+		}
+		pause.tv_sec = 0;
+		pause.tv_nsec = bytens > 1000000 ? 1000000 : bytens;
+		nanosleep(&pause, NULL);
+	}
+}
+
+/**
+ * \brief Send a command response
+ *
+ * \param sim - Emulator state
+ * \param response - Response without line end, e.g. "<OK"
+ *
+ */
+static void simRespond(struct simstate* sim, const char* response)
+{
+	char text[CMDMAX];
+	int length;
+
+	length = snprintf(text, sizeof(text), "%s\r\n[COM1]", response);
+	simSend(sim, (const unsigned char*)text, length);
+}
+
+/**
+ * \brief Execute one command line
+ *
+ * \param sim - Emulator state
+ * \param line - Command without line end
+ *
+ */
+static void simCommand(struct simstate* sim, char* line)
+{
+	char* words[8];
+	char* save;
+	int count = 0;
+	int baud;
+	int i;
+
+	words[0] = strtok_r(line, " ,", &save);
+	while (words[count] != NULL && count < 7)
+	{
+		words[++count] = strtok_r(NULL, " ,", &save);
+	}
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (strcasecmp(words[0], "UNLOGALL") == 0)
+	{
+		sim->log = SIMLOG_NONE;
+		simRespond(sim, "<OK");
+		return;
+	}
+	if (strcasecmp(words[0], "COM") == 0 && count >= 3)
+	{
+		baud = atoi(words[2]);
+		if (simSpeed(baud) == B0)
+		{
+			simRespond(sim, "<ERROR:Invalid baud rate");
+			return;
+		}
+		// Answer at the old rate, then switch
+		simRespond(sim, "<OK");
+		sim->baud = baud;
+		printf("link %d bps\n", baud);
+		return;
+	}
+	if (strcasecmp(words[0], "LOG") == 0)
+	{
+		for (i = 1; i < count; i++)
+		{
+			if (strcasecmp(words[i], "TIMESYNCA") == 0 || strcasecmp(words[i], "TIMESYNC") == 0)
+			{
+				sim->log = SIMLOG_TIMESYNCA;
+			}
+			else if (strcasecmp(words[i], "TIMEA") == 0)
+			{
+				sim->log = SIMLOG_TIMEA;
+			}
+			else if (strcasecmp(words[i], "TIMEB") == 0)
+			{
+				sim->log = SIMLOG_TIMEB;
+			}
+			else
+			{
+				continue;
+			}
+			simRespond(sim, "<OK");
+			printf("log %s\n", words[i]);
+			return;
+		}
+		simRespond(sim, "<ERROR:Invalid Message ID");
+		return;
+	}
+	simRespond(sim, "<ERROR:Invalid Command Name");
+}
+
+/**
+ * \brief Read and execute commands
+ *
+ * \param sim - Emulator state
+ *
+ */
+static void simReceive(struct simstate* sim)
+{
+	unsigned char buffer[256];
+	ssize_t count;
+	ssize_t i;
+	int matched = simLinkMatched(sim);
+
+	while ((count = read(sim->master, buffer, sizeof(buffer))) > 0)
+	{
+		if (!matched)
+		{
+			sim->commandlength = 0; // Framing errors, nothing readable
+			continue;
+		}
+		for (i = 0; i < count; i++)
+		{
+			if (buffer[i] == '\r' || buffer[i] == '\n')
+			{
+				sim->command[sim->commandlength] = '\0';
+				sim->commandlength = 0;
+				simCommand(sim, sim->command);
+			}
+			else if (sim->commandlength < CMDMAX - 1)
+			{
+				sim->command[sim->commandlength++] = buffer[i];
+			}
+		}
+	}
+}
+
+/**
+ * \brief Wait until a raw clock time, executing commands
+ *
+ * Sleep in poll() and spin the last SIMSPINNS for an accurate edge.
+ *
+ * \param sim - Emulator state
+ * \param raw - CLOCK_MONOTONIC_RAW deadline in ns
+ *
+ */
+static void simWait(struct simstate* sim, int64_t raw)
+{
+	struct pollfd pfd;
+	int64_t remaining;
+
+	pfd.fd = sim->master;
+	pfd.events = POLLIN;
+	while (running && (remaining = raw - clockNs(CLOCK_MONOTONIC_RAW)) > 0)
+	{
+		if (remaining <= SIMSPINNS)
+		{
+			continue;
+		}
+		if (poll(&pfd, 1, (int)((remaining - SIMSPINNS) / 1000000) + 1) > 0)
+		{
+			simReceive(sim);
+		}
+	}
+}
+
+/**
+ * \brief Set the PPS line level
+ *
+ * \param sim - Emulator state
+ * \param high - 1 for the rising edge, 0 for the falling edge
+ *
+ */
+static void simPulse(struct simstate* sim, int high)
+{
+	const char* value = high ? "pull-up" : "pull-down";
+
+	if (sim->pull >= 0 && pwrite(sim->pull, value, strlen(value), 0) < 0)
+	{
+		perror("PPS pull write failed:");
+	}
+}
+
+/**
+ * \brief Build the time log for an edge
+ *
+ * \param sim - Emulator state
+ * \param utc - Emulated UTC of the edge, whole seconds, ns since the Unix epoch
+ * \param frame - Return the frame
+ *
+ * \return Frame length
+ *
+ */
+static size_t simFrame(const struct simstate* sim, int64_t utc, unsigned char* frame)
+{
+	char body[FRAMEBUF];
+	time_t unixseconds = (time_t)(utc / GPSTIME_NS);
+	int64_t gps = utc / GPSTIME_NS - UNIXGPSSECONDS + SIMLEAPSECONDS;
+	int week = (int)(gps / WEEKSECONDS);
+	long seconds = (long)(gps % WEEKSECONDS);
+	double offset = 0.0;
+	double utcoffset = -SIMLEAPSECONDS;
+	struct tm date;
+	uint32_t crc;
+	uint32_t value;
+	int length;
+
+	gmtime_r(&unixseconds, &date);
+	switch (sim->log)
+	{
+	case SIMLOG_TIMESYNCA:
+		length = snprintf(body, sizeof(body),
+			"TIMESYNCA,COM1,0,72.0,FINESTEERING,%d,%ld.000,02000000,bbd6,16809;%d,%ld,FINESTEERING",
+			week, seconds, week, seconds * 1000);
+		break;
+	case SIMLOG_TIMEA:
+		length = snprintf(body, sizeof(body),
+			"TIMEA,COM1,0,50.5,FINESTEERING,%d,%ld.000,02000020,9924,16809;VALID,%.9e,6.133312031e-10,%.11f,%d,%d,%d,%d,%d,%d,VALID",
+			week, seconds, offset, utcoffset, date.tm_year + 1900, date.tm_mon + 1, date.tm_mday,
+			date.tm_hour, date.tm_min, date.tm_sec * 1000);
+		break;
+	case SIMLOG_TIMEB:
+		// Little endian host assumed, as on x86 and ARM. Header
+		memset(frame, 0, 28 + 44 + 4);
+		frame[0] = 0xAA;
+		frame[1] = 0x44;
+		frame[2] = 0x12;
+		frame[3] = 28;
+		frame[4] = 101;		// TIMEB
+		frame[8] = 44;		// Message length
+		frame[13] = 180;	// FINESTEERING
+		frame[14] = week & 0xFF;
+		frame[15] = week >> 8;
+		value = (uint32_t)seconds * 1000;
+		memcpy(frame + 16, &value, 4);
+		// Message: clock status VALID, offset, offset std, UTC offset, date
+		memcpy(frame + 28 + 4, &offset, 8);
+		memcpy(frame + 28 + 20, &utcoffset, 8);
+		value = date.tm_year + 1900;
+		memcpy(frame + 28 + 28, &value, 4);
+		frame[28 + 32] = date.tm_mon + 1;
+		frame[28 + 33] = date.tm_mday;
+		frame[28 + 34] = date.tm_hour;
+		frame[28 + 35] = date.tm_min;
+		value = date.tm_sec * 1000;
+		memcpy(frame + 28 + 36, &value, 4);
+		value = 1; // UTC status valid
+		memcpy(frame + 28 + 40, &value, 4);
+		crc = crc32Update(0, frame, 28 + 44);
+		memcpy(frame + 28 + 44, &crc, 4);
+		return 28 + 44 + 4;
+	default:
+		return 0;
+	}
+	crc = crc32Update(0, (const unsigned char*)body, length);
+	return snprintf((char*)frame, FRAMEBUF, "#%s*%08x\r\n", body, (unsigned int)crc);
+}
+
+/**
+ * \brief Emulate one second
+ *
+ * Rising edge at the next whole emulated second, then the time log after
+ * the delay and the falling edge after the pulse width.
+ *
+ * \param sim - Emulator state
+ * \param config - Configuration
+ *
+ */
+static void simSecond(struct simstate* sim, const struct simconfig* config)
+{
+	unsigned char frame[FRAMEBUF];
+	size_t length;
+	int64_t edge, edgeraw, raw, realtime, error, late;
+	int64_t delayns;
+	int drop, corrupt;
+
+	// Next whole second of emulated UTC
+	edge = (simUtc(sim, config, clockNs(CLOCK_MONOTONIC_RAW)) / GPSTIME_NS + 1) * GPSTIME_NS;
+	edgeraw = simRaw(sim, config, edge);
+	drop = (int)(rand_r(&sim->seed) % 100) < config->droppct;
+	corrupt = (int)(rand_r(&sim->seed) % 100) < config->corruptpct;
+	delayns = (int64_t)config->delayms * 1000000;
+	if (config->jitterms > 0)
+	{
+		delayns += ((int64_t)(rand_r(&sim->seed) % (2 * config->jitterms * 1000 + 1)) - config->jitterms * 1000) * 1000;
+	}
+	if (delayns < 0)
+	{
+		delayns = 0;
+	}
+
+	simWait(sim, edgeraw);
+	if (!running)
+	{
+		return;
+	}
+	raw = clockNs(CLOCK_MONOTONIC_RAW);
+	realtime = clockNs(CLOCK_REALTIME);
+	if (!drop)
+	{
+		simPulse(sim, 1);
+	}
+	late = clockNs(CLOCK_MONOTONIC_RAW) - edgeraw;
+
+	// Host clock against emulated time at the edge
+	error = realtime - simUtc(sim, config, raw);
+	sim->edges++;
+	sim->errorsum += error;
+	if (sim->edges == 1 || error < sim->errormin)
+	{
+		sim->errormin = error;
+	}
+	if (sim->edges == 1 || error > sim->errormax)
+	{
+		sim->errormax = error;
+	}
+
+	if (delayns >= SIMPULSEMS * 1000000LL)
+	{
+		simWait(sim, edgeraw + SIMPULSEMS * 1000000LL);
+		simPulse(sim, 0);
+	}
+	simWait(sim, edgeraw + delayns);
+	length = simFrame(sim, edge, frame);
+	if (length > 0)
+	{
+		if (corrupt)
+		{
+			frame[length / 2] ^= 0x01;
+			sim->corrupted++;
+		}
+		simSend(sim, frame, length);
+		sim->frames++;
+	}
+	if (delayns < SIMPULSEMS * 1000000LL)
+	{
+		simWait(sim, edgeraw + SIMPULSEMS * 1000000LL);
+		simPulse(sim, 0);
+	}
+	sim->dropped += drop;
+
+	printf("%lld edge %s late %6lld ns log %s done %7.3f ms clock %+12lld ns\n",
+		(long long)(edge / GPSTIME_NS),
+		drop ? "dropped" : (sim->pull < 0 ? "no pps " : "sent   "),
+		(long long)late,
+		length == 0 ? "none     " : (corrupt ? "corrupted" : "sent     "),
+		(clockNs(CLOCK_MONOTONIC_RAW) - edgeraw) / 1e6,
+		(long long)error);
+	fflush(stdout);
+}
+
+/**
+ * \brief Open the pty
+ *
+ * \param sim - Emulator state
+ * \param config - Configuration
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int simOpen(struct simstate* sim, const struct simconfig* config)
+{
+	struct termios raw;
+	struct stat info;
+	const char* name;
+
+	sim->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (sim->master < 0 || grantpt(sim->master) < 0 || unlockpt(sim->master) < 0)
+	{
+		perror("pty failed:");
+		return EXIT_FAILURE;
+	}
+	name = ptsname(sim->master);
+	sim->slave = open(name, O_RDWR | O_NOCTTY);
+	if (sim->slave < 0)
+	{
+		perror(name);
+		return EXIT_FAILURE;
+	}
+	tcgetattr(sim->slave, &raw);
+	cfmakeraw(&raw);
+	cfsetspeed(&raw, simSpeed(sim->baud));
+	tcsetattr(sim->slave, TCSANOW, &raw);
+
+	if (config->link != NULL)
+	{
+		if (lstat(config->link, &info) == 0 && S_ISLNK(info.st_mode))
+		{
+			unlink(config->link);
+		}
+		if (symlink(name, config->link) < 0)
+		{
+			perror(config->link);
+			return EXIT_FAILURE;
+		}
+	}
+	printf("receiver on %s%s%s\n", name, config->link ? " -> " : "", config->link ? config->link : "");
+
+	sim->pull = -1;
+	if (config->pull != NULL)
+	{
+		sim->pull = open(config->pull, O_WRONLY);
+		if (sim->pull < 0)
+		{
+			perror(config->pull);
+			return EXIT_FAILURE;
+		}
+		simPulse(sim, 0);
+	}
+	else
+	{
+		printf("no PPS, give the gpio-sim pull file with -p\n");
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Print usage
+ *
+ * \param name - Program name
+ *
+ */
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"Usage: %s [-l link] [-p pull] [-d ms] [-j ms] [-D percent] [-C percent] [-o ms] [-f ppb] [-n seconds] [-r seed]\n"
+		"  -l  Symbolic link to the receiver pty, e.g. /tmp/ttyGPS for PPSTime -u /tmp/ttyGPS\n"
+		"  -p  gpio-sim pull file of the PPS line, e.g. /sys/devices/platform/gpio-sim.0/gpiochip2/sim_gpio0/pull\n"
+		"  -d  Log delay after the edge (default %d ms)\n"
+		"  -j  Log delay jitter, +- ms (default 0)\n"
+		"  -D  Dropped edges in percent (default 0)\n"
+		"  -C  Frames with a broken CRC in percent (default 0)\n"
+		"  -o  Emulated GPS time ahead of the host clock at start (default 0 ms)\n"
+		"  -f  Emulated GPS clock rate error (default 0 ppb)\n"
+		"  -n  Seconds to run (default 0 = until SIGINT)\n"
+		"  -r  Random seed\n"
+		"The receiver starts at %d bps and answers UNLOGALL, COM and LOG TIMESYNCA|TIMEA|TIMEB ONTIME 1\n",
+		name, SIMDELAYMS, SIMBAUD);
+}
+
+/**
+ * \brief Main
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int main(int argc, char* argv[])
+{
+	struct simconfig config;
+	struct simstate sim;
+	struct sigaction action;
+	int opt;
+
+	memset(&config, 0, sizeof(config));
+	config.delayms = SIMDELAYMS;
+	config.seed = (unsigned int)time(NULL);
+	memset(&sim, 0, sizeof(sim));
+	sim.baud = SIMBAUD;
+
+	while ((opt = getopt(argc, argv, "l:p:d:j:D:C:o:f:n:r:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'l':
+			config.link = optarg;
+			break;
+		case 'p':
+			config.pull = optarg;
+			break;
+		case 'd':
+			config.delayms = atoi(optarg);
+			break;
+		case 'j':
+			config.jitterms = atoi(optarg);
+			break;
+		case 'D':
+			config.droppct = atoi(optarg);
+			break;
+		case 'C':
+			config.corruptpct = atoi(optarg);
+			break;
+		case 'o':
+			config.offsetns = (int64_t)(strtod(optarg, NULL) * 1e6);
+			break;
+		case 'f':
+			config.ppb = strtod(optarg, NULL);
+			break;
+		case 'n':
+			config.seconds = atol(optarg);
+			break;
+		case 'r':
+			config.seed = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stopHandler;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	sim.seed = config.seed;
+	crc32Init();
+	if (simOpen(&sim, &config) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+	sim.baseraw = clockNs(CLOCK_MONOTONIC_RAW);
+	sim.baseutc = clockNs(CLOCK_REALTIME) + config.offsetns;
+
+	while (running && (config.seconds == 0 || (long)sim.edges < config.seconds))
+	{
+		simSecond(&sim, &config);
+	}
+
+	if (sim.edges > 0)
+	{
+		printf("%lu edges, %lu dropped, %lu frames, %lu corrupted, clock error mean %+lld min %+lld max %+lld ns\n",
+			sim.edges, sim.dropped, sim.frames, sim.corrupted,
+			(long long)(sim.errorsum / (int64_t)sim.edges), (long long)sim.errormin, (long long)sim.errormax);
+	}
+	if (config.link != NULL)
+	{
+		unlink(config.link);
+	}
+	if (sim.pull >= 0)
+	{
+		close(sim.pull);
+	}
+	close(sim.slave);
+	close(sim.master);
+	return EXIT_SUCCESS;
+}
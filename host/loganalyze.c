@@ -0,0 +1,727 @@
+/*
+ * loganalyze.c
+ *
+ * Bulk analyzer for archived receiver logs
+ *
+ * Checks raw receiver log files offline: frame CRCs, clock status, gaps
+ * and the trend of the receiver clock offset. Each file is mapped and cut
+ * into one chunk per worker thread. A worker owns the frames that start
+ * in its chunk and may read past its end to finish the last one, so no
+ * frame is lost or counted twice at a cut. Frame starts ('#' and the
+ * binary sync byte 0xAA) and ASCII frame ends ('\r') are found 16 bytes
+ * at a time with SSE2 compares on x86, byte by byte elsewhere. The CRC
+ * goes through the fastest CRC-32 engine and only frames that pass are
+ * parsed. The workers keep their own statistics, which are merged in
+ * file order when all are done, so the gap between two chunks is seen
+ * too. A chunk may start inside a binary frame whose payload looks like
+ * a frame start, so errors before the first valid frame of a chunk are
+ * not counted.
+ *
+ * Build natively with "make loganalyze". Usage: loganalyze [-j threads]
+ * [-g seconds] file...
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define ANALYZE_SSE2
+#endif
+
+#include "CRC32.h"
+#include "GPSTime.h"
+#include "tools.h"
+
+#define WORKERMAX 64            // Worker threads at most
+#define CHUNKMIN (1024 * 1024)  // Smallest chunk worth a thread in bytes
+#define GAPSECONDS 1.5          // Default interval counted as a gap in s
+#define CRCDIGITS 8             // Hex digits in the CRC after '*'
+#define BINSYNC1 0xAA           // Binary log sync bytes
+#define BINSYNC2 0x44
+#define BINSYNC3 0x12
+#define BINHEADERMIN 28         // Binary header length
+#define BINCRCSIZE 4            // Binary CRC length
+#define BINTIMEID 101           // TIMEB message id
+#define BINTIMESYNCID 492       // TIMESYNCB message id
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Statistics of a chunk, or of a whole file after merging
+struct analyzestats
+{
+	unsigned long frames;			// Frames with a valid CRC
+	unsigned long crcerrors;		// Frames with a wrong CRC
+	unsigned long truncated;		// Frames cut off by the next frame or the end of the file
+	unsigned long malformed;		// Time logs with a valid CRC the parser refused
+	unsigned long other;			// Valid frames of other messages
+	unsigned long ids[TIMELOG_TIMESYNCB + 1];	// Time logs by message
+	unsigned long clock[CLOCKSTATUS_INVALID + 1];	// Time logs by clock status
+	int64_t first;					// GPS time of the first time log in ns, 0 = none
+	int64_t last;					// GPS time of the last time log in ns
+	unsigned long gaps;				// Intervals longer than the gap limit
+	int64_t missing;				// Time in gaps beyond one log interval in ns
+	int64_t longest;				// Longest interval in ns
+	unsigned long backwards;		// Time logs not after the one before
+	unsigned long offsets;			// Time logs with a receiver clock offset
+	double sumt;					// Offset fit sums, t in s since first, o in ns
+	double sumo;
+	double sumtt;
+	double sumto;
+	double sumoo;
+	int64_t minoffset;				// Smallest receiver clock offset in ns
+	int64_t maxoffset;				// Largest receiver clock offset in ns
+};
+
+// One worker and its chunk
+struct analyzeworker
+{
+	pthread_t thread;
+	int started;				// The thread was created and must be joined
+	const unsigned char* map;	// Whole file
+	size_t size;				// File size
+	size_t start;				// Chunk, frames starting at start up to end
+	size_t end;
+	int64_t gap;				// Gap limit in ns
+	struct analyzestats stats;
+};
+
+#ifdef ANALYZE_SSE2
+/**
+ * \brief Find the first of two bytes
+ *
+ * \param p - Start
+ * \param end - One past the last byte
+ * \param a - Byte to find
+ * \param b - Other byte to find
+ *
+ * \return Pointer to the first match, end if none
+ *
+ */
+__attribute__((target("sse2")))
+static const unsigned char* scanTwo(const unsigned char* p, const unsigned char* end, unsigned char a, unsigned char b)
+{
+	const __m128i va = _mm_set1_epi8((char)a);
+	const __m128i vb = _mm_set1_epi8((char)b);
+	__m128i block;
+	int mask;
+
+	while (end - p >= 16)
+	{
+		block = _mm_loadu_si128((const __m128i*)p);
+		mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, va), _mm_cmpeq_epi8(block, vb)));
+		if (mask != 0)
+		{
+			return p + __builtin_ctz(mask);
+		}
+		p += 16;
+	}
+	while (p < end && *p != a && *p != b)
+	{
+		p++;
+	}
+	return p;
+}
+#else
+/**
+ * \brief Find the first of two bytes
+ *
+ * \param p - Start
+ * \param end - One past the last byte
+ * \param a - Byte to find
+ * \param b - Other byte to find
+ *
+ * \return Pointer to the first match, end if none
+ *
+ */
+static const unsigned char* scanTwo(const unsigned char* p, const unsigned char* end, unsigned char a, unsigned char b)
+{
+	while (p < end && *p != a && *p != b)
+	{
+		p++;
+	}
+	return p;
+}
+#endif
+
+/**
+ * \brief Hex digit value
+ *
+ * \param c - Character
+ *
+ * \return Value 0-15 or -1 if not a hex digit
+ *
+ */
+static int hexValue(unsigned char c)
+{
+	if (c >= '0' && c <= '9')
+	{
+		return c - '0';
+	}
+	c |= 0x20; // Lower case
+	if (c >= 'a' && c <= 'f')
+	{
+		return c - 'a' + 10;
+	}
+	return -1;
+}
+
+/**
+ * \brief Check an ASCII frame
+ *
+ * \param frame - Frame from '#' to '\r'
+ * \param length - Frame length
+ *
+ * \return 1 if the CRC matches, 0 otherwise
+ *
+ */
+static int asciiValid(const unsigned char* frame, size_t length)
+{
+	uint32_t crcref = 0;
+	size_t i;
+	int digit;
+
+	// "*xxxxxxxx\r" ends the frame
+	if (length < CRCDIGITS + 3 || frame[length - CRCDIGITS - 2] != '*')
+	{
+		return 0;
+	}
+	for (i = length - 1 - CRCDIGITS; i < length - 1; i++)
+	{
+		digit = hexValue(frame[i]);
+		if (digit < 0)
+		{
+			return 0;
+		}
+		crcref = (crcref << 4) | digit;
+	}
+	// CRC covers everything between '#' and '*'
+	return crcref == crc32Update(0, frame + 1, length - CRCDIGITS - 3);
+}
+
+/**
+ * \brief Is the ASCII frame a time log
+ *
+ * \param frame - Frame from '#'
+ * \param length - Frame length
+ *
+ * \return 1 for TIMEA and TIMESYNCA, 0 otherwise
+ *
+ */
+static int asciiTimelog(const unsigned char* frame, size_t length)
+{
+	return (length > 6 && memcmp(frame, "#TIMEA,", 7) == 0) ||
+		(length > 10 && memcmp(frame, "#TIMESYNCA,", 11) == 0);
+}
+
+/**
+ * \brief Account a parsed time log
+ *
+ * \param worker - Worker
+ * \param log - Time log
+ * \param previous - GPS time of the previous time log in ns, 0 = none
+ *
+ */
+static void analyzeTimelog(struct analyzeworker* worker, const struct timelog* log, int64_t* previous)
+{
+	struct analyzestats* stats = &worker->stats;
+	struct gpstime reference;
+	int64_t interval;
+	double t;
+	double o;
+
+	stats->ids[log->id]++;
+	stats->clock[log->clock]++;
+
+	// Receiver time, leap seconds do not make gaps
+	gpsTimeFromWeek(log->week, log->seconds, &reference);
+	if (stats->first == 0)
+	{
+		stats->first = reference.ns;
+	}
+	else
+	{
+		interval = reference.ns - *previous;
+		if (interval <= 0)
+		{
+			stats->backwards++;
+		}
+		else if (interval > worker->gap)
+		{
+			stats->gaps++;
+			stats->missing += interval - GPSTIME_NS;
+		}
+		if (interval > stats->longest)
+		{
+			stats->longest = interval;
+		}
+	}
+	*previous = reference.ns;
+	stats->last = reference.ns;
+
+	if (log->id != TIMELOG_TIMEA && log->id != TIMELOG_TIMEB)
+	{
+		return;
+	}
+	if (stats->offsets == 0 || log->offset < stats->minoffset)
+	{
+		stats->minoffset = log->offset;
+	}
+	if (stats->offsets == 0 || log->offset > stats->maxoffset)
+	{
+		stats->maxoffset = log->offset;
+	}
+	stats->offsets++;
+	t = (double)(reference.ns - stats->first) / GPSTIME_NS;
+	o = (double)log->offset;
+	stats->sumt += t;
+	stats->sumo += o;
+	stats->sumtt += t * t;
+	stats->sumto += t * o;
+	stats->sumoo += o * o;
+}
+
+/**
+ * \brief Worker thread
+ *
+ * Scan the chunk for frame starts, check and parse the frames.
+ *
+ * \param arg - Worker
+ *
+ * \return NULL
+ *
+ */
+static void* analyzeThread(void* arg)
+{
+	struct analyzeworker* worker = arg;
+	struct analyzestats* stats = &worker->stats;
+	const unsigned char* file = worker->map + worker->size;
+	const unsigned char* chunk = worker->map + worker->end;
+	const unsigned char* p = worker->map + worker->start;
+	const unsigned char* limit;
+	const unsigned char* q;
+	struct timelog log;
+	int64_t previous = 0;
+	size_t length;
+	unsigned int id;
+	int synced = (worker->start == 0);
+
+	memset(stats, 0, sizeof(*stats));
+	while ((p = scanTwo(p, chunk, '#', BINSYNC1)) < chunk)
+	{
+		if (*p == '#')
+		{
+			// Frame ends at '\r', a '#' first means it was cut off
+			limit = (file - p > TIMELOGMAX) ? p + TIMELOGMAX : file;
+			q = scanTwo(p + 1, limit, '\r', '#');
+			if (q == limit || *q == '#')
+			{
+				stats->truncated += synced;
+				p = q;
+				continue;
+			}
+			length = q - p + 1;
+			if (!asciiValid(p, length))
+			{
+				stats->crcerrors += synced;
+				p++;
+				continue;
+			}
+			synced = 1;
+			stats->frames++;
+			if (!asciiTimelog(p, length))
+			{
+				stats->other++;
+			}
+			else if (parseTimelogFrame((const char*)p, length, &log) == EXIT_FAILURE)
+			{
+				stats->malformed++;
+			}
+			else
+			{
+				analyzeTimelog(worker, &log, &previous);
+			}
+			p = q + 1;
+			continue;
+		}
+
+		// Binary frame, the sync byte may also be payload
+		if (file - p < BINHEADERMIN || p[1] != BINSYNC2 || p[2] != BINSYNC3 || p[3] < BINHEADERMIN)
+		{
+			p++;
+			continue;
+		}
+		length = p[3] + (p[8] | (p[9] << 8)) + BINCRCSIZE;
+		if ((size_t)(file - p) < length)
+		{
+			stats->truncated++;
+			break;
+		}
+		q = p + length - BINCRCSIZE;
+		if ((q[0] | (q[1] << 8) | (q[2] << 16) | ((uint32_t)q[3] << 24)) != crc32Update(0, p, length - BINCRCSIZE))
+		{
+			stats->crcerrors += synced;
+			p++;
+			continue;
+		}
+		synced = 1;
+		stats->frames++;
+		id = p[4] | (p[5] << 8);
+		if ((id != BINTIMEID && id != BINTIMESYNCID) || length > TIMELOGMAX)
+		{
+			stats->other++;
+		}
+		else if (parseTimelogFrame((const char*)p, length, &log) == EXIT_FAILURE)
+		{
+			stats->malformed++;
+		}
+		else
+		{
+			analyzeTimelog(worker, &log, &previous);
+		}
+		p += length;
+	}
+	return NULL;
+}
+
+/**
+ * \brief Add the statistics of the next chunk
+ *
+ * \param total - Statistics of the chunks before
+ * \param next - Statistics of the next chunk
+ * \param gap - Gap limit in ns
+ *
+ */
+static void analyzeMerge(struct analyzestats* total, const struct analyzestats* next, int64_t gap)
+{
+	int64_t interval;
+	double shift;
+	int i;
+
+	total->frames += next->frames;
+	total->crcerrors += next->crcerrors;
+	total->truncated += next->truncated;
+	total->malformed += next->malformed;
+	total->other += next->other;
+	for (i = 0; i <= TIMELOG_TIMESYNCB; i++)
+	{
+		total->ids[i] += next->ids[i];
+	}
+	for (i = 0; i <= CLOCKSTATUS_INVALID; i++)
+	{
+		total->clock[i] += next->clock[i];
+	}
+	if (next->first == 0)
+	{
+		return;
+	}
+	if (total->first == 0)
+	{
+		total->first = next->first;
+	}
+	else
+	{
+		// The interval across the cut
+		interval = next->first - total->last;
+		if (interval <= 0)
+		{
+			total->backwards++;
+		}
+		else if (interval > gap)
+		{
+			total->gaps++;
+			total->missing += interval - GPSTIME_NS;
+		}
+		if (interval > total->longest)
+		{
+			total->longest = interval;
+		}
+	}
+	total->last = next->last;
+	total->gaps += next->gaps;
+	total->missing += next->missing;
+	total->backwards += next->backwards;
+	if (next->longest > total->longest)
+	{
+		total->longest = next->longest;
+	}
+
+	if (next->offsets == 0)
+	{
+		return;
+	}
+	if (total->offsets == 0 || next->minoffset < total->minoffset)
+	{
+		total->minoffset = next->minoffset;
+	}
+	if (total->offsets == 0 || next->maxoffset > total->maxoffset)
+	{
+		total->maxoffset = next->maxoffset;
+	}
+	// Move the sums of the chunk to the time origin of the total
+	shift = (double)(next->first - total->first) / GPSTIME_NS;
+	total->sumtt += next->sumtt + 2.0 * shift * next->sumt + next->offsets * shift * shift;
+	total->sumto += next->sumto + shift * next->sumo;
+	total->sumt += next->sumt + next->offsets * shift;
+	total->sumo += next->sumo;
+	total->sumoo += next->sumoo;
+	total->offsets += next->offsets;
+}
+
+/**
+ * \brief Print the statistics of a file or of all files
+ *
+ * \param name - File name
+ * \param stats - Merged statistics
+ * \param bytes - Bytes analyzed
+ * \param seconds - Wall time taken
+ *
+ */
+static void analyzeReport(const char* name, const struct analyzestats* stats, size_t bytes, double seconds)
+{
+	static const char* const ids[] = { "unknown", "TIMEA", "TIMESYNCA", "TIMEB", "TIMESYNCB" };
+	static const char* const clocks[] = { "valid", "converging", "iterating", "invalid" };
+	struct gpstime time;
+	double n = (double)stats->offsets;
+	double spread;
+	double slope = 0.0;
+	double mean;
+	double deviation;
+	int64_t seconds0;
+	int week;
+	int i;
+
+	printf("%s: %.1f MB in %.3f s, %.2f GB/s\n", name, bytes / 1e6, seconds, seconds > 0.0 ? bytes / seconds / 1e9 : 0.0);
+	printf("  frames %lu  crc errors %lu  truncated %lu  malformed %lu  other messages %lu\n",
+		stats->frames, stats->crcerrors, stats->truncated, stats->malformed, stats->other);
+	printf("  logs");
+	for (i = TIMELOG_TIMEA; i <= TIMELOG_TIMESYNCB; i++)
+	{
+		printf("  %s %lu", ids[i], stats->ids[i]);
+	}
+	printf("\n  clock");
+	for (i = 0; i <= CLOCKSTATUS_INVALID; i++)
+	{
+		printf("  %s %lu", clocks[i], stats->clock[i]);
+	}
+	printf("\n");
+	if (stats->first == 0)
+	{
+		return;
+	}
+
+	time.ns = stats->first;
+	gpsTimeToWeek(&time, &week, &seconds0);
+	printf("  span %.0f s from GPS week %d %.0f s\n", (double)(stats->last - stats->first) / GPSTIME_NS,
+		week, (double)seconds0 / GPSTIME_NS);
+	printf("  gaps %lu  missing %.0f s  longest interval %.3f s  backwards %lu\n",
+		stats->gaps, (double)stats->missing / GPSTIME_NS, (double)stats->longest / GPSTIME_NS, stats->backwards);
+	if (stats->offsets == 0)
+	{
+		return;
+	}
+	mean = stats->sumo / n;
+	deviation = stats->sumoo / n - mean * mean;
+	deviation = deviation > 0.0 ? sqrt(deviation) : 0.0;
+	spread = n * stats->sumtt - stats->sumt * stats->sumt;
+	if (spread > 0.0)
+	{
+		slope = (n * stats->sumto - stats->sumt * stats->sumo) / spread;
+	}
+	printf("  receiver clock offset  mean %.1f ns  sd %.1f ns  min %lld ns  max %lld ns  trend %+.3f ns/day\n",
+		mean, deviation, (long long)stats->minoffset, (long long)stats->maxoffset, slope * 86400.0);
+}
+
+/**
+ * \brief Analyze one file
+ *
+ * \param path - Log file
+ * \param workers - Worker threads
+ * \param gap - Gap limit in ns
+ * \param total - Statistics of all files, the file is merged in
+ * \param bytes - Bytes of all files, the file size is added
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int analyzeFile(const char* path, int workers, int64_t gap, struct analyzestats* total, size_t* bytes)
+{
+	static struct analyzeworker worker[WORKERMAX];
+	struct analyzestats stats;
+	struct timespec start;
+	struct timespec end;
+	struct stat info;
+	const unsigned char* map;
+	int count;
+	int fd;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		perror(path);
+		return EXIT_FAILURE;
+	}
+	if (fstat(fd, &info) < 0)
+	{
+		perror(path);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+	if (info.st_size == 0)
+	{
+		close(fd);
+		return EXIT_SUCCESS;
+	}
+	map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		perror(path);
+		return EXIT_FAILURE;
+	}
+	madvise((void*)map, info.st_size, MADV_SEQUENTIAL);
+
+	// Small files are not worth many threads
+	count = (int)((info.st_size + CHUNKMIN - 1) / CHUNKMIN);
+	if (count > workers)
+	{
+		count = workers;
+	}
+	for (i = 0; i < count; i++)
+	{
+		worker[i].map = map;
+		worker[i].size = info.st_size;
+		worker[i].start = (size_t)info.st_size * i / count;
+		worker[i].end = (size_t)info.st_size * (i + 1) / count;
+		worker[i].gap = gap;
+		worker[i].started = (i > 0 && pthread_create(&worker[i].thread, NULL, analyzeThread, &worker[i]) == 0);
+	}
+	// Chunks without a thread are done here
+	for (i = 0; i < count; i++)
+	{
+		if (!worker[i].started)
+		{
+			analyzeThread(&worker[i]);
+		}
+	}
+
+	memset(&stats, 0, sizeof(stats));
+	for (i = 0; i < count; i++)
+	{
+		if (worker[i].started)
+		{
+			pthread_join(worker[i].thread, NULL);
+		}
+		analyzeMerge(&stats, &worker[i].stats, gap);
+	}
+	munmap((void*)map, info.st_size);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	analyzeReport(path, &stats, info.st_size,
+		(double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+	analyzeMerge(total, &stats, gap);
+	*bytes += info.st_size;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Print usage
+ *
+ * \param name - Program name
+ *
+ */
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"Usage: %s [-j threads] [-g seconds] file...\n"
+		"  -j  Worker threads (default one per CPU, at most %d)\n"
+		"  -g  Count intervals longer than this as gaps (default %.1f s)\n"
+		"  Files are raw receiver logs, ASCII and binary frames mixed. Files are merged in the order given\n",
+		name, WORKERMAX, GAPSECONDS);
+}
+
+int main(int argc, char* argv[])
+{
+	struct analyzestats total;
+	struct timespec start;
+	struct timespec end;
+	size_t bytes = 0;
+	int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	int64_t gap = (int64_t)(GAPSECONDS * GPSTIME_NS);
+	int result = EXIT_SUCCESS;
+	int opt;
+	int i;
+
+	while ((opt = getopt(argc, argv, "j:g:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'j':
+			workers = atoi(optarg);
+			break;
+		case 'g':
+			gap = (int64_t)(strtod(optarg, NULL) * GPSTIME_NS);
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (optind == argc || gap <= 0)
+	{
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (workers < 1)
+	{
+		workers = 1;
+	}
+	if (workers > WORKERMAX)
+	{
+		workers = WORKERMAX;
+	}
+	crc32Init();
+	printf("%d workers, CRC engine %s, frame scan %s\n", workers, crc32Engine(),
+#ifdef ANALYZE_SSE2
+		"sse2"
+#else
+		"bytewise"
+#endif
+		);
+
+	memset(&total, 0, sizeof(total));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = optind; i < argc; i++)
+	{
+		if (analyzeFile(argv[i], workers, gap, &total, &bytes) == EXIT_FAILURE)
+		{
+			result = EXIT_FAILURE;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if (argc - optind > 1)
+	{
+		analyzeReport("total", &total, bytes,
+			(double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+	}
+	return result;
+}
@@ -0,0 +1,44 @@
+/*
+ * CRC32.h
+ *
+ * NovAtel CRC-32 engine
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _CRC32_H
+#define _CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CRC32_POLYNOMIAL 0xEDB88320UL // Reflected polynomial, zero init, no final xor
+
+// One byte through the table
+#define crc32Byte(crc, c) (((crc) >> 8) ^ crc32Table[((crc) ^ (c)) & 0xFF])
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+typedef uint32_t (*crc32func)(uint32_t, const unsigned char*, size_t);
+
+/****************************************************************
+ * Globals
+ ****************************************************************/
+extern const uint32_t crc32Table[256];
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+void crc32Init(void);
+const char* crc32Engine(void);
+uint32_t crc32Update(uint32_t, const unsigned char*, size_t);
+uint32_t crc32Bytewise(uint32_t, const unsigned char*, size_t);
+uint32_t crc32Slice8(uint32_t, const unsigned char*, size_t);
+uint32_t crc32Slice16(uint32_t, const unsigned char*, size_t);
+uint32_t crc32Clmul(uint32_t, const unsigned char*, size_t);
+int crc32HasClmul(void);
+
+#endif /* _CRC32_H */
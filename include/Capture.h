@@ -0,0 +1,102 @@
+/*
+ * Capture.h
+ *
+ * Binary capture of receiver bytes, PPS edges and clock corrections
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define CAPTURE_MAGIC 0x43535050		// "PPSC"
+#define CAPTURE_VERSION 1
+#define CAPTURE_BUFFER 16384			// Records are buffered and appended in one write
+#define CAPTURE_PREALLOCATE (4 * 1024 * 1024) // Disk space reserved ahead of the appends
+#define CAPTURE_RECORDSIZE 8			// Record header size on disk
+#define CAPTURE_TIMESIZE 16				// Time record and file header body size
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Record type
+enum capturetype
+{
+	CAPTURE_TIME,		// Absolute CLOCK_MONOTONIC and CLOCK_REALTIME, after a gap or a restart
+	CAPTURE_UART,		// Bytes read from a receiver
+	CAPTURE_EDGE,		// PPS edge on CLOCK_REALTIME and its sequence number
+	CAPTURE_FREQUENCY,	// Clock frequency correction set, in ppb
+	CAPTURE_STEP		// Clock stepped, in ns
+};
+
+// Capture file writer
+struct capture
+{
+	int fd;						// Capture file, opened for appending
+	pthread_mutex_t lock;		// Edge and UART threads write concurrently in threaded mode
+	unsigned char buffer[CAPTURE_BUFFER];
+	size_t used;				// Bytes buffered
+	int64_t last;				// CLOCK_MONOTONIC of the last record in ns
+	off_t size;					// Bytes written to the file
+	off_t allocated;			// Bytes reserved for the file
+	unsigned long records;		// Records captured
+};
+
+// One record read back
+struct captureevent
+{
+	enum capturetype type;
+	int source;					// Receiver number
+	int64_t time;				// CLOCK_MONOTONIC at capture in ns
+	int64_t epoch;				// CLOCK_REALTIME minus CLOCK_MONOTONIC at capture in ns
+	const unsigned char* data;	// UART: received bytes
+	size_t length;				// UART: number of bytes
+	struct timespec stamp;		// EDGE: edge on CLOCK_REALTIME
+	unsigned long sequence;		// EDGE: edge sequence number
+	double frequency;			// FREQUENCY: frequency correction in ppb
+	int64_t step;				// STEP: step in ns
+};
+
+// Capture file reader
+struct capturereader
+{
+	const unsigned char* map;	// Mapped file
+	size_t size;				// File size
+	size_t offset;				// Next record
+	int64_t time;				// CLOCK_MONOTONIC of the last record in ns
+	int64_t epoch;				// CLOCK_REALTIME minus CLOCK_MONOTONIC in ns
+};
+
+// Clock corrections over time, for replay
+struct captureclock
+{
+	int64_t time;				// CLOCK_MONOTONIC the phase is valid at in ns, 0 = not started
+	double phase;				// Corrections added to the clock until time in ns
+	double frequency;			// Frequency correction in effect in ppb
+	int64_t epoch;				// CLOCK_REALTIME minus CLOCK_MONOTONIC in ns
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int captureOpen(struct capture*, const char*);
+void captureBytes(struct capture*, int, const unsigned char*, size_t);
+void captureEdge(struct capture*, int, const struct timespec*, unsigned long);
+void captureFrequency(struct capture*, double);
+void captureStep(struct capture*, int64_t);
+int captureFlush(struct capture*);
+int captureClose(struct capture*);
+int captureReaderOpen(struct capturereader*, const char*);
+int captureRead(struct capturereader*, struct captureevent*);
+void captureReaderClose(struct capturereader*);
+void captureClockAdvance(struct captureclock*, int64_t);
+
+#endif /* _CAPTURE_H */
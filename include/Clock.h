@@ -0,0 +1,28 @@
+/*
+ * Clock.h
+ *
+ * System clock adjustment
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _CLOCK_H
+#define _CLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int clockStep(int64_t);
+int clockSlew(int64_t);
+int clockSetFrequency(double);
+int clockSetSynced(int64_t);
+int clockAt(const struct timespec*, clockid_t, clockid_t, struct timespec*);
+int clockRealtimeAt(const struct timespec*, clockid_t, struct timespec*);
+int64_t clockMonotonicNs(void);
+
+#endif /* _CLOCK_H */
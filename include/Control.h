@@ -0,0 +1,56 @@
+/*
+ * Control.h
+ *
+ * Control socket
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _CONTROL_H
+#define _CONTROL_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "EventLoop.h"
+
+#define CONTROLCLIENTS 4		// Connections at the same time
+#define CONTROLCOMMANDMAX 64	// Command line length
+
+struct control;
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Command handler, writes the reply to the stream
+typedef void (*controlhandler)(void* context, const char* command, FILE* reply);
+
+// One connection
+struct controlclient
+{
+	struct eventsource source;	// fd -1 = free
+	struct control* control;
+	char command[CONTROLCOMMANDMAX];
+	size_t length;
+};
+
+// Control socket state
+struct control
+{
+	const char* path;			// Unix socket path
+	struct eventloop* loop;
+	struct eventsource listen;
+	struct controlclient clients[CONTROLCLIENTS];
+	controlhandler handler;
+	void* context;
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int controlOpen(struct control*, struct eventloop*, const char*, controlhandler, void*);
+void controlClose(struct control*);
+
+#endif /* _CONTROL_H */
@@ -0,0 +1,37 @@
+/*
+ * Drift.h
+ *
+ * Persistent oscillator frequency
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _DRIFT_H
+#define _DRIFT_H
+
+#include <stdint.h>
+
+#define DRIFT_MAXAGE (30LL * 86400)        // Drift files older than 30 days are ignored, in s
+#define DRIFT_SAVEPERIOD 3600000000000LL  // Save period while locked in ns, one hour
+#define DRIFT_TMPSUFFIX ".tmp"            // Written first, then renamed over the drift file
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Drift file contents
+struct drift
+{
+	double frequency;		// Oscillator frequency correction in ppb
+	double uncertainty;		// Frequency scatter in ppb
+	int64_t time;			// CLOCK_REALTIME seconds when the clock was last good
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int driftLoad(const char*, struct drift*);
+int driftSave(const char*, const struct drift*);
+
+#endif /* _DRIFT_H */
@@ -0,0 +1,50 @@
+/*
+ * Estimator.h
+ *
+ * Windowed offset and frequency estimator
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _ESTIMATOR_H
+#define _ESTIMATOR_H
+
+#include <stdint.h>
+
+#define ESTIMATORMAX 32             // Largest window in samples
+#define ESTIMATOR_WINDOW 8          // Default window in samples
+#define ESTIMATOR_MINSAMPLES 4      // Inliers needed for an estimate
+#define ESTIMATOR_REJECT 3.0        // Outlier limit in robust standard deviations (1.4826 * MAD)
+#define ESTIMATOR_MADFLOOR 50.0     // Smallest MAD used in ns, keeps quiet data from rejecting everything
+#define ESTIMATOR_CONFIDENCE 20000LL // Default confidence bound in ns needed to correct. 20us
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Estimator configuration, window and last estimate
+struct estimator
+{
+	int window;					// Samples used, 1-ESTIMATORMAX
+	int64_t confidence;			// Largest accepted confidence bound in ns
+	int64_t time[ESTIMATORMAX];	// Reference time of the sample in ns
+	int64_t offset[ESTIMATORMAX];	// Offset of the sample in ns
+	int count;					// Samples in the window
+	int next;					// Ring index of the next sample
+	int inliers;				// Samples used by the last estimate
+	int rejected;				// The newest sample was rejected as an outlier
+	unsigned long outliers;		// Rejected samples in total
+	int64_t estimate;			// Offset at the newest sample in ns
+	double frequency;			// Offset rate in ppb
+	int64_t bound;				// Confidence bound of the estimate in ns, about 95%
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+void estimatorInit(struct estimator*);
+void estimatorReset(struct estimator*);
+int estimatorSample(struct estimator*, int64_t, int64_t);
+
+#endif /* _ESTIMATOR_H */
@@ -0,0 +1,51 @@
+/*
+ * EventLoop.h
+ *
+ * epoll event loop with timerfd deadlines
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _EVENTLOOP_H
+#define _EVENTLOOP_H
+
+#include <stdint.h>
+
+#define EVENTLOOPMAX 16 // Events handled per wakeup
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Handler for a ready file descriptor, events are EPOLLIN etc.
+typedef void (*eventhandler)(void* context, uint32_t events);
+
+// File descriptor watched by the loop
+struct eventsource
+{
+	int fd;
+	eventhandler handler;
+	void* context;
+};
+
+// Event loop
+struct eventloop
+{
+	int epfd;				// epoll instance
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int eventLoopInit(struct eventloop*);
+int eventLoopAdd(struct eventloop*, struct eventsource*, uint32_t);
+int eventLoopRemove(struct eventloop*, struct eventsource*);
+int eventLoopRun(struct eventloop*);
+void eventLoopClose(struct eventloop*);
+int eventTimerCreate(void);
+int eventTimerArm(int, int64_t, int64_t);
+int eventTimerDisarm(int);
+uint64_t eventTimerRead(int);
+
+#endif /* _EVENTLOOP_H */
@@ -0,0 +1,49 @@
+/*
+ * Framer.h
+ *
+ * Streaming framer for NovAtel ASCII and binary logs
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _FRAMER_H
+#define _FRAMER_H
+
+#include <stddef.h>
+#include "tools.h"
+
+#define FRAMERSIZE 1024       // Ring buffer size, must be a power of two
+#define FRAMEMAX TIMELOGMAX   // Longest accepted frame including #, *CRC and \r or binary CRC
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Framer ring buffer and statistics
+struct framer
+{
+	unsigned char ring[FRAMERSIZE];	// Received bytes
+	unsigned int head;				// Write position, free running
+	unsigned int tail;				// Start of the current frame candidate, free running
+	unsigned int scan;				// Next byte to scan for the frame end, free running
+	int insync;						// tail points at a '#' or 0xAA
+	int binary;						// Current frame is a binary log
+	char frame[FRAMEMAX + 1];		// Last complete frame, NUL terminated
+	unsigned long frames;			// Complete frames, the CRC is checked by the parser
+	unsigned long malformed;		// Frames dropped for a missing CRC field or a bad header
+	unsigned long oversize;			// Frames dropped for length
+	unsigned long garbage;			// Bytes skipped outside frames
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+void framerInit(struct framer*);
+void framerReset(struct framer*);
+unsigned char* framerSpace(struct framer*, size_t*);
+void framerCommit(struct framer*, size_t);
+size_t framerWrite(struct framer*, const unsigned char*, size_t);
+int framerNext(struct framer*, char**, size_t*);
+
+#endif /* _FRAMER_H */
@@ -0,0 +1,42 @@
+/*
+ * GPSTime.h
+ *
+ * Fixed point GPS time
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _GPSTIME_H
+#define _GPSTIME_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define GPSTIME_NS 1000000000LL          // ns per second
+#define GPSTIME_WEEKSECONDS 604800LL     // Seconds in a GPS week
+#define GPSTIME_UNIXSECONDS 315964800LL  // Seconds between Unix epoch and GPS epoch
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Time in integer ns since the GPS epoch, 00:00 6th January 1980.
+// int64_t covers +-292 years with exact nanoseconds
+struct gpstime
+{
+	int64_t ns;
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int gpsTimeParseDecimal(const char*, const char*, int64_t*);
+void gpsTimeFromWeek(int, int64_t, struct gpstime*);
+void gpsTimeToWeek(const struct gpstime*, int*, int64_t*);
+void gpsTimeAdd(struct gpstime*, int64_t);
+int64_t gpsTimeDiff(const struct gpstime*, const struct gpstime*);
+void gpsTimeToTimespec(const struct gpstime*, struct timespec*);
+void gpsTimeFromTimespec(const struct timespec*, struct gpstime*);
+
+#endif /* _GPSTIME_H */
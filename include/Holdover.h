@@ -0,0 +1,56 @@
+/*
+ * Holdover.h
+ *
+ * Oscillator frequency model for holdover
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _HOLDOVER_H
+#define _HOLDOVER_H
+
+#include <stdint.h>
+
+#define HOLDOVER_DELAY 2000000000LL  // Holdover starts 2 s after the last servo sample, in ns
+#define HOLDOVER_PERIOD 1000000000LL // Frequency and error bound update interval in holdover, in ns
+#define HOLDOVER_MEMORY 3600.0       // Frequency fit memory in samples, one per second
+#define HOLDOVER_AGINGMIN 600.0      // Fit weight needed to trust the aging trend
+#define HOLDOVER_SCATTERWEIGHT 16.0  // Frequency residual averaging, in samples
+#define HOLDOVER_FREQERROR 5.0       // Smallest frequency uncertainty in ppb
+#define HOLDOVER_WANDER 0.01         // Frequency wander the trend does not model, ppb/s
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Frequency model and holdover state
+struct holdover
+{
+	int64_t origin;			// CLOCK_MONOTONIC of fit time 0 in ns, 0 = not trained
+	double weight;			// Decayed number of samples in the fit
+	double sumt;			// Decayed sums of the fit, t in s since origin, f in ppb
+	double sumf;
+	double sumtt;
+	double sumtf;
+	double scatter;			// Averaged frequency residual of the fit in ppb
+	int64_t lastsample;		// CLOCK_MONOTONIC of the last locked sample in ns
+	int64_t lastbound;		// Error bound at the last locked sample in ns
+	int active;				// The clock is in holdover
+	int64_t lastupdate;		// CLOCK_MONOTONIC of the last holdover update in ns
+	double frequency;		// Frequency applied by the last update in ppb
+	int64_t bound;			// Error bound published by the last update in ns
+	unsigned long entries;	// Holdovers entered
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+void holdoverInit(struct holdover*);
+void holdoverSample(struct holdover*, int64_t, double, int64_t, int);
+double holdoverFrequency(const struct holdover*, int64_t);
+int64_t holdoverBound(const struct holdover*, int64_t);
+int holdoverUpdate(struct holdover*, int64_t);
+double holdoverResume(struct holdover*, int64_t);
+
+#endif /* _HOLDOVER_H */
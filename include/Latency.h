@@ -0,0 +1,56 @@
+/*
+ * Latency.h
+ *
+ * Per-stage latency histograms
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define LATENCYBUCKETS 32 // Power of two ns buckets, the last one collects everything above 1s
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Measured stage, each is the time since the previous stage of the cycle
+enum latencystage
+{
+	LATENCY_EDGE,		// Edge time stamp to edge seen by PPSTime
+	LATENCY_FIRSTBYTE,	// Edge seen to first time log byte
+	LATENCY_FRAME,		// First byte to frame complete
+	LATENCY_PARSE,		// Frame complete to CRC checked and parsed
+	LATENCY_CLOCK,		// Parsed to clock adjusted
+	LATENCY_TOTAL,		// Edge seen to clock adjusted
+	LATENCY_COMMAND,	// Receiver command written to response
+	LATENCY_PERIOD,		// Deviation of the edge interval from 1s
+	LATENCY_STAGES
+};
+
+// Fixed bucket latency histogram
+struct histogram
+{
+	unsigned long count;
+	int64_t sum;
+	int64_t min;
+	int64_t max;
+	unsigned long buckets[LATENCYBUCKETS];	// Bucket i counts values below 2^i ns
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+void latencyStart(const struct timespec*, clockid_t);
+void latencyMark(enum latencystage);
+void latencyAdd(enum latencystage, int64_t);
+void latencyEnd(void);
+void latencyDump(FILE*);
+
+#endif /* _LATENCY_H */
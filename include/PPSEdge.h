@@ -0,0 +1,27 @@
+/*
+ * PPSEdge.h
+ *
+ * Captured PPS edge
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _PPSEDGE_H
+#define _PPSEDGE_H
+
+#include <time.h>
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// One captured PPS rising edge
+struct ppsedge
+{
+	struct timespec stamp;	// Time stamp of the rising edge
+	clockid_t clock;		// Clock used for the time stamp
+	unsigned long sequence;	// Edge sequence number, gaps mean missed edges
+};
+
+#endif /* _PPSEDGE_H */
@@ -0,0 +1,85 @@
+/*
+ * PPSSource.h
+ *
+ * PPS edge capture backends
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _PPSSOURCE_H
+#define _PPSSOURCE_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/timepps.h>
+
+#include "PPSEdge.h"
+
+#define PPSTIMEOUTMS 3000 // Edge timeout in ms. PPS is expected once per second
+#define PPSSPIN_GUARDUS 200      // SPIN: default wakeup before the predicted edge in us
+#define PPSSPIN_GAIN 0.125       // SPIN: EWMA gain of the prediction error and wakeup latency
+#define PPSSPIN_PERIODGAIN 0.0625 // SPIN: EWMA gain of the edge interval
+#define PPSSPIN_WINDOWMAX 100000000LL // SPIN: widest spin window in ns, wider means lost
+#define PPSSPIN_CHECKS 256       // SPIN: register reads between deadline checks
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Edge capture backend
+enum ppsbackend
+{
+	PPS_BACKEND_IOBB,		// libiobb pin polling, time stamp taken in user space
+	PPS_BACKEND_GPIOCHIP,	// GPIO character device line events, time stamp taken in kernel
+	PPS_BACKEND_KPPS,		// RFC 2783 kernel PPS API (/dev/ppsN), time stamp taken in kernel
+	PPS_BACKEND_SPIN		// Mapped GPIO register, sleep until just before the predicted edge and spin
+};
+
+// SPIN: register mapping and edge prediction
+struct ppsspin
+{
+	void* map;					// Mapped GPIO bank
+	volatile const uint32_t* datain; // GPIO_DATAIN register of the bank
+	uint32_t mask;				// PPS bit in GPIO_DATAIN
+	int64_t guard;				// Least wakeup before the predicted edge in ns
+	int64_t lastedge;			// CLOCK_MONOTONIC of the last edge in ns, 0 = acquiring
+	int64_t counted;			// CLOCK_MONOTONIC of the last edge counted in the sequence in ns, 0 = none
+	double period;				// Edge interval on CLOCK_MONOTONIC in ns
+	double jitter;				// Mean prediction error in ns
+	double wakeup;				// Mean late wakeup in ns
+	int64_t spinning;			// Time spent spinning in ns
+	unsigned long edges;		// Edges caught spinning
+	unsigned long acquisitions;	// Times the edge was searched by polling
+	unsigned long late;			// Wakeups after the edge
+	unsigned long missing;		// Predicted edges that did not come
+};
+
+// PPS source configuration and state
+struct ppssource
+{
+	enum ppsbackend backend;
+	char port;				// IOBB: expansion header, 8 or 9
+	char pin;				// IOBB: header pin, 1-46
+	const char* device;		// GPIOCHIP: chip device, e.g. /dev/gpiochip1. KPPS: /dev/ppsN. SPIN: GPIO bank 0-3
+	unsigned int line;		// GPIOCHIP: line offset on the chip. SPIN: bit in the bank
+	int fd;					// GPIOCHIP: line request file descriptor. KPPS: PPS device
+	pps_handle_t handle;	// KPPS: RFC 2783 handle
+	unsigned long sequence;	// Sequence number of the last edge
+	int level;				// IOBB, SPIN: pin level at the last ppsSourcePoll()
+	struct ppsspin spin;	// SPIN: mapping and prediction
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int ppsSourceBackend(const char*, enum ppsbackend*);
+int ppsSourcePin(const char*, struct ppssource*);
+int ppsSourceOpen(struct ppssource*);
+int ppsSourceWait(struct ppssource*, struct ppsedge*);
+int ppsSourcePoll(struct ppssource*, struct ppsedge*);
+int ppsSourceFd(const struct ppssource*);
+int ppsSourceClose(struct ppssource*);
+int waitPPSHigh(char, char);
+
+#endif /* _PPSSOURCE_H */
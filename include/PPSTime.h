@@ -9,5 +9,54 @@
 #ifndef _MAIN_H
 #define _MAIN_H
 
+#include "Capture.h"
+#include "Estimator.h"
+#include "Framer.h"
+#include "Holdover.h"
+#include "PPSSource.h"
+#include "Realtime.h"
+#include "Refclock.h"
+#include "Select.h"
+#include "Servo.h"
+#include "TimePage.h"
+#include "UART.h"
+
+#define SOURCEMAX SELECTMAX // Receivers with their own PPS input
+
+// Receiver and its PPS input
+struct gnsssource
+{
+	const char* uartdevice;		// Receiver serial device
+	struct uart uart;			// Receiver link
+	struct ppssource pps;		// PPS input of the receiver
+	struct framer framer;		// Time log framer
+};
+
+// Program configuration and state
+struct ppstime
+{
+	int continuous;				// Keep running and correct the clock every second
+	int binary;					// Use the binary TIMEB log
+	struct servo servo;			// Clock servo
+	struct estimator estimator;	// Offset filter in front of the servo
+	struct holdover holdover;	// Frequency model steering through outages
+	int64_t phase;				// Phase applied by steps and frequency adjustments in ns
+	double appliedfrequency;	// Frequency adjustment in effect in ppb
+	int64_t lasttime;			// Reference time of the last measurement in ns, 0 = none
+	int corrected;				// The clock has been corrected
+	unsigned long lastsequence;	// Sequence number of the last corrected edge, 0 = none
+	struct refclock refclocks[REFCLOCKMAX]; // Time daemon exporters, the clock is not touched
+	int refclockcount;			// Number of exporters, 0 = correct the clock
+	const char* timepagepath;	// Time page file, NULL = no time page
+	struct timepublisher timepage; // Time page for local readers
+	const char* driftpath;		// Drift file, NULL = none
+	int64_t driftsaved;			// CLOCK_MONOTONIC of the last drift file save in ns, 0 = never
+	const char* capturepath;	// Capture file, NULL = no capture
+	struct capture capture;		// Receiver bytes, edges and clock corrections being captured
+	struct captureclock* simulated; // Simulated clock when replaying a capture, NULL = the system clock
+	struct rtprofile realtime;	// Scheduling profile of the PPS wait
+	struct gnsssource sources[SOURCEMAX]; // Receivers, the first one is used without the event loop
+	int sourcecount;			// Number of receivers
+};
 
 #endif /* _MAIN_H */
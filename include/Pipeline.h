@@ -0,0 +1,92 @@
+/*
+ * Pipeline.h
+ *
+ * Threaded PPS edge and time log pipeline
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "Framer.h"
+#include "GPSTime.h"
+#include "PPSSource.h"
+#include "Queue.h"
+#include "tools.h"
+#include "UART.h"
+
+#define PIPELINESLOTS 8			// Queued events per thread, power of two
+#define PIPELINEPENDING 4		// Edges waiting for their time log
+#define PIPELINEWINDOW 900000000LL // A time log belongs to an edge seen less than 900ms before it
+#define PIPELINEUARTTIMEOUT 2000 // UART thread time log timeout in ms
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// PPS edge from the edge thread
+struct edgeevent
+{
+	struct ppsedge edge;		// Edge as captured
+	struct ppsedge realtime;	// Edge converted to CLOCK_REALTIME right after capture
+	struct timespec anchor;		// Edge converted to CLOCK_MONOTONIC_RAW right after capture
+	int64_t seen;				// CLOCK_MONOTONIC when the edge was seen in ns
+	int64_t detection;			// Edge time stamp to seen in ns
+};
+
+// Time log from the UART thread
+struct logevent
+{
+	struct timelog log;			// Parsed time log
+	struct gpstime utctime;		// UTC time of the log
+	int64_t framed;				// CLOCK_MONOTONIC when the frame was complete in ns
+	int64_t parsed;				// CLOCK_MONOTONIC when the log was parsed in ns
+};
+
+// Matched edge and time log
+struct pipelinepair
+{
+	struct edgeevent edge;
+	struct logevent log;
+};
+
+// Pipeline state
+struct pipeline
+{
+	struct ppssource* pps;		// PPS source, used by the edge thread only
+	struct uart* uart;			// Receiver UART, used by the UART thread only
+	struct framer* framer;		// Time log framer, used by the UART thread only
+	int stop;					// Set to stop the threads
+	int wakeup;					// eventfd, signaled after every push
+	pthread_t edgethread;
+	pthread_t uartthread;
+	struct queue edges;			// Edge thread to matcher
+	struct queue logs;			// UART thread to matcher
+	struct edgeevent edgeslots[PIPELINESLOTS];
+	struct logevent logslots[PIPELINESLOTS];
+	struct edgeevent pending[PIPELINEPENDING]; // Edges waiting for a time log, oldest first
+	int pendingcount;
+	int havelast;				// lastsequence and lastutc are set
+	unsigned long lastsequence;	// Edge sequence number of the last pair
+	int64_t lastutc;			// UTC time of the last pair in ns
+	unsigned long matched;		// Statistics
+	unsigned long unmatchededges;
+	unsigned long unmatchedlogs;
+	unsigned long mismatched;
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int pipelineStart(struct pipeline*, struct ppssource*, struct uart*, struct framer*);
+int pipelineNext(struct pipeline*, struct pipelinepair*, int);
+void pipelineDone(const struct pipelinepair*);
+void pipelineStop(struct pipeline*);
+
+#endif /* _PIPELINE_H */
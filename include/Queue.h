@@ -0,0 +1,37 @@
+/*
+ * Queue.h
+ *
+ * Lock-free single producer, single consumer queue
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _QUEUE_H
+#define _QUEUE_H
+
+#include <stddef.h>
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Queue of fixed size elements in caller provided storage
+struct queue
+{
+	unsigned int head;		// Free running push count, written by the producer only
+	unsigned int tail __attribute__((aligned(64))); // Free running pop count, written by the consumer only
+	unsigned int slots;		// Number of elements, power of two
+	size_t size;			// Element size in bytes
+	unsigned char* data;	// slots * size bytes
+	unsigned long full;		// Pushes dropped because the queue was full
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int queueInit(struct queue*, void*, size_t, unsigned int);
+int queuePush(struct queue*, const void*);
+int queuePop(struct queue*, void*);
+
+#endif /* _QUEUE_H */
@@ -0,0 +1,45 @@
+/*
+ * Realtime.h
+ *
+ * Real-time execution profile and synthetic load
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _REALTIME_H
+#define _REALTIME_H
+
+#include <sys/types.h>
+
+#define REALTIME_PRIORITY 80			// Default SCHED_FIFO priority
+#define REALTIME_STACKPREFAULT (256 * 1024) // Stack bytes touched before running
+#define REALTIME_STRESSMEMORY (32 * 1024 * 1024) // Buffer walked by a memory stress worker
+#define REALTIME_STRESSMAX 64			// Stress workers at most
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Real-time profile
+struct rtprofile
+{
+	int priority;		// SCHED_FIFO priority 1-99, 0 = keep SCHED_OTHER
+	int cpu;			// CPU to pin to, -1 = any
+};
+
+// Synthetic load
+struct rtstress
+{
+	int workers;		// Number of worker processes
+	pid_t pids[REALTIME_STRESSMAX];
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int realtimeApply(const struct rtprofile*);
+int realtimeStressStart(struct rtstress*, int);
+void realtimeStressStop(struct rtstress*);
+
+#endif /* _REALTIME_H */
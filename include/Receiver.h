@@ -0,0 +1,25 @@
+/*
+ * Receiver.h
+ *
+ * GNSS receiver configuration
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _RECEIVER_H
+#define _RECEIVER_H
+
+#define RECEIVERBAUD 115200       // Default link rate in bps
+#define RECEIVERPROBEMS 300       // Response timeout while probing the link rate in ms
+#define RECEIVERCMDTIMEOUTMS 1000 // Response timeout for configuration commands in ms
+
+struct uart;
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int receiverConfigure(struct uart*, int, int);
+
+#endif /* _RECEIVER_H */
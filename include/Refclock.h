@@ -0,0 +1,85 @@
+/*
+ * Refclock.h
+ *
+ * Reference clock exporters for ntpd and chronyd
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _REFCLOCK_H
+#define _REFCLOCK_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/un.h>
+
+#define REFCLOCKMAX 4               // Exporters at the same time
+#define REFCLOCK_SHMKEY 0x4e545030  // "NTP0", NTP SHM key of unit 0
+#define REFCLOCK_SOCKMAGIC 0x534f434b // "SOCK", chrony SOCK sample magic
+#define REFCLOCK_PRECISION -20      // About 1us, kernel time stamped edges
+#define REFCLOCK_PRECISIONPOLL -10  // About 1ms, polled edges
+
+struct gpstime;
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Exporter type
+enum refclocktype
+{
+	REFCLOCK_SHM,	// NTP shared memory driver (ntpd type 28, chrony SHM, gpsd layout)
+	REFCLOCK_SOCK	// chrony SOCK refclock datagram
+};
+
+// NTP SHM segment layout
+struct shmTime
+{
+	int mode;				// 1: count/valid protocol
+	volatile int count;		// Incremented before and after the update
+	time_t clockTimeStampSec;	// Reference time
+	int clockTimeStampUSec;
+	time_t receiveTimeStampSec;	// System time when the reference time was valid
+	int receiveTimeStampUSec;
+	int leap;
+	int precision;			// log2 of the precision in seconds
+	int nsamples;
+	volatile int valid;		// Set when a new sample is ready
+	unsigned clockTimeStampNSec;
+	unsigned receiveTimeStampNSec;
+	int dummy[8];
+};
+
+// chrony SOCK refclock sample
+struct socksample
+{
+	struct timeval tv;		// System time of the sample
+	double offset;			// Reference minus system time in seconds
+	int pulse;				// 0: offset is a full time sample
+	int leap;
+	int pad;
+	int magic;				// REFCLOCK_SOCKMAGIC
+};
+
+// One exporter
+struct refclock
+{
+	enum refclocktype type;
+	int unit;				// SHM: unit, key is REFCLOCK_SHMKEY + unit
+	const char* path;		// SOCK: chronyd socket path
+	int precision;			// log2 of the sample precision in seconds
+	struct shmTime* shm;	// SHM: attached segment
+	int fd;					// SOCK: datagram socket, not connected
+	struct sockaddr_un address;	// SOCK: chronyd socket address
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int refclockParse(const char*, struct refclock*);
+int refclockOpen(struct refclock*);
+int refclockPublish(struct refclock*, const struct timespec*, const struct gpstime*);
+int refclockClose(struct refclock*);
+
+#endif /* _REFCLOCK_H */
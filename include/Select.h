@@ -0,0 +1,52 @@
+/*
+ * Select.h
+ *
+ * Source selection and combining
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _SELECT_H
+#define _SELECT_H
+
+#include <stdint.h>
+
+#include "tools.h"
+
+#define SELECTMAX 4                // Sources in one round
+#define SELECT_BASEERROR 1000LL    // Error bound of a kernel time stamped edge in ns
+#define SELECT_JITTERGAIN 0.125    // EWMA gain of the source scatter around the combined offset
+#define SELECT_CONVERGING 8        // Error bound multiplier, receiver clock converging
+#define SELECT_ITERATING 64        // Error bound multiplier, receiver clock iterating
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Offset measured by one source in a round
+struct selectsample
+{
+	int source;				// Source index, 0 to SELECTMAX - 1
+	int64_t offset;			// System time minus GPS time at the edge in ns
+	int64_t error;			// Base error bound of the source in ns
+	enum clockstatus clock;	// Receiver clock status
+};
+
+// Selection state kept between rounds
+struct selector
+{
+	double jitter[SELECTMAX];	// Scatter of each source around the combined offset in ns
+	int selected;				// Best source of the last round, -1 = none
+	int truechimers;			// Sources that agreed in the last round
+	unsigned long rounds;		// Rounds combined
+	unsigned long falsetickers[SELECTMAX]; // Rounds each source was rejected in
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+void selectInit(struct selector*);
+int selectCombine(struct selector*, const struct selectsample*, int, int64_t*);
+
+#endif /* _SELECT_H */
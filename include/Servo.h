@@ -0,0 +1,58 @@
+/*
+ * Servo.h
+ *
+ * PI clock servo
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _SERVO_H
+#define _SERVO_H
+
+#include <stdint.h>
+
+#define SERVO_KP 0.7                // Default proportional gain
+#define SERVO_KI 0.3                // Default integral gain
+#define SERVO_STEPTHRESHOLD 20000LL // Default step threshold in ns before lock. 20us
+#define SERVO_LOCKTHRESHOLD 1000LL  // Default lock threshold in ns. 1us
+#define SERVO_LOCKCOUNT 4           // Samples inside the lock threshold to declare lock
+#define SERVO_MAXFREQ 500000.0      // Frequency adjustment limit in ppb. Kernel limit is 500ppm
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Servo convergence state
+enum servostate
+{
+	SERVO_UNLOCKED,	// Converging, phase and frequency adjusted
+	SERVO_JUMP,		// Offset too large, caller must step the clock
+	SERVO_LOCKED	// Offset has stayed inside the lock threshold
+};
+
+// Servo configuration and state
+struct servo
+{
+	double kp;				// Proportional gain
+	double ki;				// Integral gain per second
+	int64_t stepthreshold;	// Step instead of slew above this offset in ns until locked. 0 = never step
+	int64_t lockthreshold;	// Offset in ns considered converged
+	int lockcount;			// Consecutive converged samples needed for lock
+	double maxfrequency;	// Frequency adjustment limit in ppb
+	double drift;			// Integrator, estimated oscillator frequency error in ppb
+	double frequency;		// Last frequency adjustment in ppb
+	int inlock;				// Consecutive samples inside the lock threshold
+	int haslocked;			// Lock reached once, steps are disabled from now on
+	enum servostate state;
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+void servoInit(struct servo*);
+enum servostate servoSample(struct servo*, int64_t, double, double*);
+void servoResume(struct servo*, double);
+const char* servoStateName(enum servostate);
+
+#endif /* _SERVO_H */
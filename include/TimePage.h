@@ -0,0 +1,48 @@
+/*
+ * TimePage.h
+ *
+ * Time page publisher
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _TIMEPAGE_H
+#define _TIMEPAGE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "TimePageReader.h"
+
+#define TIMEPAGE_MEMFD "memfd"	// Page path for an anonymous memfd
+#define TIMEPAGE_RATEWEIGHT 8	// Frequency ratio averaging, in samples
+#define TIMEPAGE_MAXGAP 10000000000LL // Restart the frequency ratio after a longer gap in ns
+
+struct gpstime;
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Publisher state
+struct timepublisher
+{
+	const char* path;		// Page file or TIMEPAGE_MEMFD
+	int fd;					// Page file descriptor
+	struct timepage* page;	// Mapped page
+	int64_t lastanchor;		// Previous anchor in ns, 0 = none
+	int64_t lastgps;		// GPS time at the previous anchor in ns
+	double frequency;		// Averaged frequency ratio minus 1
+	int rated;				// frequency is from at least one edge pair
+};
+
+/****************************************************************
+ * Prototypes
+ ****************************************************************/
+int timePageOpen(struct timepublisher*, const char*);
+int timePagePublish(struct timepublisher*, const struct timespec*, const struct gpstime*, int64_t);
+void timePageInvalidate(struct timepublisher*);
+int timePageClose(struct timepublisher*);
+
+#endif /* _TIMEPAGE_H */
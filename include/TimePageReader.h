@@ -0,0 +1,187 @@
+/*
+ * TimePageReader.h
+ *
+ * Header only reader for the PPSTime time page
+ *
+ * PPSTime publishes the latest PPS edge as a CLOCK_MONOTONIC_RAW anchor
+ * and the GPS time at that anchor into a shared page. A reader maps the
+ * page once and then turns CLOCK_MONOTONIC_RAW reads into GPS or UTC time
+ * without locks or system calls, clock_gettime() goes through the vDSO.
+ *
+ * The page is a seqlock: the publisher makes sequence odd, writes the
+ * fields and makes it even again. The reader copies the fields and retries
+ * if sequence was odd or changed meanwhile.
+ *
+ *  const struct timepage* page;
+ *  struct timepagetime now;
+ *
+ *  timePageAttach("/dev/shm/ppstime", &page);
+ *  if (timePageNow(page, TIMEPAGE_MAXAGE, &now) == EXIT_SUCCESS)
+ *      ... now.gps, now.utc ...
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+#ifndef _TIMEPAGEREADER_H
+#define _TIMEPAGEREADER_H
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define TIMEPAGE_MAGIC 0x54535050	// "PPST"
+#define TIMEPAGE_VERSION 1
+#define TIMEPAGE_SIZE 4096			// Mapped size
+#define TIMEPAGE_MAXAGE 2000000000LL // Default anchor age limit in ns, two missed edges
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Shared page layout, written by PPSTime only
+struct timepage
+{
+	uint32_t magic;			// TIMEPAGE_MAGIC
+	uint32_t version;		// TIMEPAGE_VERSION
+	uint32_t sequence;		// Odd while an update is in progress
+	uint32_t valid;			// Anchor is valid, cleared when PPSTime stops
+	int64_t anchor;			// CLOCK_MONOTONIC_RAW at the PPS edge in ns
+	int64_t gps;			// GPS time at the anchor in ns since the GPS epoch
+	int64_t leap;			// GPS minus UTC in ns
+	double frequency;		// GPS ns per CLOCK_MONOTONIC_RAW ns minus 1
+	uint64_t updates;		// Number of updates
+};
+
+// Converted time
+struct timepagetime
+{
+	int64_t gps;			// GPS time in ns since the GPS epoch
+	int64_t utc;			// UTC in ns since the Unix epoch
+	int64_t age;			// Time since the anchor in ns
+};
+
+/**
+ * \brief Map the time page
+ *
+ * \param path - Page file, e.g. /dev/shm/ppstime or /proc/<pid>/fd/<fd>
+ * \param page - Return the mapped page
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static inline int timePageAttach(const char* path, const struct timepage** page)
+{
+	void* map;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return EXIT_FAILURE;
+	}
+	map = mmap(NULL, TIMEPAGE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		return EXIT_FAILURE;
+	}
+	*page = (const struct timepage*)map;
+	if ((*page)->magic != TIMEPAGE_MAGIC || (*page)->version != TIMEPAGE_VERSION)
+	{
+		munmap(map, TIMEPAGE_SIZE);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Unmap the time page
+ *
+ * \param page - Mapped page
+ *
+ */
+static inline void timePageDetach(const struct timepage* page)
+{
+	munmap((void*)page, TIMEPAGE_SIZE);
+}
+
+/**
+ * \brief Consistent copy of the time page
+ *
+ * \param page - Mapped page
+ * \param copy - Return the copy
+ *
+ */
+static inline void timePageSnapshot(const struct timepage* page, struct timepage* copy)
+{
+	uint32_t before, after;
+
+	do
+	{
+		before = __atomic_load_n(&page->sequence, __ATOMIC_ACQUIRE);
+		copy->valid = ((const volatile struct timepage*)page)->valid;
+		copy->anchor = ((const volatile struct timepage*)page)->anchor;
+		copy->gps = ((const volatile struct timepage*)page)->gps;
+		copy->leap = ((const volatile struct timepage*)page)->leap;
+		copy->frequency = ((const volatile struct timepage*)page)->frequency;
+		copy->updates = ((const volatile struct timepage*)page)->updates;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		after = __atomic_load_n(&page->sequence, __ATOMIC_RELAXED);
+	} while ((before & 1) || before != after);
+	copy->magic = page->magic;
+	copy->version = page->version;
+	copy->sequence = before;
+}
+
+/**
+ * \brief CLOCK_MONOTONIC_RAW time to GPS and UTC time
+ *
+ * \param page - Mapped page
+ * \param raw - CLOCK_MONOTONIC_RAW in ns
+ * \param maxage - Largest accepted time since the anchor in ns
+ * \param time - Return the converted time
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if the page is not valid or too old
+ *
+ */
+static inline int timePageConvert(const struct timepage* page, int64_t raw, int64_t maxage, struct timepagetime* time)
+{
+	struct timepage copy;
+	int64_t delta;
+
+	timePageSnapshot(page, &copy);
+	delta = raw - copy.anchor;
+	time->gps = copy.gps + delta + (int64_t)(delta * copy.frequency);
+	// Unix epoch is 315964800 s before the GPS epoch
+	time->utc = time->gps - copy.leap + 315964800LL * 1000000000LL;
+	time->age = delta;
+	if (!copy.valid || delta > maxage || delta < -maxage)
+	{
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Current GPS and UTC time
+ *
+ * \param page - Mapped page
+ * \param maxage - Largest accepted time since the anchor in ns
+ * \param time - Return the current time
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if the page is not valid or too old
+ *
+ */
+static inline int timePageNow(const struct timepage* page, int64_t maxage, struct timepagetime* time)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+	return timePageConvert(page, now.tv_sec * 1000000000LL + now.tv_nsec, maxage, time);
+}
+
+#endif /* _TIMEPAGEREADER_H */
@@ -11,12 +11,37 @@
 #ifndef _UART_H
 #define _UART_H
 
+#include <stddef.h>
+#include <termios.h>
+
+#define UARTDEVICE "/dev/ttyS1" // UART1 P9.24,P9.26
+
+struct framer;
+struct capture;
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Opened receiver UART
+struct uart
+{
+	const char* device;			// Serial device
+	int fd;						// File descriptor
+	struct termios oldconfig;	// Settings restored by uartClose()
+	struct capture* capture;	// Received bytes are captured here, NULL = no capture
+	int source;					// Receiver number in the capture
+};
+
 /****************************************************************
  * Prototypes
  ****************************************************************/
-int uartInit();
-int uartClose();
-int uartTimelogCmd();
-int uartTimelogRead(char*, int);
+int uartInit(struct uart*, const char*);
+int uartClose(struct uart*);
+int uartSetSpeed(struct uart*, int);
+int uartCommand(struct uart*, const char*, int);
+int uartTimelogRead(struct uart*, struct framer*, char**, size_t*, int);
+int uartTimelogFeed(struct uart*, struct framer*);
+int uartFd(const struct uart*);
+int uartFlush(struct uart*);
 
 #endif /* _UART_H */
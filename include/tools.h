@@ -11,14 +11,60 @@
 #ifndef _TOOLS_H
 #define _TOOLS_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+#define TIMELOGMAX 512        // Longest accepted time log frame
+#define GPSUTCLEAPSECONDS 18  // GPS - UTC in seconds when the log has no UTC offset
+
+struct gpstime;
+struct ppsedge;
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Time log message
+enum timelogid
+{
+	TIMELOG_UNKNOWN,
+	TIMELOG_TIMEA,		// Receiver clock model, offsets and UTC
+	TIMELOG_TIMESYNCA,	// GPS week, milliseconds and time status only
+	TIMELOG_TIMEB,		// Binary TIMEA
+	TIMELOG_TIMESYNCB	// Binary TIMESYNCA
+};
+
+// Receiver clock status
+enum clockstatus
+{
+	CLOCKSTATUS_VALID,		// Clock model valid or fine time
+	CLOCKSTATUS_CONVERGING,
+	CLOCKSTATUS_ITERATING,
+	CLOCKSTATUS_INVALID
+};
+
+// Parsed time log. All times are integer nanoseconds
+struct timelog
+{
+	enum timelogid id;
+	enum clockstatus clock;	// Clock status
+	int week;				// GPS reference week
+	int64_t seconds;		// GPS reference seconds of week in ns
+	int64_t offset;			// Receiver clock offset in ns, receiver - GPS
+	int64_t utcoffset;		// UTC offset in ns, UTC = GPS + utcoffset
+	int hasutc;				// utcoffset is from the log
+	int complete;			// All required fields present
+};
+
 /****************************************************************
  * Prototypes
  ****************************************************************/
-int waitPPSHigh();
-int parseTimelog(char*, long double*);
-void gpsSectoSystemTime(long double, struct timespec);
+int parseTimelog(char*, struct gpstime*);
+int parseTimelogFrame(const char*, size_t, struct timelog*);
+int parseTimelogBinary(const unsigned char*, size_t, struct timelog*);
+void timelogTime(const struct timelog*, struct gpstime*);
+int timelogUtcTime(const struct timelog*, struct gpstime*);
+int gpsSectoSystemTime(const struct gpstime*, const struct ppsedge*, int64_t*);
+unsigned long CRC32Value(int);
 unsigned long calculateBlockCRC32(unsigned long, unsigned char*);
 
 #endif /* _TOOLS_H */
@@ -0,0 +1,395 @@
+/*
+ * CRC32.c
+ *
+ * NovAtel CRC-32 engine
+ *
+ * NovAtel logs use the reflected CRC-32 polynomial 0xEDB88320 with zero
+ * initial value and no final xor. The byte table is generated by the
+ * compiler from the polynomial. Slicing-by-8 and -16 process 8 or 16
+ * bytes per step with tables derived from it in crc32Init(). On x86 CPUs
+ * with PCLMULQDQ, long blocks are folded 64 bytes at a time with
+ * carry-less multiplication. crc32Init() picks the fastest available
+ * engine, until then crc32Update() uses the byte table.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CRC32_X86_CLMUL
+#endif
+
+#include "CRC32.h"
+
+#define CLMULMIN 64 // Shortest block for the folding engine
+
+/****************************************************************
+ * Compile time byte table
+ ****************************************************************/
+// One bit of the bitwise CRC, same as the loop in the NovAtel manual
+#define CRC32_BIT(c) (((c) >> 1) ^ (CRC32_POLYNOMIAL & (0UL - ((c) & 1))))
+#define CRC32_ENTRY(c) (uint32_t)CRC32_BIT(CRC32_BIT(CRC32_BIT(CRC32_BIT( \
+	CRC32_BIT(CRC32_BIT(CRC32_BIT(CRC32_BIT((unsigned long)(c)))))))))
+#define CRC32_R2(n) CRC32_ENTRY(n), CRC32_ENTRY((n) + 1)
+#define CRC32_R4(n) CRC32_R2(n), CRC32_R2((n) + 2)
+#define CRC32_R8(n) CRC32_R4(n), CRC32_R4((n) + 4)
+#define CRC32_R16(n) CRC32_R8(n), CRC32_R8((n) + 8)
+#define CRC32_R32(n) CRC32_R16(n), CRC32_R16((n) + 16)
+#define CRC32_R64(n) CRC32_R32(n), CRC32_R32((n) + 32)
+#define CRC32_R128(n) CRC32_R64(n), CRC32_R64((n) + 64)
+
+const uint32_t crc32Table[256] = { CRC32_R128(0), CRC32_R128(128) };
+
+// Slicing tables, crc32Slices[0] is crc32Table
+static uint32_t crc32Slices[16][256];
+static int slicesready = 0;
+
+// Selected engine
+static crc32func engine = crc32Bytewise;
+static const char* enginename = "bytewise";
+
+/**
+ * \brief Build slicing tables
+ *
+ * Table k gives the CRC of a byte followed by k zero bytes.
+ *
+ */
+static void buildSlices(void)
+{
+	int i;
+	int k;
+
+	for (i = 0; i < 256; i++)
+	{
+		crc32Slices[0][i] = crc32Table[i];
+	}
+	for (k = 1; k < 16; k++)
+	{
+		for (i = 0; i < 256; i++)
+		{
+			crc32Slices[k][i] = crc32Byte(crc32Slices[k - 1][i], 0);
+		}
+	}
+	slicesready = 1;
+}
+
+/**
+ * \brief Read 32 bit little endian word
+ *
+ * \param p - Data
+ *
+ * \return Word
+ *
+ */
+static inline uint32_t readLE32(const unsigned char* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * \brief Byte table CRC
+ *
+ * \param crc - CRC of the preceding data, 0 to start
+ * \param data - Data block
+ * \param length - Number of bytes
+ *
+ * \return CRC-32 value
+ *
+ */
+uint32_t crc32Bytewise(uint32_t crc, const unsigned char* data, size_t length)
+{
+	while (length-- != 0)
+	{
+		crc = crc32Byte(crc, *data++);
+	}
+	return crc;
+}
+
+/**
+ * \brief Slicing-by-8 CRC
+ *
+ * \param crc - CRC of the preceding data, 0 to start
+ * \param data - Data block
+ * \param length - Number of bytes
+ *
+ * \return CRC-32 value
+ *
+ */
+uint32_t crc32Slice8(uint32_t crc, const unsigned char* data, size_t length)
+{
+	uint32_t one;
+	uint32_t two;
+
+	if (!slicesready)
+	{
+		buildSlices();
+	}
+	while (length >= 8)
+	{
+		one = readLE32(data) ^ crc;
+		two = readLE32(data + 4);
+		crc = crc32Slices[7][one & 0xFF] ^ crc32Slices[6][(one >> 8) & 0xFF] ^
+			crc32Slices[5][(one >> 16) & 0xFF] ^ crc32Slices[4][one >> 24] ^
+			crc32Slices[3][two & 0xFF] ^ crc32Slices[2][(two >> 8) & 0xFF] ^
+			crc32Slices[1][(two >> 16) & 0xFF] ^ crc32Slices[0][two >> 24];
+		data += 8;
+		length -= 8;
+	}
+	return crc32Bytewise(crc, data, length);
+}
+
+/**
+ * \brief Slicing-by-16 CRC
+ *
+ * \param crc - CRC of the preceding data, 0 to start
+ * \param data - Data block
+ * \param length - Number of bytes
+ *
+ * \return CRC-32 value
+ *
+ */
+uint32_t crc32Slice16(uint32_t crc, const unsigned char* data, size_t length)
+{
+	uint32_t one;
+	uint32_t two;
+	uint32_t three;
+	uint32_t four;
+
+	if (!slicesready)
+	{
+		buildSlices();
+	}
+	while (length >= 16)
+	{
+		one = readLE32(data) ^ crc;
+		two = readLE32(data + 4);
+		three = readLE32(data + 8);
+		four = readLE32(data + 12);
+		crc = crc32Slices[15][one & 0xFF] ^ crc32Slices[14][(one >> 8) & 0xFF] ^
+			crc32Slices[13][(one >> 16) & 0xFF] ^ crc32Slices[12][one >> 24] ^
+			crc32Slices[11][two & 0xFF] ^ crc32Slices[10][(two >> 8) & 0xFF] ^
+			crc32Slices[9][(two >> 16) & 0xFF] ^ crc32Slices[8][two >> 24] ^
+			crc32Slices[7][three & 0xFF] ^ crc32Slices[6][(three >> 8) & 0xFF] ^
+			crc32Slices[5][(three >> 16) & 0xFF] ^ crc32Slices[4][three >> 24] ^
+			crc32Slices[3][four & 0xFF] ^ crc32Slices[2][(four >> 8) & 0xFF] ^
+			crc32Slices[1][(four >> 16) & 0xFF] ^ crc32Slices[0][four >> 24];
+		data += 16;
+		length -= 16;
+	}
+	return crc32Slice8(crc, data, length);
+}
+
+#ifdef CRC32_X86_CLMUL
+/**
+ * \brief Carry-less multiplication folding
+ *
+ * Fold 64 bytes per step into four 128 bit lanes, then fold the lanes into
+ * one and reduce it to 32 bits with Barrett reduction. The constants are
+ * x^n mod P(x) for the reflected polynomial ("Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction", Intel 2009).
+ * Needs at least 64 bytes.
+ *
+ * \param crc - CRC of the preceding data
+ * \param data - Data block
+ * \param length - Number of bytes, at least 64
+ *
+ * \return CRC-32 value of the folded part, tail bytes are left to the caller
+ *
+ */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t clmulFold(uint32_t crc, const unsigned char* data, size_t length)
+{
+	static const uint64_t k1k2[2] __attribute__((aligned(16))) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+	static const uint64_t k3k4[2] __attribute__((aligned(16))) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+	static const uint64_t k5k0[2] __attribute__((aligned(16))) = { 0x0163cd6124ULL, 0x0000000000ULL };
+	static const uint64_t poly[2] __attribute__((aligned(16))) = { 0x01db710641ULL, 0x01f7011641ULL };
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+	x1 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+	x2 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+	x3 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+	x4 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+	x0 = _mm_load_si128((const __m128i*)k1k2);
+	data += 64;
+	length -= 64;
+
+	// Fold 64 bytes per step
+	while (length >= 64)
+	{
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+		y5 = _mm_loadu_si128((const __m128i*)(data + 0x00));
+		y6 = _mm_loadu_si128((const __m128i*)(data + 0x10));
+		y7 = _mm_loadu_si128((const __m128i*)(data + 0x20));
+		y8 = _mm_loadu_si128((const __m128i*)(data + 0x30));
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+		data += 64;
+		length -= 64;
+	}
+
+	// Fold the four lanes into one
+	x0 = _mm_load_si128((const __m128i*)k3k4);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// Fold remaining 16 byte blocks
+	while (length >= 16)
+	{
+		x2 = _mm_loadu_si128((const __m128i*)data);
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+		data += 16;
+		length -= 16;
+	}
+
+	// Fold 128 bits to 64 bits
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+	x0 = _mm_loadl_epi64((const __m128i*)k5k0);
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// Barrett reduction to 32 bits
+	x0 = _mm_load_si128((const __m128i*)poly);
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+#endif
+
+/**
+ * \brief Carry-less multiplication CRC
+ *
+ * Fold whole 16 byte blocks with PCLMULQDQ and finish the tail with
+ * slicing-by-16. Without CPU support the whole block uses slicing-by-16.
+ *
+ * \param crc - CRC of the preceding data, 0 to start
+ * \param data - Data block
+ * \param length - Number of bytes
+ *
+ * \return CRC-32 value
+ *
+ */
+uint32_t crc32Clmul(uint32_t crc, const unsigned char* data, size_t length)
+{
+#ifdef CRC32_X86_CLMUL
+	size_t folded;
+
+	if (length >= CLMULMIN && crc32HasClmul())
+	{
+		folded = length & ~(size_t)15;
+		crc = clmulFold(crc, data, folded);
+		data += folded;
+		length -= folded;
+	}
+#endif
+	return crc32Slice16(crc, data, length);
+}
+
+/**
+ * \brief Carry-less multiplication support
+ *
+ * \return 1 if the CPU has PCLMULQDQ and SSE4.1, 0 otherwise
+ *
+ */
+int crc32HasClmul(void)
+{
+#ifdef CRC32_X86_CLMUL
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#else
+	return 0;
+#endif
+}
+
+/**
+ * \brief Dispatched CRC
+ *
+ * Short blocks (time log frames) go to slicing-by-8. Long blocks go
+ * to the engine selected by crc32Init().
+ *
+ * \param crc - CRC of the preceding data, 0 to start
+ * \param data - Data block
+ * \param length - Number of bytes
+ *
+ * \return CRC-32 value
+ *
+ */
+uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t length)
+{
+	if (length < CLMULMIN && slicesready)
+	{
+		return crc32Slice8(crc, data, length);
+	}
+	return engine(crc, data, length);
+}
+
+/**
+ * \brief Select CRC engine
+ *
+ * Build the slicing tables and select the fastest engine for this CPU.
+ * Call once at startup, before any threads use the CRC.
+ *
+ */
+void crc32Init(void)
+{
+	if (!slicesready)
+	{
+		buildSlices();
+	}
+	if (crc32HasClmul())
+	{
+		engine = crc32Clmul;
+		enginename = "clmul";
+	}
+	else
+	{
+		engine = crc32Slice16;
+		enginename = "slice16";
+	}
+}
+
+/**
+ * \brief Selected CRC engine name
+ *
+ * \return "bytewise", "slice16" or "clmul"
+ *
+ */
+const char* crc32Engine(void)
+{
+	return enginename;
+}
@@ -0,0 +1,523 @@
+/*
+ * Capture.c
+ *
+ * Binary capture of receiver bytes, PPS edges and clock corrections
+ *
+ * The capture file starts with a 24 byte header: magic, version and the
+ * CLOCK_MONOTONIC and CLOCK_REALTIME of the start. Every record has an
+ * 8 byte header: type, receiver number, payload length and the time since
+ * the previous record in ns. A longer gap, or a restart appending to an
+ * existing file, writes a time record with both clocks again. All fields
+ * are in host byte order.
+ *
+ * Records are buffered and appended with one write() per cycle, outside
+ * the time critical path. Disk space is reserved in large steps with
+ * fallocate() so that appends do not allocate blocks one by one.
+ *
+ * The reader maps the whole file and decodes it in place, so days of
+ * captured data replay in seconds.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#define _GNU_SOURCE // fallocate()
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Capture.h"
+#include "GPSTime.h"
+
+#define CAPTURE_HEADERSIZE (8 + CAPTURE_TIMESIZE) // Magic, version and the start time
+
+/**
+ * \brief Time of both clocks
+ *
+ * \param monotonic - Return CLOCK_MONOTONIC in ns
+ * \param realtime - Return CLOCK_REALTIME in ns
+ *
+ */
+static void captureNow(int64_t* monotonic, int64_t* realtime)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	*monotonic = (int64_t)now.tv_sec * GPSTIME_NS + now.tv_nsec;
+	if (realtime != NULL)
+	{
+		clock_gettime(CLOCK_REALTIME, &now);
+		*realtime = (int64_t)now.tv_sec * GPSTIME_NS + now.tv_nsec;
+	}
+}
+
+/**
+ * \brief Append the buffer to the file
+ *
+ * Called with the lock held.
+ *
+ * \param capture - Capture
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int captureWrite(struct capture* capture)
+{
+	size_t written = 0;
+	ssize_t count;
+
+	if (capture->size + (off_t)capture->used > capture->allocated)
+	{
+		// Not supported everywhere, appends still work without it
+		if (fallocate(capture->fd, FALLOC_FL_KEEP_SIZE, capture->allocated, CAPTURE_PREALLOCATE) < 0 &&
+			errno != EOPNOTSUPP)
+		{
+			perror("Capture fallocate failed");
+		}
+		capture->allocated += CAPTURE_PREALLOCATE;
+	}
+	while (written < capture->used)
+	{
+		count = write(capture->fd, capture->buffer + written, capture->used - written);
+		if (count < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			perror("Capture write failed");
+			capture->used = 0;
+			return EXIT_FAILURE;
+		}
+		written += count;
+	}
+	capture->size += written;
+	capture->used = 0;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Buffer a record
+ *
+ * Called with the lock held.
+ *
+ * \param capture - Capture
+ * \param type - Record type
+ * \param source - Receiver number
+ * \param payload - Record body
+ * \param length - Body length in bytes
+ * \param now - CLOCK_MONOTONIC of the record in ns
+ *
+ */
+static void captureRecord(struct capture* capture, enum capturetype type, int source,
+	const void* payload, size_t length, int64_t now)
+{
+	unsigned char* record;
+	uint16_t size = (uint16_t)length;
+	uint32_t delta;
+
+	if (capture->used + CAPTURE_RECORDSIZE + length > CAPTURE_BUFFER)
+	{
+		captureWrite(capture);
+	}
+	delta = (uint32_t)(now - capture->last);
+	record = capture->buffer + capture->used;
+	record[0] = (unsigned char)type;
+	record[1] = (unsigned char)source;
+	memcpy(record + 2, &size, sizeof(size));
+	memcpy(record + 4, &delta, sizeof(delta));
+	memcpy(record + CAPTURE_RECORDSIZE, payload, length);
+	capture->used += CAPTURE_RECORDSIZE + length;
+	capture->last = now;
+	capture->records++;
+}
+
+/**
+ * \brief Buffer a time record
+ *
+ * \param capture - Capture
+ * \param monotonic - CLOCK_MONOTONIC in ns
+ * \param realtime - CLOCK_REALTIME in ns
+ *
+ */
+static void captureTime(struct capture* capture, int64_t monotonic, int64_t realtime)
+{
+	unsigned char body[CAPTURE_TIMESIZE];
+
+	memcpy(body, &monotonic, sizeof(monotonic));
+	memcpy(body + 8, &realtime, sizeof(realtime));
+	capture->last = monotonic;
+	captureRecord(capture, CAPTURE_TIME, 0, body, sizeof(body), monotonic);
+}
+
+/**
+ * \brief Start a record now
+ *
+ * Take the lock and write a time record first if the delta would not fit.
+ *
+ * \param capture - Capture
+ *
+ * \return CLOCK_MONOTONIC of the record in ns
+ *
+ */
+static int64_t captureBegin(struct capture* capture)
+{
+	int64_t monotonic;
+	int64_t realtime;
+
+	pthread_mutex_lock(&capture->lock);
+	captureNow(&monotonic, NULL);
+	if (monotonic < capture->last || monotonic - capture->last > UINT32_MAX)
+	{
+		captureNow(&monotonic, &realtime);
+		captureTime(capture, monotonic, realtime);
+	}
+	return monotonic;
+}
+
+/**
+ * \brief Open a capture file for appending
+ *
+ * A new file gets the header, an existing one a time record.
+ *
+ * \param capture - Capture
+ * \param path - Capture file
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int captureOpen(struct capture* capture, const char* path)
+{
+	struct stat info;
+	uint32_t header[2] = {CAPTURE_MAGIC, CAPTURE_VERSION};
+	int64_t monotonic;
+	int64_t realtime;
+
+	capture->used = 0;
+	capture->records = 0;
+	capture->fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (capture->fd < 0)
+	{
+		perror(path);
+		return EXIT_FAILURE;
+	}
+	if (fstat(capture->fd, &info) < 0)
+	{
+		perror("Capture fstat failed");
+		close(capture->fd);
+		return EXIT_FAILURE;
+	}
+	capture->size = info.st_size;
+	capture->allocated = info.st_size;
+	pthread_mutex_init(&capture->lock, NULL);
+
+	captureNow(&monotonic, &realtime);
+	if (capture->size == 0)
+	{
+		memcpy(capture->buffer, header, sizeof(header));
+		memcpy(capture->buffer + 8, &monotonic, sizeof(monotonic));
+		memcpy(capture->buffer + 16, &realtime, sizeof(realtime));
+		capture->used = CAPTURE_HEADERSIZE;
+		capture->last = monotonic;
+	}
+	else
+	{
+		captureTime(capture, monotonic, realtime);
+	}
+	return captureFlush(capture);
+}
+
+/**
+ * \brief Capture bytes read from a receiver
+ *
+ * \param capture - Capture
+ * \param source - Receiver number
+ * \param data - Bytes
+ * \param length - Number of bytes
+ *
+ */
+void captureBytes(struct capture* capture, int source, const unsigned char* data, size_t length)
+{
+	int64_t now = captureBegin(capture);
+
+	captureRecord(capture, CAPTURE_UART, source, data, length, now);
+	pthread_mutex_unlock(&capture->lock);
+}
+
+/**
+ * \brief Capture a PPS edge
+ *
+ * \param capture - Capture
+ * \param source - Receiver number
+ * \param stamp - Edge on CLOCK_REALTIME
+ * \param sequence - Edge sequence number
+ *
+ */
+void captureEdge(struct capture* capture, int source, const struct timespec* stamp, unsigned long sequence)
+{
+	unsigned char body[12];
+	int64_t ns = (int64_t)stamp->tv_sec * GPSTIME_NS + stamp->tv_nsec;
+	uint32_t number = (uint32_t)sequence;
+	int64_t now = captureBegin(capture);
+
+	memcpy(body, &ns, sizeof(ns));
+	memcpy(body + 8, &number, sizeof(number));
+	captureRecord(capture, CAPTURE_EDGE, source, body, sizeof(body), now);
+	pthread_mutex_unlock(&capture->lock);
+}
+
+/**
+ * \brief Capture a frequency correction
+ *
+ * \param capture - Capture
+ * \param frequency - Frequency correction in ppb
+ *
+ */
+void captureFrequency(struct capture* capture, double frequency)
+{
+	int64_t now = captureBegin(capture);
+
+	captureRecord(capture, CAPTURE_FREQUENCY, 0, &frequency, sizeof(frequency), now);
+	pthread_mutex_unlock(&capture->lock);
+}
+
+/**
+ * \brief Capture a clock step
+ *
+ * \param capture - Capture
+ * \param step - Step added to the clock in ns
+ *
+ */
+void captureStep(struct capture* capture, int64_t step)
+{
+	int64_t now = captureBegin(capture);
+
+	captureRecord(capture, CAPTURE_STEP, 0, &step, sizeof(step), now);
+	pthread_mutex_unlock(&capture->lock);
+}
+
+/**
+ * \brief Append the buffered records to the file
+ *
+ * \param capture - Capture
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int captureFlush(struct capture* capture)
+{
+	int result = EXIT_SUCCESS;
+
+	pthread_mutex_lock(&capture->lock);
+	if (capture->used > 0)
+	{
+		result = captureWrite(capture);
+	}
+	pthread_mutex_unlock(&capture->lock);
+	return result;
+}
+
+/**
+ * \brief Flush and close the capture file
+ *
+ * Space reserved past the end is released.
+ *
+ * \param capture - Capture
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int captureClose(struct capture* capture)
+{
+	int result = captureFlush(capture);
+
+	if (ftruncate(capture->fd, capture->size) < 0 || close(capture->fd) < 0)
+	{
+		perror("Capture close failed");
+		result = EXIT_FAILURE;
+	}
+	pthread_mutex_destroy(&capture->lock);
+	printf("Captured %lu records, %lld bytes\n", capture->records, (long long)capture->size);
+	return result;
+}
+
+/**
+ * \brief Open a capture file for reading
+ *
+ * \param reader - Reader
+ * \param path - Capture file
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int captureReaderOpen(struct capturereader* reader, const char* path)
+{
+	struct stat info;
+	uint32_t header[2];
+	void* map;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		perror(path);
+		return EXIT_FAILURE;
+	}
+	if (fstat(fd, &info) < 0 || info.st_size < CAPTURE_HEADERSIZE)
+	{
+		fprintf(stderr, "%s is not a capture file\r\n", path);
+		close(fd);
+		return EXIT_FAILURE;
+	}
+	map = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+	{
+		perror("Capture mmap failed");
+		return EXIT_FAILURE;
+	}
+	madvise(map, info.st_size, MADV_SEQUENTIAL);
+	reader->map = map;
+	reader->size = info.st_size;
+
+	memcpy(header, reader->map, sizeof(header));
+	if (header[0] != CAPTURE_MAGIC || header[1] != CAPTURE_VERSION)
+	{
+		fprintf(stderr, "%s is not a version %d capture file\r\n", path, CAPTURE_VERSION);
+		captureReaderClose(reader);
+		return EXIT_FAILURE;
+	}
+	memcpy(&reader->time, reader->map + 8, sizeof(reader->time));
+	memcpy(&reader->epoch, reader->map + 16, sizeof(reader->epoch));
+	reader->epoch -= reader->time;
+	reader->offset = CAPTURE_HEADERSIZE;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Next record
+ *
+ * Unknown record types are skipped. A record cut short at the end of the
+ * file, e.g. by a power loss, ends the file.
+ *
+ * \param reader - Reader
+ * \param event - Return the record
+ *
+ * \return 1 if a record was returned, 0 at the end of the file
+ *
+ */
+int captureRead(struct capturereader* reader, struct captureevent* event)
+{
+	const unsigned char* record;
+	const unsigned char* body;
+	uint16_t length;
+	uint32_t delta;
+	uint32_t sequence;
+	int64_t ns;
+
+	while (reader->offset + CAPTURE_RECORDSIZE <= reader->size)
+	{
+		record = reader->map + reader->offset;
+		body = record + CAPTURE_RECORDSIZE;
+		memcpy(&length, record + 2, sizeof(length));
+		memcpy(&delta, record + 4, sizeof(delta));
+		if (reader->offset + CAPTURE_RECORDSIZE + length > reader->size)
+		{
+			return 0;
+		}
+		reader->offset += CAPTURE_RECORDSIZE + length;
+		reader->time += delta;
+
+		event->type = record[0];
+		event->source = record[1];
+		switch (event->type)
+		{
+		case CAPTURE_TIME:
+			if (length < CAPTURE_TIMESIZE)
+			{
+				continue;
+			}
+			memcpy(&reader->time, body, sizeof(reader->time));
+			memcpy(&reader->epoch, body + 8, sizeof(reader->epoch));
+			reader->epoch -= reader->time;
+			break;
+		case CAPTURE_UART:
+			event->data = body;
+			event->length = length;
+			break;
+		case CAPTURE_EDGE:
+			if (length < 12)
+			{
+				continue;
+			}
+			memcpy(&ns, body, sizeof(ns));
+			memcpy(&sequence, body + 8, sizeof(sequence));
+			event->stamp.tv_sec = ns / GPSTIME_NS;
+			event->stamp.tv_nsec = ns % GPSTIME_NS;
+			event->sequence = sequence;
+			break;
+		case CAPTURE_FREQUENCY:
+			if (length < sizeof(event->frequency))
+			{
+				continue;
+			}
+			memcpy(&event->frequency, body, sizeof(event->frequency));
+			break;
+		case CAPTURE_STEP:
+			if (length < sizeof(event->step))
+			{
+				continue;
+			}
+			memcpy(&event->step, body, sizeof(event->step));
+			break;
+		default:
+			continue;
+		}
+		event->time = reader->time;
+		event->epoch = reader->epoch;
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * \brief Unmap the capture file
+ *
+ * \param reader - Reader
+ *
+ */
+void captureReaderClose(struct capturereader* reader)
+{
+	munmap((void*)reader->map, reader->size);
+	reader->map = NULL;
+}
+
+/**
+ * \brief Advance a clock model
+ *
+ * Add the frequency correction in effect since the last call. Time going
+ * backwards, e.g. after a restart, only moves the model to the new time.
+ *
+ * \param clock - Clock model
+ * \param now - CLOCK_MONOTONIC in ns
+ *
+ */
+void captureClockAdvance(struct captureclock* clock, int64_t now)
+{
+	if (clock->time != 0 && now > clock->time)
+	{
+		// ppb times ns is 1e-9 ns
+		clock->phase += clock->frequency * (double)(now - clock->time) / GPSTIME_NS;
+	}
+	clock->time = now;
+}
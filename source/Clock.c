@@ -0,0 +1,216 @@
+/*
+ * Clock.c
+ *
+ * System clock adjustment
+ *
+ * All adjustments go to CLOCK_REALTIME through clock_adjtime().
+ * CLOCK_MONOTONIC cannot be set, it follows the frequency adjustments
+ * of CLOCK_REALTIME but never jumps.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#define _GNU_SOURCE // clock_adjtime()
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/timex.h>
+
+#include "Clock.h"
+#include "GPSTime.h"
+
+#define NS_PER_US 1000LL // ns per us
+#define SLEWLIMIT 500000000LL // adjtime() style slew limit in ns. 0.5s
+
+/**
+ * \brief Step the system clock
+ *
+ * Add an offset to CLOCK_REALTIME. Time jumps, so this is only used for
+ * large initial errors.
+ *
+ * \param offset - Offset to add in ns
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int clockStep(int64_t offset)
+{
+	struct timex tx;
+
+	memset(&tx, 0, sizeof(tx));
+	tx.modes = ADJ_SETOFFSET | ADJ_NANO;
+	tx.time.tv_sec = offset / GPSTIME_NS;
+	tx.time.tv_usec = offset % GPSTIME_NS; // ns with ADJ_NANO
+	if (tx.time.tv_usec < 0) // tv_usec must not be negative
+	{
+		tx.time.tv_sec--;
+		tx.time.tv_usec += GPSTIME_NS;
+	}
+	if (clock_adjtime(CLOCK_REALTIME, &tx) < 0)
+	{
+		perror("clock_adjtime step failed:");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Slew the system clock once
+ *
+ * Let the kernel slew CLOCK_REALTIME by an offset like adjtime().
+ * Used by one shot mode, which does not stay around to run the servo.
+ *
+ * \param offset - Offset to add in ns, at most 0.5s
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int clockSlew(int64_t offset)
+{
+	struct timex tx;
+
+	if (llabs(offset) > SLEWLIMIT)
+	{
+		fprintf(stderr, "Slew offset too large: %lld ns\r\n", (long long)offset);
+		return EXIT_FAILURE;
+	}
+	memset(&tx, 0, sizeof(tx));
+	tx.modes = ADJ_OFFSET_SINGLESHOT;
+	tx.offset = offset / NS_PER_US; // us
+	if (clock_adjtime(CLOCK_REALTIME, &tx) < 0)
+	{
+		perror("clock_adjtime slew failed:");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Set system clock frequency adjustment
+ *
+ * \param ppb - Frequency adjustment in ppb, positive speeds the clock up
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int clockSetFrequency(double ppb)
+{
+	struct timex tx;
+
+	memset(&tx, 0, sizeof(tx));
+	tx.modes = ADJ_FREQUENCY;
+	tx.freq = (long)(ppb * 65.536); // Scaled ppm, 16 bit fraction
+	if (clock_adjtime(CLOCK_REALTIME, &tx) < 0)
+	{
+		perror("clock_adjtime frequency failed:");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Mark system clock synchronized
+ *
+ * Clear STA_UNSYNC and publish the error estimate, so that other
+ * programs (and the RTC sync) know the clock is disciplined.
+ *
+ * \param esterror - Estimated error in ns
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int clockSetSynced(int64_t esterror)
+{
+	struct timex tx;
+
+	memset(&tx, 0, sizeof(tx));
+	if (clock_adjtime(CLOCK_REALTIME, &tx) < 0) // Read status
+	{
+		perror("clock_adjtime read failed:");
+		return EXIT_FAILURE;
+	}
+	tx.modes = ADJ_STATUS | ADJ_ESTERROR | ADJ_MAXERROR;
+	tx.status &= ~STA_UNSYNC;
+	tx.esterror = esterror / NS_PER_US;
+	tx.maxerror = esterror / NS_PER_US;
+	if (clock_adjtime(CLOCK_REALTIME, &tx) < 0)
+	{
+		perror("clock_adjtime status failed:");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Another clock at a time stamp
+ *
+ * Convert a time stamp taken with one clock to another clock by reading
+ * both clocks now. The two reads are back to back, so the error is the
+ * read latency plus any frequency difference since the time stamp. Convert
+ * soon after the time stamp.
+ *
+ * \param stamp - Time stamp
+ * \param clock - Clock of the time stamp
+ * \param target - Clock to convert to
+ * \param result - Return the target clock at the time stamp
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int clockAt(const struct timespec* stamp, clockid_t clock, clockid_t target, struct timespec* result)
+{
+	struct timespec now, nowtarget;
+	int64_t delta;
+
+	if (clock == target)
+	{
+		*result = *stamp;
+		return EXIT_SUCCESS;
+	}
+	if (clock_gettime(clock, &now) < 0 || clock_gettime(target, &nowtarget) < 0)
+	{
+		perror("clock_gettime failed:");
+		return EXIT_FAILURE;
+	}
+	delta = (now.tv_sec - stamp->tv_sec) * GPSTIME_NS + (now.tv_nsec - stamp->tv_nsec);
+	delta = (nowtarget.tv_sec * GPSTIME_NS + nowtarget.tv_nsec) - delta;
+	result->tv_sec = delta / GPSTIME_NS;
+	result->tv_nsec = delta % GPSTIME_NS;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief CLOCK_REALTIME at a time stamp
+ *
+ * \param stamp - Time stamp
+ * \param clock - Clock of the time stamp
+ * \param realtime - Return CLOCK_REALTIME at the time stamp
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int clockRealtimeAt(const struct timespec* stamp, clockid_t clock, struct timespec* realtime)
+{
+	return clockAt(stamp, clock, CLOCK_REALTIME, realtime);
+}
+
+/**
+ * \brief CLOCK_MONOTONIC in ns
+ *
+ * \return Time in ns
+ *
+ */
+int64_t clockMonotonicNs(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t)now.tv_sec * GPSTIME_NS + now.tv_nsec;
+}
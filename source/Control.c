@@ -0,0 +1,228 @@
+/*
+ * Control.c
+ *
+ * Control socket
+ *
+ * A Unix stream socket served by the event loop. A client connects, sends
+ * one command line and gets the reply, then the connection is closed:
+ *
+ *  echo status | socat - UNIX-CONNECT:/run/ppstime.sock
+ *
+ * Connections are non-blocking and read only when ready, so a slow client
+ * never delays PPS or UART handling.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#define _GNU_SOURCE // accept4()
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "Control.h"
+
+/**
+ * \brief Close a connection
+ *
+ * \param client - Connection
+ *
+ */
+static void controlDrop(struct controlclient* client)
+{
+	eventLoopRemove(client->control->loop, &client->source);
+	close(client->source.fd);
+	client->source.fd = -1;
+}
+
+/**
+ * \brief Connection readable
+ *
+ * \param context - Connection
+ * \param events - epoll events
+ *
+ */
+static void controlRead(void* context, uint32_t events)
+{
+	struct controlclient* client = context;
+	struct control* control = client->control;
+	ssize_t count;
+	char* end;
+	FILE* reply;
+	int fd;
+
+	(void)events;
+	count = read(client->source.fd, client->command + client->length,
+		CONTROLCOMMANDMAX - 1 - client->length);
+	if (count < 0 && (errno == EAGAIN || errno == EINTR))
+	{
+		return;
+	}
+	if (count <= 0)
+	{
+		controlDrop(client);
+		return;
+	}
+	client->length += count;
+	client->command[client->length] = '\0';
+	end = strpbrk(client->command, "\r\n");
+	if (end == NULL && client->length < CONTROLCOMMANDMAX - 1)
+	{
+		return; // Rest of the line still coming
+	}
+	if (end != NULL)
+	{
+		*end = '\0';
+	}
+
+	// The reply stream owns the descriptor from here
+	eventLoopRemove(control->loop, &client->source);
+	fd = client->source.fd;
+	client->source.fd = -1;
+	reply = fdopen(fd, "w");
+	if (reply == NULL)
+	{
+		close(fd);
+		return;
+	}
+	control->handler(control->context, client->command, reply);
+	fclose(reply);
+}
+
+/**
+ * \brief Listening socket readable
+ *
+ * \param context - Control socket
+ * \param events - epoll events
+ *
+ */
+static void controlAccept(void* context, uint32_t events)
+{
+	struct control* control = context;
+	struct controlclient* client = NULL;
+	int fd;
+	int i;
+
+	(void)events;
+	fd = accept4(control->listen.fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd < 0)
+	{
+		return;
+	}
+	for (i = 0; i < CONTROLCLIENTS; i++)
+	{
+		if (control->clients[i].source.fd < 0)
+		{
+			client = &control->clients[i];
+			break;
+		}
+	}
+	if (client == NULL)
+	{
+		close(fd); // Busy
+		return;
+	}
+	client->source.fd = fd;
+	client->length = 0;
+	if (eventLoopAdd(control->loop, &client->source, EPOLLIN) == EXIT_FAILURE)
+	{
+		close(fd);
+		client->source.fd = -1;
+	}
+}
+
+/**
+ * \brief Open the control socket
+ *
+ * A stale socket file at path is replaced.
+ *
+ * \param control - Control socket
+ * \param loop - Event loop to serve it
+ * \param path - Unix socket path
+ * \param handler - Command handler
+ * \param context - Handler context
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int controlOpen(struct control* control, struct eventloop* loop, const char* path, controlhandler handler, void* context)
+{
+	struct sockaddr_un address;
+	int i;
+
+	memset(control, 0, sizeof(*control));
+	control->path = path;
+	control->loop = loop;
+	control->handler = handler;
+	control->context = context;
+	for (i = 0; i < CONTROLCLIENTS; i++)
+	{
+		control->clients[i].source.fd = -1;
+		control->clients[i].source.handler = controlRead;
+		control->clients[i].source.context = &control->clients[i];
+		control->clients[i].control = control;
+	}
+
+	if (strlen(path) >= sizeof(address.sun_path))
+	{
+		fprintf(stderr, "Socket path too long: %s\r\n", path);
+		return EXIT_FAILURE;
+	}
+	control->listen.fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (control->listen.fd < 0)
+	{
+		perror("Control socket failed:");
+		return EXIT_FAILURE;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	unlink(path);
+	if (bind(control->listen.fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+		listen(control->listen.fd, CONTROLCLIENTS) < 0)
+	{
+		perror(path);
+		close(control->listen.fd);
+		return EXIT_FAILURE;
+	}
+	control->listen.handler = controlAccept;
+	control->listen.context = control;
+	if (eventLoopAdd(loop, &control->listen, EPOLLIN) == EXIT_FAILURE)
+	{
+		close(control->listen.fd);
+		unlink(path);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Close the control socket and its connections
+ *
+ * \param control - Control socket
+ *
+ */
+void controlClose(struct control* control)
+{
+	int i;
+
+	for (i = 0; i < CONTROLCLIENTS; i++)
+	{
+		if (control->clients[i].source.fd >= 0)
+		{
+			controlDrop(&control->clients[i]);
+		}
+	}
+	eventLoopRemove(control->loop, &control->listen);
+	close(control->listen.fd);
+	unlink(control->path);
+}
@@ -0,0 +1,137 @@
+/*
+ * Drift.c
+ *
+ * Persistent oscillator frequency
+ *
+ * The drift file is one text line: frequency correction in ppb, its
+ * uncertainty in ppb and the Unix time when the clock was last locked,
+ * e.g. "-1234.567 3.210 1791849600". It is written to a temporary file
+ * next to it, synced and renamed over the old one, so a crash or power
+ * loss leaves either the old or the new file, never half of one.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "Drift.h"
+
+/**
+ * \brief Read the drift file
+ *
+ * \param path - Drift file
+ * \param drift - Return the contents
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if missing or malformed
+ *
+ */
+int driftLoad(const char* path, struct drift* drift)
+{
+	FILE* file;
+	long long time;
+	int fields;
+
+	file = fopen(path, "r");
+	if (file == NULL)
+	{
+		return EXIT_FAILURE;
+	}
+	fields = fscanf(file, "%lf %lf %lld", &drift->frequency, &drift->uncertainty, &time);
+	fclose(file);
+	if (fields != 3)
+	{
+		fprintf(stderr, "Drift file %s is malformed\r\n", path);
+		return EXIT_FAILURE;
+	}
+	drift->time = time;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Sync the directory of a file
+ *
+ * Makes a rename in the directory durable.
+ *
+ * \param path - File in the directory
+ *
+ */
+static void driftSyncDirectory(const char* path)
+{
+	char directory[PATH_MAX];
+	const char* slash = strrchr(path, '/');
+	int fd;
+
+	if (slash == NULL)
+	{
+		strcpy(directory, ".");
+	}
+	else if (slash == path)
+	{
+		strcpy(directory, "/");
+	}
+	else
+	{
+		snprintf(directory, sizeof(directory), "%.*s", (int)(slash - path), path);
+	}
+	fd = open(directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd >= 0)
+	{
+		fsync(fd);
+		close(fd);
+	}
+}
+
+/**
+ * \brief Write the drift file atomically
+ *
+ * \param path - Drift file
+ * \param drift - Contents
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int driftSave(const char* path, const struct drift* drift)
+{
+	char temporary[PATH_MAX];
+	FILE* file;
+	int failed;
+
+	if (snprintf(temporary, sizeof(temporary), "%s%s", path, DRIFT_TMPSUFFIX) >= (int)sizeof(temporary))
+	{
+		fprintf(stderr, "Drift file path too long\r\n");
+		return EXIT_FAILURE;
+	}
+	file = fopen(temporary, "w");
+	if (file == NULL)
+	{
+		perror(temporary);
+		return EXIT_FAILURE;
+	}
+	fprintf(file, "%.3f %.3f %lld\n", drift->frequency, drift->uncertainty, (long long)drift->time);
+	failed = (fflush(file) != 0 || fsync(fileno(file)) < 0);
+	if (fclose(file) != 0 || failed)
+	{
+		perror("Drift file write failed");
+		unlink(temporary);
+		return EXIT_FAILURE;
+	}
+	if (rename(temporary, path) < 0)
+	{
+		perror("Drift file rename failed");
+		unlink(temporary);
+		return EXIT_FAILURE;
+	}
+	driftSyncDirectory(path);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+/*
+ * Estimator.c
+ *
+ * Windowed offset and frequency estimator
+ *
+ * A single PPS time stamp can be late by scheduler jitter. The estimator
+ * keeps a window of (reference time, offset) samples and fits a line to
+ * them. Outliers are rejected against a robust Theil-Sen line: the median
+ * of pairwise slopes and the median intercept, with a limit of
+ * ESTIMATOR_REJECT times the scaled median absolute deviation of the
+ * residuals. A least squares fit over the remaining samples gives the
+ * offset at the newest sample, the frequency and a confidence bound, two
+ * standard errors of the predicted offset. The caller corrects the clock
+ * only when the bound is small enough.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "Estimator.h"
+#include "GPSTime.h"
+
+/**
+ * \brief Initialize estimator
+ *
+ * Set the default window and confidence bound and clear the samples.
+ * Configuration fields may be changed after this call.
+ *
+ * \param estimator - Estimator to initialize
+ *
+ */
+void estimatorInit(struct estimator* estimator)
+{
+	estimator->window = ESTIMATOR_WINDOW;
+	estimator->confidence = ESTIMATOR_CONFIDENCE;
+	estimator->outliers = 0;
+	estimatorReset(estimator);
+}
+
+/**
+ * \brief Drop all samples
+ *
+ * \param estimator - Estimator
+ *
+ */
+void estimatorReset(struct estimator* estimator)
+{
+	estimator->count = 0;
+	estimator->next = 0;
+	estimator->inliers = 0;
+	estimator->rejected = 0;
+	estimator->estimate = 0;
+	estimator->frequency = 0.0;
+	estimator->bound = INT64_MAX;
+}
+
+static int compareDouble(const void* a, const void* b)
+{
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+
+	return (x > y) - (x < y);
+}
+
+/**
+ * \brief Median, the values are reordered
+ *
+ * \param values - Values
+ * \param count - Number of values, at least 1
+ *
+ * \return Median
+ *
+ */
+static double median(double* values, int count)
+{
+	qsort(values, count, sizeof(values[0]), compareDouble);
+	if (count % 2)
+	{
+		return values[count / 2];
+	}
+	return (values[count / 2 - 1] + values[count / 2]) / 2.0;
+}
+
+/**
+ * \brief Add a sample and estimate
+ *
+ * Times and offsets are taken relative to the newest sample, so the fit
+ * works on small doubles.
+ *
+ * \param estimator - Estimator
+ * \param time - Reference time of the sample in ns
+ * \param offset - Measured offset in ns
+ *
+ * \return 1 if the estimate is within the confidence bound, 0 otherwise
+ *
+ */
+int estimatorSample(struct estimator* estimator, int64_t time, int64_t offset)
+{
+	double x[ESTIMATORMAX], y[ESTIMATORMAX], residual[ESTIMATORMAX];
+	double scratch[ESTIMATORMAX * (ESTIMATORMAX - 1) / 2];
+	int inlier[ESTIMATORMAX];
+	double slope, intercept, center, limit;
+	double sx, sy, sxx, sxy, xmean, ssr, se;
+	int window = estimator->window;
+	int newest;
+	int count = 0;
+	int n = 0;
+	int i, j;
+
+	if (window < 1)
+	{
+		window = 1;
+	}
+	if (window > ESTIMATORMAX)
+	{
+		window = ESTIMATORMAX;
+	}
+
+	// Store the sample
+	newest = estimator->next;
+	estimator->time[newest] = time;
+	estimator->offset[newest] = offset;
+	estimator->next = (estimator->next + 1) % window;
+	if (estimator->count < window)
+	{
+		estimator->count++;
+	}
+
+	// A window of one or two has nothing to filter, use the sample as is
+	if (window < 3)
+	{
+		estimator->inliers = 1;
+		estimator->rejected = 0;
+		estimator->estimate = offset;
+		estimator->frequency = 0.0;
+		estimator->bound = 0;
+		return 1;
+	}
+
+	for (i = 0; i < estimator->count; i++)
+	{
+		x[i] = (double)(estimator->time[i] - time) / GPSTIME_NS;
+		y[i] = (double)(estimator->offset[i] - offset);
+	}
+
+	// Theil-Sen line: median pairwise slope and median intercept
+	for (i = 0; i < estimator->count; i++)
+	{
+		for (j = i + 1; j < estimator->count; j++)
+		{
+			if (x[j] != x[i])
+			{
+				scratch[count++] = (y[j] - y[i]) / (x[j] - x[i]);
+			}
+		}
+	}
+	slope = count > 0 ? median(scratch, count) : 0.0;
+	for (i = 0; i < estimator->count; i++)
+	{
+		scratch[i] = y[i] - slope * x[i];
+	}
+	intercept = median(scratch, estimator->count);
+
+	// Reject samples further than ESTIMATOR_REJECT robust deviations
+	for (i = 0; i < estimator->count; i++)
+	{
+		residual[i] = y[i] - (intercept + slope * x[i]);
+		scratch[i] = residual[i];
+	}
+	center = median(scratch, estimator->count);
+	for (i = 0; i < estimator->count; i++)
+	{
+		scratch[i] = fabs(residual[i] - center);
+	}
+	limit = median(scratch, estimator->count);
+	if (limit < ESTIMATOR_MADFLOOR)
+	{
+		limit = ESTIMATOR_MADFLOOR;
+	}
+	limit *= 1.4826 * ESTIMATOR_REJECT;
+
+	// Least squares over the inliers
+	sx = sy = sxx = sxy = 0.0;
+	for (i = 0; i < estimator->count; i++)
+	{
+		inlier[i] = fabs(residual[i] - center) <= limit;
+		if (i == newest)
+		{
+			estimator->rejected = !inlier[i];
+		}
+		if (inlier[i])
+		{
+			n++;
+			sx += x[i];
+			sy += y[i];
+		}
+	}
+	estimator->inliers = n;
+	estimator->outliers += estimator->rejected;
+	if (n < ESTIMATOR_MINSAMPLES || n < 3)
+	{
+		estimator->bound = INT64_MAX;
+		return 0;
+	}
+	xmean = sx / n;
+	for (i = 0; i < estimator->count; i++)
+	{
+		if (inlier[i])
+		{
+			sxx += (x[i] - xmean) * (x[i] - xmean);
+			sxy += (x[i] - xmean) * (y[i] - sy / n);
+		}
+	}
+	slope = sxx > 0.0 ? sxy / sxx : 0.0;
+	intercept = sy / n - slope * xmean;
+	ssr = 0.0;
+	for (i = 0; i < estimator->count; i++)
+	{
+		if (inlier[i])
+		{
+			ssr += (y[i] - intercept - slope * x[i]) * (y[i] - intercept - slope * x[i]);
+		}
+	}
+
+	// Standard error of the line at the newest sample, x = 0
+	se = sqrt(ssr / (n - 2)) * sqrt(1.0 / n + (sxx > 0.0 ? xmean * xmean / sxx : 0.0));
+	estimator->estimate = offset + (int64_t)llround(intercept);
+	estimator->frequency = slope; // ns/s is ppb
+	estimator->bound = (int64_t)ceil(2.0 * se);
+	return estimator->bound <= estimator->confidence;
+}
@@ -0,0 +1,229 @@
+/*
+ * EventLoop.c
+ *
+ * epoll event loop with timerfd deadlines
+ *
+ * Every input is a file descriptor: the UART, the PPS line events, timers
+ * and sockets. eventLoopRun() sleeps in one epoll_wait() and calls the
+ * handler of each ready descriptor, so whatever arrives first is handled
+ * first and nothing waits behind a blocking call. Timeouts are timerfds
+ * armed with absolute CLOCK_MONOTONIC deadlines, so they do not stretch
+ * with oversleeping and periodic timers do not drift.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <errno.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+#include "EventLoop.h"
+#include "GPSTime.h"
+
+/**
+ * \brief Create the event loop
+ *
+ * \param loop - Event loop
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int eventLoopInit(struct eventloop* loop)
+{
+	loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (loop->epfd < 0)
+	{
+		perror("epoll_create1 failed:");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Watch a file descriptor
+ *
+ * The source must stay valid until removed.
+ *
+ * \param loop - Event loop
+ * \param source - File descriptor and handler
+ * \param events - epoll events, e.g. EPOLLIN
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int eventLoopAdd(struct eventloop* loop, struct eventsource* source, uint32_t events)
+{
+	struct epoll_event event;
+
+	memset(&event, 0, sizeof(event));
+	event.events = events;
+	event.data.ptr = source;
+	if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, source->fd, &event) < 0)
+	{
+		perror("epoll_ctl add failed:");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Stop watching a file descriptor
+ *
+ * \param loop - Event loop
+ * \param source - Watched source
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int eventLoopRemove(struct eventloop* loop, struct eventsource* source)
+{
+	if (epoll_ctl(loop->epfd, EPOLL_CTL_DEL, source->fd, NULL) < 0)
+	{
+		perror("epoll_ctl delete failed:");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Wait for and handle ready file descriptors once
+ *
+ * Returns after the handlers ran or a signal interrupted the wait, so the
+ * caller can check its signal flags.
+ *
+ * \param loop - Event loop
+ *
+ * \return EXIT_SUCCESS on success or signal, EXIT_FAILURE on failure
+ *
+ */
+int eventLoopRun(struct eventloop* loop)
+{
+	struct epoll_event events[EVENTLOOPMAX];
+	struct eventsource* source;
+	int count;
+	int i;
+
+	count = epoll_wait(loop->epfd, events, EVENTLOOPMAX, -1);
+	if (count < 0)
+	{
+		if (errno == EINTR)
+		{
+			return EXIT_SUCCESS;
+		}
+		perror("epoll_wait failed:");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < count; i++)
+	{
+		source = events[i].data.ptr;
+		source->handler(source->context, events[i].events);
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Close the event loop
+ *
+ * \param loop - Event loop
+ *
+ */
+void eventLoopClose(struct eventloop* loop)
+{
+	close(loop->epfd);
+	loop->epfd = -1;
+}
+
+/**
+ * \brief Create a CLOCK_MONOTONIC timer
+ *
+ * \return timerfd, -1 on failure
+ *
+ */
+int eventTimerCreate(void)
+{
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	if (fd < 0)
+	{
+		perror("timerfd_create failed:");
+	}
+	return fd;
+}
+
+/**
+ * \brief Arm a timer at an absolute deadline
+ *
+ * \param fd - timerfd
+ * \param deadline - CLOCK_MONOTONIC deadline in ns
+ * \param interval - Period in ns after the deadline, 0 = once
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int eventTimerArm(int fd, int64_t deadline, int64_t interval)
+{
+	struct itimerspec spec;
+
+	spec.it_value.tv_sec = deadline / GPSTIME_NS;
+	spec.it_value.tv_nsec = deadline % GPSTIME_NS;
+	spec.it_interval.tv_sec = interval / GPSTIME_NS;
+	spec.it_interval.tv_nsec = interval % GPSTIME_NS;
+	if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0)
+	{
+		perror("timerfd_settime failed:");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Disarm a timer
+ *
+ * An expiration not read yet is discarded too.
+ *
+ * \param fd - timerfd
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int eventTimerDisarm(int fd)
+{
+	struct itimerspec spec;
+
+	memset(&spec, 0, sizeof(spec));
+	if (timerfd_settime(fd, 0, &spec, NULL) < 0)
+	{
+		perror("timerfd_settime failed:");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Read timer expirations
+ *
+ * \param fd - timerfd
+ *
+ * \return Number of expirations since the last read, 0 if none
+ *
+ */
+uint64_t eventTimerRead(int fd)
+{
+	uint64_t expirations;
+
+	if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+	{
+		return 0;
+	}
+	return expirations;
+}
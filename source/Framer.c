@@ -0,0 +1,350 @@
+/*
+ * Framer.c
+ *
+ * Streaming framer for NovAtel ASCII and binary logs
+ *
+ * Bytes are written to a ring buffer as they arrive from the UART, in
+ * pieces of any size. framerNext() scans only the new bytes and returns a
+ * frame as soon as its "*CRC\r" has arrived, so there is no fixed wait for
+ * the log. A frame is "#header;data*xxxxxxxx\r\n" or a binary log starting
+ * with the sync bytes 0xAA 0x44 0x12, whose length comes from its header.
+ * Only the frame boundaries are found here, the CRC is checked by the
+ * parser in the same pass as the fields. Anything outside frames, ASCII
+ * frames without "*" before the CRC, binary frames with a bad header and
+ * ASCII frames cut short by a new '#' are dropped and the framer
+ * synchronizes again on the next '#' or 0xAA.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Framer.h"
+#include "tools.h"
+
+#define RINGMASK (FRAMERSIZE - 1)
+#define CRCDIGITS 8 // Hex digits in the CRC after '*'
+#define BINSYNC1 0xAA // Binary log sync bytes
+#define BINSYNC2 0x44
+#define BINSYNC3 0x12
+#define BINLENGTHS 10 // Bytes needed to know the binary frame length
+#define BINHEADERMIN 28 // Binary header length
+#define BINCRCSIZE 4 // Binary CRC bytes after the message
+
+/**
+ * \brief Initialize framer
+ *
+ * Drop buffered data and clear statistics.
+ *
+ * \param framer - Framer
+ *
+ */
+void framerInit(struct framer* framer)
+{
+	framerReset(framer);
+	framer->frames = 0;
+	framer->malformed = 0;
+	framer->oversize = 0;
+	framer->garbage = 0;
+}
+
+/**
+ * \brief Reset framer
+ *
+ * Drop buffered data, statistics are kept.
+ *
+ * \param framer - Framer
+ *
+ */
+void framerReset(struct framer* framer)
+{
+	framer->head = 0;
+	framer->tail = 0;
+	framer->scan = 0;
+	framer->insync = 0;
+	framer->binary = 0;
+	framer->frame[0] = '\0';
+}
+
+/**
+ * \brief Free contiguous space in the ring
+ *
+ * Return where the next bytes can be written directly, e.g. by read().
+ * Call framerCommit() with the number of bytes written.
+ *
+ * \param framer - Framer
+ * \param size - Return the contiguous free space in bytes
+ *
+ * \return Pointer to the free space
+ *
+ */
+unsigned char* framerSpace(struct framer* framer, size_t* size)
+{
+	unsigned int used = framer->head - framer->tail;
+	unsigned int offset = framer->head & RINGMASK;
+	unsigned int free = FRAMERSIZE - used;
+
+	if (free > FRAMERSIZE - offset)
+	{
+		free = FRAMERSIZE - offset; // Up to the end of the ring
+	}
+	*size = free;
+	return &framer->ring[offset];
+}
+
+/**
+ * \brief Commit bytes written to the ring
+ *
+ * \param framer - Framer
+ * \param count - Number of bytes written at framerSpace()
+ *
+ */
+void framerCommit(struct framer* framer, size_t count)
+{
+	framer->head += count;
+}
+
+/**
+ * \brief Copy bytes to the ring
+ *
+ * \param framer - Framer
+ * \param data - Received bytes
+ * \param count - Number of bytes
+ *
+ * \return Number of bytes copied, less than count if the ring is full
+ *
+ */
+size_t framerWrite(struct framer* framer, const unsigned char* data, size_t count)
+{
+	size_t written = 0;
+	size_t space;
+	unsigned char* dest;
+
+	while (written < count)
+	{
+		dest = framerSpace(framer, &space);
+		if (space == 0)
+		{
+			break;
+		}
+		if (space > count - written)
+		{
+			space = count - written;
+		}
+		memcpy(dest, data + written, space);
+		framerCommit(framer, space);
+		written += space;
+	}
+	return written;
+}
+
+/**
+ * \brief Drop the current frame candidate
+ *
+ * Skip the '#' or 0xAA at tail and synchronize again on the next one.
+ *
+ * \param framer - Framer
+ *
+ */
+static void framerResync(struct framer* framer)
+{
+	framer->tail++;
+	framer->scan = framer->tail;
+	framer->insync = 0;
+}
+
+/**
+ * \brief Byte at an offset from the frame start
+ *
+ * \param framer - Framer
+ * \param offset - Offset from tail
+ *
+ * \return Byte
+ *
+ */
+static inline unsigned char framerByte(const struct framer* framer, unsigned int offset)
+{
+	return framer->ring[(framer->tail + offset) & RINGMASK];
+}
+
+/**
+ * \brief Copy the frame candidate out of the ring
+ *
+ * \param framer - Framer
+ * \param length - Frame length
+ *
+ */
+static void framerCopy(struct framer* framer, unsigned int length)
+{
+	unsigned int offset = framer->tail & RINGMASK;
+	unsigned int first = FRAMERSIZE - offset;
+
+	if (first >= length)
+	{
+		memcpy(framer->frame, &framer->ring[offset], length);
+	}
+	else
+	{
+		memcpy(framer->frame, &framer->ring[offset], first);
+		memcpy(framer->frame + first, framer->ring, length - first);
+	}
+	framer->frame[length] = '\0';
+}
+
+/**
+ * \brief Next binary frame
+ *
+ * The candidate at tail starts with 0xAA. Check the other sync bytes and
+ * take the length from the header. The CRC follows the message.
+ *
+ * \param framer - Framer
+ * \param length - Return the frame length including the CRC
+ *
+ * \return 1 if a frame is complete, 0 if more data is needed, -1 to resync
+ *
+ */
+static int framerBinary(struct framer* framer, unsigned int* length)
+{
+	unsigned int available = framer->head - framer->tail;
+	unsigned int size;
+
+	if ((available > 1 && framerByte(framer, 1) != BINSYNC2) ||
+		(available > 2 && framerByte(framer, 2) != BINSYNC3))
+	{
+		return -1;
+	}
+	if (available < BINLENGTHS)
+	{
+		return 0;
+	}
+	if (framerByte(framer, 3) < BINHEADERMIN)
+	{
+		framer->malformed++;
+		return -1;
+	}
+	size = framerByte(framer, 3) + (framerByte(framer, 8) | (framerByte(framer, 9) << 8)) + BINCRCSIZE;
+	if (size > FRAMEMAX)
+	{
+		framer->oversize++;
+		return -1;
+	}
+	if (available < size)
+	{
+		return 0;
+	}
+
+	framerCopy(framer, size);
+	*length = size;
+	return 1;
+}
+
+/**
+ * \brief Get the next complete frame
+ *
+ * Scan the bytes received since the last call. Return as soon as a frame
+ * is complete. The frame stays valid until the next call.
+ *
+ * \param framer - Framer
+ * \param frame - Return the frame, ASCII frames are NUL terminated
+ * \param length - Return the frame length, '#' to '\r' or sync to CRC
+ *
+ * \return 1 if a frame was returned, 0 if more data is needed
+ *
+ */
+int framerNext(struct framer* framer, char** frame, size_t* length)
+{
+	unsigned int size;
+	unsigned char c;
+	int ret;
+
+	while (framer->scan != framer->head)
+	{
+		c = framer->ring[framer->scan & RINGMASK];
+
+		if (!framer->insync)
+		{
+			// Skip to the next '#' or 0xAA. A '\n' after a frame is expected
+			framer->scan++;
+			if (c == '#' || c == BINSYNC1)
+			{
+				framer->tail = framer->scan - 1;
+				framer->insync = 1;
+				framer->binary = (c == BINSYNC1);
+			}
+			else
+			{
+				framer->tail = framer->scan;
+				if (c != '\n')
+				{
+					framer->garbage++;
+				}
+			}
+			continue;
+		}
+
+		if (framer->binary)
+		{
+			ret = framerBinary(framer, &size);
+			if (ret == 0)
+			{
+				framer->scan = framer->head; // Wait for the rest of the frame
+				break;
+			}
+			if (ret < 0)
+			{
+				framerResync(framer);
+				continue;
+			}
+			framer->tail += size;
+			framer->scan = framer->tail;
+			framer->insync = 0;
+			framer->frames++;
+			*frame = framer->frame;
+			*length = size;
+			return 1;
+		}
+
+		size = framer->scan - framer->tail + 1;
+		if (size > FRAMEMAX)
+		{
+			framer->oversize++;
+			framerResync(framer);
+			continue;
+		}
+		if (c == '#' && size > 1)
+		{
+			// Frame cut short, the new one starts here
+			framer->garbage += size - 1;
+			framer->tail = framer->scan;
+			continue;
+		}
+		framer->scan++;
+		if (c != '\r')
+		{
+			continue;
+		}
+
+		// "*xxxxxxxx\r" ends the frame
+		if (size > CRCDIGITS + 2 &&
+			framer->ring[(framer->scan - CRCDIGITS - 2) & RINGMASK] == '*')
+		{
+			framerCopy(framer, size);
+			framer->tail = framer->scan;
+			framer->insync = 0;
+			framer->frames++;
+			*frame = framer->frame;
+			*length = size;
+			return 1;
+		}
+		framer->malformed++;
+		framerResync(framer);
+	}
+	return 0;
+}
@@ -0,0 +1,251 @@
+/*
+ * GPSTime.c
+ *
+ * Fixed point GPS time
+ *
+ * GPS time is kept as integer nanoseconds since the GPS epoch. Parsing,
+ * offsets and the conversion to a Unix timespec are exact integer
+ * operations, so no nanoseconds are lost at GPS epoch magnitudes and no
+ * soft float emulation is needed on the BeagleBone build.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "GPSTime.h"
+
+#define MAXDIGITS 18 // Significant digits that fit int64_t
+#define MAXEXPONENT 30 // Largest accepted decimal exponent
+
+/**
+ * \brief Parse decimal seconds to nanoseconds
+ *
+ * Parse "515163.000", "-17.99999999630" or "-2.501488425e-09" to integer
+ * nanoseconds without strtold. The digits are collected into an integer
+ * mantissa with a decimal exponent and scaled once, rounding to the
+ * nearest nanosecond. Digits beyond MAXDIGITS are not significant.
+ *
+ * \param start - First character of the number
+ * \param end - One past the last character of the number
+ * \param value - Return the value in ns
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if not a number or out of range
+ *
+ */
+int gpsTimeParseDecimal(const char* start, const char* end, int64_t* value)
+{
+	int negative = 0;
+	int64_t mantissa = 0;
+	int64_t divisor;
+	long exponent = 9; // Mantissa is in 10^-9 s units before fraction and exponent
+	long exp10 = 0;
+	int expnegative = 0;
+	int digits = 0;
+	int fraction = 0;
+	int seen = 0;
+
+	if (start < end && (*start == '-' || *start == '+'))
+	{
+		negative = (*start == '-');
+		start++;
+	}
+	for (; start < end; start++)
+	{
+		if (*start >= '0' && *start <= '9')
+		{
+			seen = 1;
+			if (digits < MAXDIGITS)
+			{
+				if (mantissa != 0 || *start != '0')
+				{
+					digits++;
+				}
+				mantissa = mantissa * 10 + (*start - '0');
+				if (fraction)
+				{
+					exponent--;
+				}
+			}
+			else if (!fraction)
+			{
+				exponent++; // Integer digit beyond precision
+			}
+		}
+		else if (*start == '.' && !fraction)
+		{
+			fraction = 1;
+		}
+		else if ((*start == 'e' || *start == 'E') && seen)
+		{
+			start++;
+			if (start < end && (*start == '-' || *start == '+'))
+			{
+				expnegative = (*start == '-');
+				start++;
+			}
+			if (start == end)
+			{
+				return EXIT_FAILURE;
+			}
+			for (; start < end; start++)
+			{
+				if (*start < '0' || *start > '9' || exp10 > MAXEXPONENT)
+				{
+					return EXIT_FAILURE;
+				}
+				exp10 = exp10 * 10 + (*start - '0');
+			}
+			if (exp10 > MAXEXPONENT)
+			{
+				return EXIT_FAILURE;
+			}
+			exponent += expnegative ? -exp10 : exp10;
+			break;
+		}
+		else
+		{
+			return EXIT_FAILURE;
+		}
+	}
+	if (!seen)
+	{
+		return EXIT_FAILURE;
+	}
+
+	// Scale the mantissa to ns
+	for (; exponent > 0; exponent--)
+	{
+		if (mantissa > INT64_MAX / 10)
+		{
+			return EXIT_FAILURE;
+		}
+		mantissa *= 10;
+	}
+	if (exponent < 0)
+	{
+		if (exponent < -MAXDIGITS)
+		{
+			mantissa = 0;
+		}
+		else
+		{
+			for (divisor = 1; exponent < 0; exponent++)
+			{
+				divisor *= 10;
+			}
+			mantissa = (mantissa + divisor / 2) / divisor;
+		}
+	}
+	*value = negative ? -mantissa : mantissa;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief GPS time from week and time of week
+ *
+ * Time of week may be negative or past the end of the week, e.g. after
+ * adding offsets. The result is the same instant.
+ *
+ * \param week - GPS week
+ * \param weekns - Time of week in ns
+ * \param time - Return GPS time
+ *
+ */
+void gpsTimeFromWeek(int week, int64_t weekns, struct gpstime* time)
+{
+	time->ns = (int64_t)week * GPSTIME_WEEKSECONDS * GPSTIME_NS + weekns;
+}
+
+/**
+ * \brief Normalized week and time of week
+ *
+ * \param time - GPS time
+ * \param week - Return GPS week
+ * \param weekns - Return time of week in ns, 0 to one week
+ *
+ */
+void gpsTimeToWeek(const struct gpstime* time, int* week, int64_t* weekns)
+{
+	const int64_t weeklength = GPSTIME_WEEKSECONDS * GPSTIME_NS;
+	int64_t w = time->ns / weeklength;
+	int64_t rest = time->ns % weeklength;
+
+	// Division truncates towards zero, time of week must not be negative
+	if (rest < 0)
+	{
+		rest += weeklength;
+		w--;
+	}
+	*week = (int)w;
+	*weekns = rest;
+}
+
+/**
+ * \brief Add an offset
+ *
+ * \param time - GPS time to change
+ * \param ns - Offset in ns, may be negative
+ *
+ */
+void gpsTimeAdd(struct gpstime* time, int64_t ns)
+{
+	time->ns += ns;
+}
+
+/**
+ * \brief Difference of two times
+ *
+ * \param a - GPS time
+ * \param b - GPS time
+ *
+ * \return a - b in ns
+ *
+ */
+int64_t gpsTimeDiff(const struct gpstime* a, const struct gpstime* b)
+{
+	return a->ns - b->ns;
+}
+
+/**
+ * \brief GPS epoch time to Unix epoch timespec
+ *
+ * No leap seconds are applied, the time must already be UTC counted from
+ * the GPS epoch for the result to be Unix time.
+ *
+ * \param time - GPS time
+ * \param ts - Return Unix time, tv_nsec normalized to 0-999999999
+ *
+ */
+void gpsTimeToTimespec(const struct gpstime* time, struct timespec* ts)
+{
+	int64_t seconds = time->ns / GPSTIME_NS;
+	int64_t ns = time->ns % GPSTIME_NS;
+
+	if (ns < 0)
+	{
+		ns += GPSTIME_NS;
+		seconds--;
+	}
+	ts->tv_sec = (time_t)(seconds + GPSTIME_UNIXSECONDS);
+	ts->tv_nsec = (long)ns;
+}
+
+/**
+ * \brief Unix epoch timespec to GPS epoch time
+ *
+ * \param ts - Unix time
+ * \param time - Return time since the GPS epoch
+ *
+ */
+void gpsTimeFromTimespec(const struct timespec* ts, struct gpstime* time)
+{
+	time->ns = ((int64_t)ts->tv_sec - GPSTIME_UNIXSECONDS) * GPSTIME_NS + ts->tv_nsec;
+}
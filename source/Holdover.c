@@ -0,0 +1,201 @@
+/*
+ * Holdover.c
+ *
+ * Oscillator frequency model for holdover
+ *
+ * While the servo is locked its integrator is the frequency error of the
+ * local oscillator. Every locked sample goes into a line fit of frequency
+ * over time with exponential forgetting, so the fit follows the aging
+ * trend of the last hour or so. When samples stop, the fit predicts the
+ * frequency to steer with, and the error bound grows from the bound at
+ * the last sample by the frequency uncertainty and the unmodelled wander.
+ * When samples return the servo continues from the predicted frequency,
+ * so nothing jumps.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "GPSTime.h"
+#include "Holdover.h"
+
+/**
+ * \brief Initialize holdover
+ *
+ * \param holdover - Holdover to initialize
+ *
+ */
+void holdoverInit(struct holdover* holdover)
+{
+	memset(holdover, 0, sizeof(*holdover));
+}
+
+/**
+ * \brief Fit time of a monotonic time
+ *
+ * \param holdover - Trained holdover
+ * \param now - CLOCK_MONOTONIC in ns
+ *
+ * \return Seconds since the fit origin
+ *
+ */
+static double holdoverTime(const struct holdover* holdover, int64_t now)
+{
+	return (double)(now - holdover->origin) / GPSTIME_NS;
+}
+
+/**
+ * \brief Frequency of the fit at a time
+ *
+ * The trend is used only when the fit covers enough samples, before that
+ * the weighted mean is the best guess.
+ *
+ * \param holdover - Trained holdover
+ * \param t - Fit time in s
+ *
+ * \return Frequency in ppb
+ *
+ */
+static double holdoverFit(const struct holdover* holdover, double t)
+{
+	double mean = holdover->sumf / holdover->weight;
+	double meant = holdover->sumt / holdover->weight;
+	double spread = holdover->weight * holdover->sumtt - holdover->sumt * holdover->sumt;
+
+	if (holdover->weight < HOLDOVER_AGINGMIN || spread <= 0.0)
+	{
+		return mean;
+	}
+	return mean + (holdover->weight * holdover->sumtf - holdover->sumt * holdover->sumf) / spread * (t - meant);
+}
+
+/**
+ * \brief Record a servo sample
+ *
+ * Every sample postpones holdover, only locked samples train the fit.
+ *
+ * \param holdover - Holdover
+ * \param now - CLOCK_MONOTONIC of the sample in ns
+ * \param frequency - Oscillator frequency correction in ppb, the negated integrator
+ * \param bound - Error bound of the clock in ns
+ * \param locked - The servo is locked
+ *
+ */
+void holdoverSample(struct holdover* holdover, int64_t now, double frequency, int64_t bound, int locked)
+{
+	double decay = 1.0 - 1.0 / HOLDOVER_MEMORY;
+	double t;
+
+	holdover->lastsample = now;
+	holdover->lastbound = bound;
+	if (!locked)
+	{
+		return;
+	}
+	if (holdover->origin == 0)
+	{
+		holdover->origin = now;
+	}
+	t = holdoverTime(holdover, now);
+	if (holdover->weight > 0.0)
+	{
+		holdover->scatter += (fabs(frequency - holdoverFit(holdover, t)) - holdover->scatter) / HOLDOVER_SCATTERWEIGHT;
+	}
+	holdover->weight = holdover->weight * decay + 1.0;
+	holdover->sumt = holdover->sumt * decay + t;
+	holdover->sumf = holdover->sumf * decay + frequency;
+	holdover->sumtt = holdover->sumtt * decay + t * t;
+	holdover->sumtf = holdover->sumtf * decay + t * frequency;
+}
+
+/**
+ * \brief Predicted oscillator frequency correction
+ *
+ * \param holdover - Trained holdover
+ * \param now - CLOCK_MONOTONIC in ns
+ *
+ * \return Frequency in ppb
+ *
+ */
+double holdoverFrequency(const struct holdover* holdover, int64_t now)
+{
+	return holdoverFit(holdover, holdoverTime(holdover, now));
+}
+
+/**
+ * \brief Error bound of the clock
+ *
+ * The bound at the last sample, plus the frequency uncertainty times the
+ * elapsed time, plus the wander integrated twice.
+ *
+ * \param holdover - Trained holdover
+ * \param now - CLOCK_MONOTONIC in ns
+ *
+ * \return Error bound in ns
+ *
+ */
+int64_t holdoverBound(const struct holdover* holdover, int64_t now)
+{
+	double elapsed = (double)(now - holdover->lastsample) / GPSTIME_NS;
+	double frequency = holdover->scatter > HOLDOVER_FREQERROR ? holdover->scatter : HOLDOVER_FREQERROR;
+
+	// ppb times seconds is ns
+	return holdover->lastbound + (int64_t)(frequency * elapsed + 0.5 * HOLDOVER_WANDER * elapsed * elapsed);
+}
+
+/**
+ * \brief Holdover step
+ *
+ * Enter holdover when samples have stopped for HOLDOVER_DELAY and
+ * recalculate the frequency and the error bound every HOLDOVER_PERIOD.
+ *
+ * \param holdover - Holdover
+ * \param now - CLOCK_MONOTONIC in ns
+ *
+ * \return 1 if frequency and bound were updated and must be applied, 0 otherwise
+ *
+ */
+int holdoverUpdate(struct holdover* holdover, int64_t now)
+{
+	if (holdover->origin == 0 || now - holdover->lastsample < HOLDOVER_DELAY)
+	{
+		return 0;
+	}
+	if (holdover->active && now - holdover->lastupdate < HOLDOVER_PERIOD)
+	{
+		return 0;
+	}
+	if (!holdover->active)
+	{
+		holdover->active = 1;
+		holdover->entries++;
+	}
+	holdover->lastupdate = now;
+	holdover->frequency = holdoverFrequency(holdover, now);
+	holdover->bound = holdoverBound(holdover, now);
+	return 1;
+}
+
+/**
+ * \brief Leave holdover
+ *
+ * \param holdover - Holdover in holdover
+ * \param now - CLOCK_MONOTONIC in ns
+ *
+ * \return Frequency for the servo to continue from in ppb
+ *
+ */
+double holdoverResume(struct holdover* holdover, int64_t now)
+{
+	holdover->active = 0;
+	return holdoverFrequency(holdover, now);
+}
@@ -0,0 +1,251 @@
+/*
+ * Latency.c
+ *
+ * Per-stage latency histograms
+ *
+ * Every synchronization cycle is split into stages: edge detection, the
+ * wait for the first time log byte, the rest of the frame, parsing and the
+ * clock adjustment. A stage is marked with one CLOCK_MONOTONIC read when
+ * it ends. At the end of the cycle the time between marks goes into a
+ * fixed power of two histogram per stage, so recording costs no memory
+ * and a few ns. latencyDump() prints count, mean, min, max, percentiles
+ * and the non-empty buckets.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "Clock.h"
+#include "GPSTime.h"
+#include "Latency.h"
+
+// Histograms
+static struct histogram histograms[LATENCY_STAGES];
+// CLOCK_MONOTONIC marks of the current cycle, 0 = not reached
+static int64_t marks[LATENCY_STAGES];
+
+// Stage names for the dump
+static const char* const stagenames[LATENCY_STAGES] =
+{
+	"edge",
+	"first byte",
+	"frame",
+	"parse",
+	"clock",
+	"total",
+	"command",
+	"period"
+};
+
+/**
+ * \brief Histogram bucket of a value
+ *
+ * \param ns - Latency in ns
+ *
+ * \return Bucket index, the smallest i with ns < 2^i
+ *
+ */
+static int latencyBucket(int64_t ns)
+{
+	int bucket = 0;
+
+	while (bucket < LATENCYBUCKETS - 1 && ns >= ((int64_t)1 << bucket))
+	{
+		bucket++;
+	}
+	return bucket;
+}
+
+/**
+ * \brief Start a cycle at a PPS edge
+ *
+ * Record the edge detection latency, the time from the edge time stamp to
+ * now on the clock of the time stamp, and mark the edge as seen.
+ * Global: marks
+ *
+ * \param stamp - Edge time stamp
+ * \param clock - Clock of the time stamp
+ *
+ */
+void latencyStart(const struct timespec* stamp, clockid_t clock)
+{
+	struct timespec now;
+
+	memset(marks, 0, sizeof(marks));
+	clock_gettime(clock, &now);
+	marks[LATENCY_EDGE] = clockMonotonicNs();
+	latencyAdd(LATENCY_EDGE, (int64_t)(now.tv_sec - stamp->tv_sec) * GPSTIME_NS + (now.tv_nsec - stamp->tv_nsec));
+}
+
+/**
+ * \brief Mark the end of a stage
+ *
+ * Only the first mark of a stage in a cycle counts.
+ * Global: marks
+ *
+ * \param stage - Stage that ended
+ *
+ */
+void latencyMark(enum latencystage stage)
+{
+	if (marks[LATENCY_EDGE] != 0 && marks[stage] == 0)
+	{
+		marks[stage] = clockMonotonicNs();
+	}
+}
+
+/**
+ * \brief Add one latency to a histogram
+ *
+ * Global: histograms
+ *
+ * \param stage - Stage
+ * \param ns - Latency in ns
+ *
+ */
+void latencyAdd(enum latencystage stage, int64_t ns)
+{
+	struct histogram* histogram = &histograms[stage];
+
+	if (ns < 0)
+	{
+		ns = 0;
+	}
+	if (histogram->count == 0 || ns < histogram->min)
+	{
+		histogram->min = ns;
+	}
+	if (ns > histogram->max)
+	{
+		histogram->max = ns;
+	}
+	histogram->count++;
+	histogram->sum += ns;
+	histogram->buckets[latencyBucket(ns)]++;
+}
+
+/**
+ * \brief End a cycle
+ *
+ * Add the time between consecutive marks to the stage histograms. A failed
+ * cycle only records the stages it reached.
+ * Global: marks, histograms
+ *
+ */
+void latencyEnd(void)
+{
+	int64_t previous = marks[LATENCY_EDGE];
+	int stage;
+
+	if (previous == 0)
+	{
+		return;
+	}
+	for (stage = LATENCY_FIRSTBYTE; stage <= LATENCY_CLOCK; stage++)
+	{
+		if (marks[stage] == 0)
+		{
+			break;
+		}
+		latencyAdd(stage, marks[stage] - previous);
+		previous = marks[stage];
+	}
+	if (marks[LATENCY_CLOCK] != 0)
+	{
+		latencyAdd(LATENCY_TOTAL, marks[LATENCY_CLOCK] - marks[LATENCY_EDGE]);
+	}
+	memset(marks, 0, sizeof(marks));
+}
+
+/**
+ * \brief Percentile from a histogram
+ *
+ * \param histogram - Histogram
+ * \param percent - Percentile, 0-100
+ *
+ * \return Upper bound of the bucket holding the percentile in ns, at most max
+ *
+ */
+static int64_t latencyPercentile(const struct histogram* histogram, int percent)
+{
+	unsigned long target = (histogram->count * percent + 99) / 100;
+	unsigned long seen = 0;
+	int bucket;
+
+	for (bucket = 0; bucket < LATENCYBUCKETS; bucket++)
+	{
+		seen += histogram->buckets[bucket];
+		if (seen >= target)
+		{
+			break;
+		}
+	}
+	if (bucket >= LATENCYBUCKETS - 1 || ((int64_t)1 << bucket) > histogram->max)
+	{
+		return histogram->max;
+	}
+	return (int64_t)1 << bucket;
+}
+
+/**
+ * \brief Print the histograms
+ *
+ * One summary line per stage in us, then the non-empty buckets as
+ * "<upper bound us>:count".
+ * Global: histograms
+ *
+ * \param out - Output stream
+ *
+ */
+void latencyDump(FILE* out)
+{
+	const struct histogram* histogram;
+	int stage;
+	int bucket;
+
+	fprintf(out, "%-10s %8s %10s %10s %10s %10s %10s %10s  (us)\n",
+		"stage", "count", "mean", "min", "p50", "p90", "p99", "max");
+	for (stage = 0; stage < LATENCY_STAGES; stage++)
+	{
+		histogram = &histograms[stage];
+		if (histogram->count == 0)
+		{
+			continue;
+		}
+		fprintf(out, "%-10s %8lu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+			stagenames[stage], histogram->count,
+			(double)histogram->sum / histogram->count / 1000.0,
+			histogram->min / 1000.0,
+			latencyPercentile(histogram, 50) / 1000.0,
+			latencyPercentile(histogram, 90) / 1000.0,
+			latencyPercentile(histogram, 99) / 1000.0,
+			histogram->max / 1000.0);
+		fprintf(out, "          ");
+		for (bucket = 0; bucket < LATENCYBUCKETS; bucket++)
+		{
+			if (histogram->buckets[bucket] != 0)
+			{
+				if (bucket == LATENCYBUCKETS - 1)
+				{
+					fprintf(out, " >%.0f:%lu", ((int64_t)1 << (bucket - 1)) / 1000.0, histogram->buckets[bucket]);
+				}
+				else
+				{
+					fprintf(out, " %.3f:%lu", ((int64_t)1 << bucket) / 1000.0, histogram->buckets[bucket]);
+				}
+			}
+		}
+		fprintf(out, "\n");
+	}
+	fflush(out);
+}
@@ -0,0 +1,825 @@
+/*
+ * PPSSource.c
+ *
+ * PPS edge capture backends
+ *
+ * IOBB polls the PPS pin through libiobb and time stamps the edge in user
+ * space after the poll loop notices it. GPIOCHIP requests rising edge events
+ * from the Linux GPIO character device. The kernel time stamps the edge in
+ * the interrupt handler and the process sleeps in poll() until it arrives.
+ * On a plain Linux host GPIOCHIP can be tested with the gpio-sim module.
+ * KPPS uses the RFC 2783 PPS API on /dev/ppsN (pps-gpio, pps-ktimer, ...).
+ * The kernel time stamps the assert edge with CLOCK_REALTIME and counts
+ * edges, so a gap in the assert sequence means missed edges.
+ * SPIN maps the GPIO bank from /dev/mem and predicts the next edge from
+ * the previous ones. It sleeps until a window before the prediction and
+ * then reads GPIO_DATAIN in a tight loop, so the time stamp is taken
+ * within a register read of the edge. The window is the guard plus the
+ * recent prediction error and wakeup latency, a few hundred us once the
+ * prediction has settled. The first edge, and any edge outside the
+ * window, is searched by polling like IOBB and only used to predict.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/gpio.h>
+#include <BBBiolib.h>
+
+#include "Clock.h"
+#include "GPSTime.h"
+#include "PPSSource.h"
+
+#define SPINMEMDEVICE "/dev/mem"   // Physical memory for the GPIO registers
+#define SPINSEARCHUS 1000          // Poll interval while searching the edge in us
+
+// Open IOBB sources, they share one libiobb mapping
+static int iobbusers = 0;
+
+/**
+ * \brief Open kernel PPS device
+ *
+ * Open /dev/ppsN, create an RFC 2783 handle and enable assert edge
+ * capture with struct timespec time stamps.
+ *
+ * \param source - PPS source, device is the PPS device
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int kppsOpen(struct ppssource* source)
+{
+	pps_params_t params;
+	int mode;
+
+	source->fd = open(source->device, O_RDWR | O_CLOEXEC);
+	if (source->fd < 0)
+	{
+		perror(source->device);
+		return EXIT_FAILURE;
+	}
+	if (time_pps_create(source->fd, &source->handle) < 0)
+	{
+		perror("time_pps_create failed:");
+		close(source->fd);
+		return EXIT_FAILURE;
+	}
+	if (time_pps_getcap(source->handle, &mode) < 0)
+	{
+		perror("time_pps_getcap failed:");
+		goto fail;
+	}
+	if ((mode & PPS_CAPTUREASSERT) == 0 || (mode & PPS_CANWAIT) == 0)
+	{
+		fprintf(stderr, "%s cannot capture and wait for assert edges\r\n", source->device);
+		goto fail;
+	}
+	if (time_pps_getparams(source->handle, &params) < 0)
+	{
+		perror("time_pps_getparams failed:");
+		goto fail;
+	}
+	params.mode |= PPS_CAPTUREASSERT | PPS_TSFMT_TSPEC;
+	if (time_pps_setparams(source->handle, &params) < 0)
+	{
+		perror("time_pps_setparams failed:");
+		goto fail;
+	}
+	return EXIT_SUCCESS;
+
+fail:
+	time_pps_destroy(source->handle);
+	close(source->fd);
+	source->fd = -1;
+	return EXIT_FAILURE;
+}
+
+/**
+ * \brief Kernel PPS assert edge from fetched info
+ *
+ * \param source - Opened KPPS source
+ * \param info - Fetched PPS info with a new assert sequence number
+ * \param edge - Return the edge time stamp and sequence number
+ *
+ */
+static void kppsEdge(struct ppssource* source, const pps_info_t* info, struct ppsedge* edge)
+{
+	// Kernel PPS time stamps are taken from CLOCK_REALTIME
+	edge->stamp = info->assert_timestamp;
+	edge->clock = CLOCK_REALTIME;
+	edge->sequence = info->assert_sequence;
+	if (source->sequence != 0 && edge->sequence != source->sequence + 1)
+	{
+		fprintf(stderr, "Missed %lu PPS edges\r\n", edge->sequence - source->sequence - 1);
+	}
+	source->sequence = edge->sequence;
+}
+
+/**
+ * \brief Wait for the next kernel PPS assert edge
+ *
+ * time_pps_fetch() with a timeout blocks until the next PPS event.
+ * Clear events are not captured, but a repeated assert sequence number
+ * is skipped anyway so that only new edges are returned.
+ *
+ * \param source - Opened KPPS source
+ * \param edge - Return the edge time stamp and sequence number
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int kppsWait(struct ppssource* source, struct ppsedge* edge)
+{
+	const struct timespec timeout = { PPSTIMEOUTMS / 1000, (PPSTIMEOUTMS % 1000) * 1000000L };
+	pps_info_t info;
+
+	do
+	{
+		// info is only valid after a successful fetch, a signal retries
+		while (time_pps_fetch(source->handle, PPS_TSFMT_TSPEC, &info, &timeout) < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			if (errno == ETIMEDOUT)
+			{
+				fprintf(stderr, "PPS signal timeout\r\n");
+			}
+			else
+			{
+				perror("time_pps_fetch failed:");
+			}
+			return EXIT_FAILURE;
+		}
+	} while (info.assert_sequence == source->sequence);
+
+	kppsEdge(source, &info, edge);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Map the GPIO bank of the PPS input
+ *
+ * The pin must be muxed to GPIO, e.g. by the device tree, and the bank
+ * clock enabled, which the kernel GPIO driver does.
+ *
+ * \param source - PPS source, device is the bank and line the bit
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int spinOpen(struct ppssource* source)
+{
+	static const off_t banks[] = { BBBIO_GPIO0_ADDR, BBBIO_GPIO1_ADDR, BBBIO_GPIO2_ADDR, BBBIO_GPIO3_ADDR };
+	struct ppsspin* spin = &source->spin;
+	volatile uint32_t* oe;
+	char* end;
+	long bank;
+	int fd;
+
+	bank = strtol(source->device, &end, 10);
+	if (end == source->device || *end != '\0' || bank < 0 || bank > 3 || source->line > 31)
+	{
+		fprintf(stderr, "Bad GPIO bank %s or bit %u, use 0-3 and 0-31\r\n", source->device, source->line);
+		return EXIT_FAILURE;
+	}
+	fd = open(SPINMEMDEVICE, O_RDWR | O_SYNC | O_CLOEXEC);
+	if (fd < 0)
+	{
+		perror(SPINMEMDEVICE);
+		return EXIT_FAILURE;
+	}
+	spin->map = mmap(NULL, BBBIO_GPIOX_LEN, PROT_READ | PROT_WRITE, MAP_SHARED, fd, banks[bank]);
+	close(fd);
+	if (spin->map == MAP_FAILED)
+	{
+		perror("GPIO bank mmap failed:");
+		spin->map = NULL;
+		return EXIT_FAILURE;
+	}
+	spin->mask = 1U << source->line;
+	oe = (volatile uint32_t*)((char*)spin->map + BBBIO_GPIO_OE);
+	*oe |= spin->mask; // PPS input pin
+	spin->datain = (volatile const uint32_t*)((char*)spin->map + BBBIO_GPIO_DATAIN);
+
+	spin->lastedge = 0;
+	spin->counted = 0;
+	spin->period = GPSTIME_NS;
+	spin->jitter = 0.0;
+	spin->wakeup = 0.0;
+	spin->spinning = 0;
+	spin->edges = 0;
+	spin->acquisitions = 0;
+	spin->late = 0;
+	spin->missing = 0;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Count edges up to a time in the sequence number
+ *
+ * Edges that were passed, came late or were missed are counted too, like
+ * the kernel counts every edge, so that the sequence follows the seconds.
+ *
+ * \param source - Opened SPIN source
+ * \param time - CLOCK_MONOTONIC of the edge, seen or predicted, in ns
+ *
+ */
+static void spinCount(struct ppssource* source, int64_t time)
+{
+	struct ppsspin* spin = &source->spin;
+	int64_t periods = 1;
+
+	if (spin->counted != 0)
+	{
+		periods = (time - spin->counted + (int64_t)spin->period / 2) / (int64_t)spin->period;
+		if (periods < 1)
+		{
+			periods = 1;
+		}
+	}
+	source->sequence += periods;
+	spin->counted = time;
+}
+
+/**
+ * \brief Search the edge by polling
+ *
+ * Wait until PPS is low and then until it is high again, sleeping
+ * SPINSEARCHUS between reads. The edge is only good to the poll
+ * interval, so it starts the prediction and is not returned.
+ *
+ * \param source - Opened SPIN source
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if PPS is stuck
+ *
+ */
+static int spinAcquire(struct ppssource* source)
+{
+	struct ppsspin* spin = &source->spin;
+	int64_t deadline = clockMonotonicNs() + PPSTIMEOUTMS * 1000000LL;
+
+	while (*spin->datain & spin->mask)
+	{
+		if (clockMonotonicNs() >= deadline)
+		{
+			fprintf(stderr, "PPS signal stuck high.\r\n");
+			return EXIT_FAILURE;
+		}
+		usleep(SPINSEARCHUS);
+	}
+	deadline = clockMonotonicNs() + PPSTIMEOUTMS * 1000000LL;
+	while (!(*spin->datain & spin->mask))
+	{
+		if (clockMonotonicNs() >= deadline)
+		{
+			fprintf(stderr, "PPS signal stuck low.\r\n");
+			return EXIT_FAILURE;
+		}
+		usleep(SPINSEARCHUS);
+	}
+	spin->lastedge = clockMonotonicNs();
+	spinCount(source, spin->lastedge);
+	spin->jitter = SPINSEARCHUS * 1000.0;
+	spin->acquisitions++;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Wait for the predicted edge
+ *
+ * Sleep until the spin window before the predicted edge opens and spin on
+ * GPIO_DATAIN until the pin goes high. The prediction error and the
+ * interval adapt the next window and prediction.
+ *
+ * \param source - Opened SPIN source
+ * \param edge - Return the edge time stamp and sequence number
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int spinWait(struct ppssource* source, struct ppsedge* edge)
+{
+	struct ppsspin* spin = &source->spin;
+	struct timespec wake;
+	int64_t predicted;
+	int64_t window;
+	int64_t start;
+	int64_t now;
+	int64_t interval;
+	int64_t periods;
+	int precise = 1;
+	unsigned int count = 0;
+
+	if (spin->lastedge == 0)
+	{
+		if (spinAcquire(source) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+		precise = 0;
+	}
+	window = spin->guard + (int64_t)(4.0 * spin->jitter + 2.0 * spin->wakeup);
+	if (window > PPSSPIN_WINDOWMAX)
+	{
+		window = PPSSPIN_WINDOWMAX;
+	}
+
+	// Edges that passed without a wait are not waited for, spinCount() counts them
+	predicted = spin->lastedge + (int64_t)spin->period;
+	now = clockMonotonicNs();
+	while (predicted + window < now)
+	{
+		predicted += (int64_t)spin->period;
+		precise = 0;
+	}
+	start = predicted - window;
+	if (start > now)
+	{
+		wake.tv_sec = start / GPSTIME_NS;
+		wake.tv_nsec = start % GPSTIME_NS;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL) == EINTR)
+		{
+		}
+		now = clockMonotonicNs();
+		spin->wakeup += PPSSPIN_GAIN * ((double)(now - start) - spin->wakeup);
+	}
+	if (*spin->datain & spin->mask)
+	{
+		// Woke up in time, so the prediction was wrong
+		if (now - start < window / 2)
+		{
+			fprintf(stderr, "PPS edge before the spin window, searching again\r\n");
+			spin->lastedge = 0;
+			return EXIT_FAILURE;
+		}
+		// Woke up after the edge, the prediction still holds
+		fprintf(stderr, "PPS spin woke up %lld us late\r\n", (long long)((now - start) / 1000));
+		spin->late++;
+		spin->lastedge = predicted;
+		spinCount(source, predicted);
+		return EXIT_FAILURE;
+	}
+
+	start = now;
+	while (!(*spin->datain & spin->mask))
+	{
+		if (++count < PPSSPIN_CHECKS)
+		{
+			continue;
+		}
+		count = 0;
+		now = clockMonotonicNs();
+		if (now > predicted + window)
+		{
+			fprintf(stderr, "PPS edge missing\r\n");
+			spin->spinning += now - start;
+			spin->missing++;
+			// Keep predicting from where the edge should have been
+			spin->lastedge = predicted;
+			spinCount(source, predicted);
+			return EXIT_FAILURE;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &edge->stamp); // Time stamp PPS rising edge
+	now = (int64_t)edge->stamp.tv_sec * GPSTIME_NS + edge->stamp.tv_nsec;
+	edge->clock = CLOCK_MONOTONIC;
+	spinCount(source, now);
+	edge->sequence = source->sequence;
+
+	spin->spinning += now - start;
+	spin->edges++;
+	spin->jitter += PPSSPIN_GAIN * ((double)llabs(now - predicted) - spin->jitter);
+	// The interval follows the frequency of CLOCK_MONOTONIC
+	interval = now - spin->lastedge;
+	periods = (interval + (int64_t)spin->period / 2) / (int64_t)spin->period;
+	if (precise && periods == 1)
+	{
+		spin->period += PPSSPIN_PERIODGAIN * ((double)interval - spin->period);
+	}
+	spin->lastedge = now;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Backend from name
+ *
+ * Convert a command line backend name to a backend.
+ *
+ * \param name - "iobb", "gpiochip", "kpps" or "spin"
+ * \param backend - Return the backend
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on unknown name
+ *
+ */
+int ppsSourceBackend(const char* name, enum ppsbackend* backend)
+{
+	if (strcmp(name, "iobb") == 0)
+	{
+		*backend = PPS_BACKEND_IOBB;
+	}
+	else if (strcmp(name, "gpiochip") == 0)
+	{
+		*backend = PPS_BACKEND_GPIOCHIP;
+	}
+	else if (strcmp(name, "kpps") == 0)
+	{
+		*backend = PPS_BACKEND_KPPS;
+	}
+	else if (strcmp(name, "spin") == 0)
+	{
+		*backend = PPS_BACKEND_SPIN;
+	}
+	else
+	{
+		fprintf(stderr, "Unknown PPS source: %s\r\n", name);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief IOBB pin from name
+ *
+ * Convert a header pin name like "P9.23" to the expansion header and pin.
+ *
+ * \param name - "P8.n" or "P9.n", n = 1-46
+ * \param source - Return port and pin
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on a bad name
+ *
+ */
+int ppsSourcePin(const char* name, struct ppssource* source)
+{
+	char* end;
+	long pin;
+
+	if ((name[0] != 'P' && name[0] != 'p') || (name[1] != '8' && name[1] != '9') || name[2] != '.')
+	{
+		fprintf(stderr, "Bad PPS pin: %s, use P8.n or P9.n\r\n", name);
+		return EXIT_FAILURE;
+	}
+	pin = strtol(name + 3, &end, 10);
+	if (end == name + 3 || *end != '\0' || pin < 1 || pin > 46)
+	{
+		fprintf(stderr, "Bad PPS pin: %s, use P8.n or P9.n\r\n", name);
+		return EXIT_FAILURE;
+	}
+	source->port = name[1] - '0';
+	source->pin = (char)pin;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Open PPS source
+ *
+ * IOBB: Initialize libiobb once for all pins and configure the PPS pin as input.
+ * GPIOCHIP: Request rising edge events for the PPS line.
+ * KPPS: Create an RFC 2783 handle and enable assert capture.
+ * SPIN: Map the GPIO bank and configure the PPS bit as input.
+ *
+ * \param source - PPS source with the configuration filled in
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int ppsSourceOpen(struct ppssource* source)
+{
+	struct gpio_v2_line_request request;
+	int chip;
+
+	source->sequence = 0;
+	source->level = 1; // IOBB: a pin already high is not an edge
+	source->fd = -1;
+
+	if (source->backend == PPS_BACKEND_IOBB)
+	{
+		if (iobbusers == 0 && iolib_init() < 0)
+		{
+			fprintf(stderr, "iolib_init failed\r\n");
+			return EXIT_FAILURE;
+		}
+		iobbusers++;
+		iolib_setdir(source->port, source->pin, DigitalIn); // PPS input pin
+		return EXIT_SUCCESS;
+	}
+	if (source->backend == PPS_BACKEND_KPPS)
+	{
+		return kppsOpen(source);
+	}
+	if (source->backend == PPS_BACKEND_SPIN)
+	{
+		return spinOpen(source);
+	}
+
+	chip = open(source->device, O_RDONLY | O_CLOEXEC);
+	if (chip < 0)
+	{
+		perror(source->device);
+		return EXIT_FAILURE;
+	}
+
+	memset(&request, 0, sizeof(request));
+	request.offsets[0] = source->line;
+	request.num_lines = 1;
+	strncpy(request.consumer, "PPSTime", sizeof(request.consumer) - 1);
+	request.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING;
+	request.event_buffer_size = 16; // A few seconds of edges if we fall behind
+
+	if (ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &request) < 0)
+	{
+		perror("GPIO line request failed:");
+		close(chip);
+		return EXIT_FAILURE;
+	}
+	close(chip); // Line request fd stays valid without the chip fd
+	source->fd = request.fd;
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Read one GPIO line event
+ *
+ * \param source - Opened GPIOCHIP source with an event ready
+ * \param edge - Return the edge time stamp and sequence number
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int gpiochipRead(struct ppssource* source, struct ppsedge* edge)
+{
+	struct gpio_v2_line_event event;
+
+	if (read(source->fd, &event, sizeof(event)) != sizeof(event))
+	{
+		perror("PPS event read failed:");
+		return EXIT_FAILURE;
+	}
+
+	// Line events are time stamped with CLOCK_MONOTONIC by default
+	edge->stamp.tv_sec = event.timestamp_ns / GPSTIME_NS;
+	edge->stamp.tv_nsec = event.timestamp_ns % GPSTIME_NS;
+	edge->clock = CLOCK_MONOTONIC;
+	edge->sequence = event.line_seqno;
+	if (source->sequence != 0 && edge->sequence != source->sequence + 1)
+	{
+		fprintf(stderr, "Missed %lu PPS edges\r\n", edge->sequence - source->sequence - 1);
+	}
+	source->sequence = edge->sequence;
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Wait for the next PPS rising edge
+ *
+ * Block until the next rising edge and return its time stamp.
+ * Failure if no edge arrives within PPSTIMEOUTMS.
+ *
+ * \param source - Opened PPS source
+ * \param edge - Return the edge time stamp and sequence number
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int ppsSourceWait(struct ppssource* source, struct ppsedge* edge)
+{
+	struct pollfd pfd;
+	int ret;
+
+	if (source->backend == PPS_BACKEND_IOBB)
+	{
+		if (waitPPSHigh(source->port, source->pin) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &edge->stamp); // Time stamp PPS rising edge
+		edge->clock = CLOCK_MONOTONIC;
+		edge->sequence = ++source->sequence;
+		return EXIT_SUCCESS;
+	}
+	if (source->backend == PPS_BACKEND_KPPS)
+	{
+		return kppsWait(source, edge);
+	}
+	if (source->backend == PPS_BACKEND_SPIN)
+	{
+		return spinWait(source, edge);
+	}
+
+	pfd.fd = source->fd;
+	pfd.events = POLLIN;
+	do
+	{
+		ret = poll(&pfd, 1, PPSTIMEOUTMS);
+	} while (ret < 0 && errno == EINTR);
+	if (ret < 0)
+	{
+		perror("PPS poll failed:");
+		return EXIT_FAILURE;
+	}
+	if (ret == 0)
+	{
+		fprintf(stderr, "PPS signal timeout\r\n");
+		return EXIT_FAILURE;
+	}
+
+	return gpiochipRead(source, edge);
+}
+
+/**
+ * \brief Check for a PPS rising edge without blocking
+ *
+ * For the event loop. GPIOCHIP: call when ppsSourceFd() is readable.
+ * IOBB, SPIN and KPPS have no pollable file descriptor: call periodically,
+ * IOBB and SPIN compare the pin level with the previous call, KPPS fetches
+ * with a zero timeout. SPIN is then only as good as the polling interval.
+ *
+ * \param source - Opened PPS source
+ * \param edge - Return the edge time stamp and sequence number
+ *
+ * \return 1 if an edge was returned, 0 if there was none, -1 on failure
+ *
+ */
+int ppsSourcePoll(struct ppssource* source, struct ppsedge* edge)
+{
+	const struct timespec timeout = { 0, 0 };
+	pps_info_t info;
+	int level;
+
+	if (source->backend == PPS_BACKEND_IOBB || source->backend == PPS_BACKEND_SPIN)
+	{
+		if (source->backend == PPS_BACKEND_SPIN)
+		{
+			level = (*source->spin.datain & source->spin.mask) ? 1 : 0;
+		}
+		else
+		{
+			level = is_high(source->port, source->pin) ? 1 : 0;
+		}
+		if (!level || source->level)
+		{
+			source->level = level;
+			return 0;
+		}
+		source->level = level;
+		clock_gettime(CLOCK_MONOTONIC, &edge->stamp); // Time stamp PPS rising edge
+		edge->clock = CLOCK_MONOTONIC;
+		edge->sequence = ++source->sequence;
+		return 1;
+	}
+	if (source->backend == PPS_BACKEND_KPPS)
+	{
+		if (time_pps_fetch(source->handle, PPS_TSFMT_TSPEC, &info, &timeout) < 0)
+		{
+			if (errno == ETIMEDOUT || errno == EINTR)
+			{
+				return 0;
+			}
+			perror("time_pps_fetch failed:");
+			return -1;
+		}
+		if (info.assert_sequence == source->sequence)
+		{
+			return 0;
+		}
+		kppsEdge(source, &info, edge);
+		return 1;
+	}
+	return gpiochipRead(source, edge) == EXIT_SUCCESS ? 1 : -1;
+}
+
+/**
+ * \brief Pollable PPS file descriptor
+ *
+ * \param source - Opened PPS source
+ *
+ * \return GPIO line request file descriptor, -1 if the source must be polled periodically
+ *
+ */
+int ppsSourceFd(const struct ppssource* source)
+{
+	return source->backend == PPS_BACKEND_GPIOCHIP ? source->fd : -1;
+}
+
+/**
+ * \brief Close PPS source
+ *
+ * Release the libiobb mappings, the GPIO bank mapping, the GPIO line
+ * request or the PPS handle. SPIN prints how the prediction did.
+ *
+ * \param source - Opened PPS source
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int ppsSourceClose(struct ppssource* source)
+{
+	if (source->backend == PPS_BACKEND_IOBB)
+	{
+		if (--iobbusers == 0)
+		{
+			iolib_free();
+		}
+		return EXIT_SUCCESS;
+	}
+	if (source->backend == PPS_BACKEND_SPIN)
+	{
+		printf("PPS spin: %lu edges, %.1f us spinning per edge, prediction error %.1f us, wakeup %.1f us, "
+			"%lu searches, %lu late, %lu missing\n",
+			source->spin.edges,
+			source->spin.edges > 0 ? source->spin.spinning / 1000.0 / source->spin.edges : 0.0,
+			source->spin.jitter / 1000.0, source->spin.wakeup / 1000.0,
+			source->spin.acquisitions, source->spin.late, source->spin.missing);
+		if (source->spin.map != NULL)
+		{
+			munmap(source->spin.map, BBBIO_GPIOX_LEN);
+			source->spin.map = NULL;
+		}
+		return EXIT_SUCCESS;
+	}
+	if (source->backend == PPS_BACKEND_KPPS)
+	{
+		time_pps_destroy(source->handle);
+	}
+
+	if (close(source->fd) < 0)
+	{
+		perror("PPS source close failed");
+		return EXIT_FAILURE;
+	}
+	source->fd = -1;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Wait PPS rising edge
+ *
+ * Wait until PPS is low. Then wait for PPS rising edge.
+ * Return 0 when rising edge has been detected.
+ * Failure if signal stays low or high for more than 3 seconds
+ *
+ * \param port - Expansion header of the PPS pin
+ * \param pin - PPS pin
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int waitPPSHigh(char port, char pin)
+{
+	#define SLEEPTIMER 1000 // Sleep delay in microseconds. 1ms delay = 1ms error
+
+	struct timespec deadline;
+	struct timespec now;
+
+	// Timeouts are deadlines, oversleeping does not stretch them
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += PPSTIMEOUTMS / 1000;
+
+	// wait until PPS is low
+	while (is_high(port, pin))
+	{
+		// Timeout check
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec))
+		{
+			fprintf(stderr, "PPS signal stuck high.\r\n");
+			return EXIT_FAILURE;
+		}
+		usleep(SLEEPTIMER); // Don't hang
+	}
+
+	// Wait for a rising edge on PPS signal
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += PPSTIMEOUTMS / 1000;
+	while (is_low(port, pin))
+	{
+		// Timeout check
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec))
+		{
+			fprintf(stderr, "PPS signal stuck low.\r\n");
+			return EXIT_FAILURE;
+		}
+		usleep(SLEEPTIMER); // Don't hang
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -12,83 +12,2030 @@
  * Includes
  ****************************************************************/
 #include <fcntl.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
 #include <time.h>
-#include <BBBiolib.h>
+#include <sys/epoll.h>
 
 #include "PPSTime.h"
+#include "Capture.h"
+#include "Clock.h"
+#include "Control.h"
+#include "CRC32.h"
+#include "Drift.h"
+#include "Estimator.h"
+#include "EventLoop.h"
+#include "Framer.h"
+#include "GPSTime.h"
+#include "Holdover.h"
+#include "Latency.h"
+#include "Pipeline.h"
+#include "PPSSource.h"
+#include "Realtime.h"
+#include "Receiver.h"
+#include "Refclock.h"
+#include "Select.h"
+#include "Servo.h"
+#include "TimePage.h"
 #include "tools.h"
 #include "UART.h"
 
-#define CMDBUFFERSIZE 256   // UART receive buffer size
-#define TIMELOGDELAY 300000 // Time log received after PPS rising edge in us. 300ms
+#define TIMELOGTIMEOUT 900 // Time log must arrive within 900ms of the PPS rising edge
+#define PPSSAMPLENS 1000000LL // Event loop samples sources without line events every 1ms
+#define SELECTWAITNS 300000000LL // Combine a second at the latest 300ms after its first time log
+
+// Event loop state of one receiver
+struct loopsource
+{
+	struct loopstate* state;
+	struct gnsssource* source;		// Receiver and PPS input
+	int index;						// Source number
+	struct eventsource ppsevent;	// PPS line events, or the sampling timer
+	struct eventsource uartevent;	// Time log bytes
+	struct eventsource timeout;		// Time log deadline after an edge
+	struct eventsource watchdog;	// PPS deadline after an edge
+	int waiting;					// An edge waits for its time log
+	struct ppsedge edge;			// That edge, converted to CLOCK_REALTIME
+	struct timespec anchor;			// That edge on CLOCK_MONOTONIC_RAW
+	unsigned long cycles;			// Edges with a time log
+	unsigned long failures;			// Edges without a usable time log
+};
+
+// Edges of one UTC second from all receivers
+struct loopround
+{
+	int64_t second;					// UTC seconds since the GPS epoch
+	int count;						// Samples collected
+	struct selectsample samples[SOURCEMAX];
+	struct gpstime utctime[SOURCEMAX];	// UTC time of each edge
+	struct timespec anchor[SOURCEMAX];	// Each edge on CLOCK_MONOTONIC_RAW
+	int64_t utcoffset[SOURCEMAX];		// UTC offset of each time log in ns
+};
+
+// Event loop mode state
+struct loopstate
+{
+	struct ppstime* ctx;
+	struct eventloop loop;
+	struct loopsource sources[SOURCEMAX];
+	struct eventsource roundtimer;	// Round deadline after its first sample
+	struct eventsource holdovertimer; // Periodic holdover steering
+	struct control control;			// Control socket, optional
+	struct selector selector;		// Source selection
+	struct loopround round;			// Round being collected
+	int64_t lastround;				// Second of the last combined round
+	int cycle;						// A latency cycle is open
+	unsigned long rounds;			// Seconds used
+	unsigned long failures;			// Seconds without an agreed offset
+};
+
+// Edge waiting for its time log in a replay
+struct replayedge
+{
+	struct ppsedge edge;			// Edge on the simulated clock, sequence 0 = none
+	int64_t time;					// Capture time of the edge in ns
+};
+
+// Cleared by SIGINT/SIGTERM to stop continuous mode
+static volatile sig_atomic_t running = 1;
+// Set by SIGUSR1 to print the latency histograms
+static volatile sig_atomic_t dumplatency = 0;
 
 /**
- * \brief Main
+ * \brief Stop signal handler
  *
- * This is where the program does its thing.
+ * \param signum - Signal number
  *
- * \return 0 on success, -1 on failure
+ */
+static void stopHandler(int signum)
+{
+	(void)signum;
+	running = 0;
+}
+
+/**
+ * \brief Latency dump signal handler
+ *
+ * \param signum - Signal number
+ *
+ */
+static void dumpHandler(int signum)
+{
+	(void)signum;
+	dumplatency = 1;
+}
+
+/**
+ * \brief Print usage
+ *
+ * \param name - Program name
+ *
+ */
+static void usage(const char* name)
+{
+	fprintf(stderr,
+		"Usage: %s [-c] [-t] [-e] [-C socket] [-b] [-B baud] [-u uart] [-s iobb|gpiochip|kpps|spin] [-d device] [-l line] [-G us] [-m uart:source[:device[:line]]] [-P kp] [-I ki] [-S seconds] [-w samples] [-E seconds] [-o shm:N|sock:path] [-T path|memfd] [-D path] [-F path] [-Y path] [-R priority] [-A cpu] [-J seconds] [-X workers]\n"
+		"  -c  Continuous mode. Keep the UART open and discipline the clock every second\n"
+		"  -t  Threaded continuous mode. Edges and time logs are captured by their own threads and matched\n"
+		"  -e  Event loop continuous mode. PPS, UART, timeouts and control socket in one epoll loop\n"
+		"  -C  Control socket path for -e, commands status, latency and stop. Implies -e\n"
+		"  -b  Request the binary TIMEB log instead of ASCII TIMESYNCA\n"
+		"  -B  Receiver link rate in bps, 9600-921600 (default %d)\n"
+		"  -u  Receiver serial device (default %s)\n"
+		"  -s  PPS source. iobb polls a header pin (default), gpiochip and kpps use kernel time stamped edges,\n"
+		"      spin sleeps until just before the predicted edge and spins on the GPIO register\n"
+		"  -d  Header pin for iobb (default P9.23), GPIO chip for gpiochip (default /dev/gpiochip1),\n"
+		"      PPS device for kpps (default /dev/pps0), GPIO bank for spin (default 1)\n"
+		"  -l  GPIO line for gpiochip, bit in the bank for spin (default 17, P9.23 = GPIO1_17)\n"
+		"  -G  Least spin time before the predicted edge for spin in us (default %d)\n"
+		"  -m  Add a receiver with its own PPS input, e.g. /dev/ttyS2:kpps:/dev/pps1. Implies -e. May be repeated\n"
+		"      The receivers are combined every second, falsetickers are rejected\n"
+		"  -P  Servo proportional gain (default %.2f)\n"
+		"  -I  Servo integral gain (default %.2f)\n"
+		"  -S  Step the clock if the offset is larger, until locked (default %.6f s, 0 = never)\n"
+		"  -w  Estimator window, 1 or %d-%d samples (default %d, 1 = use every sample as is)\n"
+		"  -E  Correct only when the estimate confidence bound is smaller (default %.6f s, %.3f s for iobb and spin)\n"
+		"  -o  Publish samples to ntpd/chronyd instead of correcting the clock, implies -c. May be repeated\n"
+		"      shm:N  NTP SHM unit N (key 0x4e545030 + N), sock:path  chrony SOCK refclock socket\n"
+		"  -T  Publish GPS time in a shared time page file, e.g. /dev/shm/ppstime, or memfd. Implies -c\n"
+		"  -D  Drift file. The saved frequency pre-seeds the clock, saved hourly when locked and at exit. Implies -c\n"
+		"  -F  Capture receiver bytes, PPS edges and clock corrections to a binary file for replay. Implies -c\n"
+		"  -Y  Replay a capture of the first receiver through the servo in simulated time, no hardware needed\n"
+		"  -R  Real-time profile: SCHED_FIFO priority 1-99, mlockall, pre-faulted stack, minimum timer slack\n"
+		"  -A  Pin to this CPU\n"
+		"  -J  Measure PPS detection jitter for this many seconds under stress, no receiver needed\n"
+		"  -X  Stress workers for -J, half CPU and half memory load (default one per CPU, 0 = no stress)\n",
+		name, RECEIVERBAUD, UARTDEVICE, PPSSPIN_GUARDUS, SERVO_KP, SERVO_KI, SERVO_STEPTHRESHOLD / 1e9,
+		ESTIMATOR_MINSAMPLES, ESTIMATORMAX, ESTIMATOR_WINDOW, ESTIMATOR_CONFIDENCE / 1e9, PPSSAMPLENS / 1e9);
+}
+
+/**
+ * \brief Current time of the program
+ *
+ * \param ctx - Program state
+ *
+ * \return CLOCK_MONOTONIC in ns, the capture time when replaying
+ *
+ */
+static int64_t nowNs(const struct ppstime* ctx)
+{
+	if (ctx->simulated != NULL)
+	{
+		return ctx->simulated->time;
+	}
+	return clockMonotonicNs();
+}
+
+/**
+ * \brief Current system time
+ *
+ * \param ctx - Program state
+ * \param now - Return CLOCK_REALTIME, the capture time when replaying
  *
  */
-int main(void)
+static void realtimeNow(const struct ppstime* ctx, struct timespec* now)
 {
-	char commandbuffer[CMDBUFFERSIZE];
-	struct timespec ppstime;
-	long double utcseconds;
+	int64_t ns;
+
+	if (ctx->simulated == NULL)
+	{
+		clock_gettime(CLOCK_REALTIME, now);
+		return;
+	}
+	ns = ctx->simulated->time + ctx->simulated->epoch;
+	now->tv_sec = ns / GPSTIME_NS;
+	now->tv_nsec = ns % GPSTIME_NS;
+}
 
-	 // Configure IO pins
-    iolib_init();
-    iolib_setdir(9, 23, DigitalIn); // PPS input pin
+/**
+ * \brief Set the clock frequency correction
+ *
+ * \param ctx - Program state
+ * \param frequency - Frequency correction in ppb
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int setFrequency(struct ppstime* ctx, double frequency)
+{
+	if (ctx->simulated != NULL)
+	{
+		ctx->simulated->frequency = frequency;
+		return EXIT_SUCCESS;
+	}
+	if (clockSetFrequency(frequency) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+	if (ctx->capturepath != NULL)
+	{
+		captureFrequency(&ctx->capture, frequency);
+	}
+	return EXIT_SUCCESS;
+}
 
-    // Initialize UART
-    if (uartInit() == EXIT_FAILURE)
+/**
+ * \brief Step the clock
+ *
+ * \param ctx - Program state
+ * \param step - Step added to the clock in ns
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int stepClock(struct ppstime* ctx, int64_t step)
+{
+	if (ctx->simulated != NULL)
+	{
+		ctx->simulated->phase += (double)step;
+		return EXIT_SUCCESS;
+	}
+	if (clockStep(step) == EXIT_FAILURE)
 	{
 		return EXIT_FAILURE;
 	}
+	if (ctx->capturepath != NULL)
+	{
+		captureStep(&ctx->capture, step);
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Mark the clock synchronized
+ *
+ * \param ctx - Program state
+ * \param bound - Error bound in ns
+ *
+ */
+static void setSynced(struct ppstime* ctx, int64_t bound)
+{
+	if (ctx->simulated == NULL)
+	{
+		clockSetSynced(bound);
+	}
+}
+
+/**
+ * \brief Append the records of the cycle to the capture file
+ *
+ * \param ctx - Program state
+ *
+ */
+static void flushCapture(struct ppstime* ctx)
+{
+	if (ctx->capturepath != NULL)
+	{
+		captureFlush(&ctx->capture);
+	}
+}
+
+/**
+ * \brief Pre-seed the clock frequency from the drift file
+ *
+ * The servo integrator starts from the saved frequency, so only the
+ * phase is left to settle. A missing, malformed or too old file leaves
+ * the frequency alone. A clock far in the past, e.g. without an RTC at
+ * boot, does not make the file too old.
+ *
+ * \param ctx - Program state
+ *
+ */
+static void loadDrift(struct ppstime* ctx)
+{
+	struct drift drift;
+	struct timespec now;
+	int64_t age;
+
+	if (driftLoad(ctx->driftpath, &drift) == EXIT_FAILURE)
+	{
+		printf("No drift file %s, starting from 0 ppb\n", ctx->driftpath);
+		return;
+	}
+	clock_gettime(CLOCK_REALTIME, &now);
+	age = now.tv_sec - drift.time;
+	if (age > DRIFT_MAXAGE)
+	{
+		printf("Drift file %s is %lld days old, ignored\n", ctx->driftpath, (long long)(age / 86400));
+		return;
+	}
+	if (setFrequency(ctx, drift.frequency) == EXIT_FAILURE)
+	{
+		return;
+	}
+	servoResume(&ctx->servo, drift.frequency);
+	ctx->appliedfrequency = drift.frequency;
+	printf("Frequency %+.1f ppb +-%.1f ppb from %s\n", drift.frequency, drift.uncertainty, ctx->driftpath);
+}
+
+/**
+ * \brief Save the learned frequency to the drift file
+ *
+ * \param ctx - Program state
+ *
+ */
+static void saveDrift(struct ppstime* ctx)
+{
+	struct drift drift;
+	struct timespec now;
+	int64_t monotonic = clockMonotonicNs();
+
+	if (ctx->driftpath == NULL || ctx->holdover.origin == 0)
+	{
+		return;
+	}
+	drift.frequency = holdoverFrequency(&ctx->holdover, monotonic);
+	drift.uncertainty = ctx->holdover.scatter;
+	// The clock was last known good at the last locked sample
+	clock_gettime(CLOCK_REALTIME, &now);
+	drift.time = now.tv_sec - (monotonic - ctx->holdover.lastsample) / GPSTIME_NS;
+	if (driftSave(ctx->driftpath, &drift) == EXIT_SUCCESS)
+	{
+		ctx->driftsaved = monotonic;
+	}
+}
+
+/**
+ * \brief Correct the system clock
+ *
+ * One shot mode steps the clock if the offset is above the step threshold
+ * and otherwise lets the kernel slew it. Continuous mode runs the servo
+ * and applies its frequency, stepping only for large errors before lock.
+ *
+ * \param ctx - Program state
+ * \param offset - System time minus GPS time at the edge in ns
+ * \param sequence - Edge sequence number
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int correctClock(struct ppstime* ctx, int64_t offset, unsigned long sequence)
+{
+	enum servostate state;
+	double interval = 1.0;
+	double frequency;
+	int result;
+
+	if (!ctx->continuous)
+	{
+		if (ctx->servo.stepthreshold > 0 && llabs(offset) > ctx->servo.stepthreshold)
+		{
+			result = clockStep(-offset);
+		}
+		else
+		{
+			result = clockSlew(-offset);
+		}
+		latencyMark(LATENCY_CLOCK);
+		ctx->corrected = (result == EXIT_SUCCESS);
+		return result;
+	}
+
+	// Continue from the holdover frequency, the gap was steered already
+	if (ctx->holdover.active)
+	{
+		frequency = holdoverResume(&ctx->holdover, nowNs(ctx));
+		servoResume(&ctx->servo, frequency);
+		ctx->lastsequence = 0;
+		printf("holdover ended, resuming at %+10.1f ppb\n", frequency);
+	}
+
+	// Missed edges make the interval longer
+	if (ctx->lastsequence != 0 && sequence > ctx->lastsequence)
+	{
+		interval = (double)(sequence - ctx->lastsequence);
+	}
+	ctx->lastsequence = sequence;
 
-    // Time log command
-    if (uartTimelogCmd() == EXIT_FAILURE)
+	state = servoSample(&ctx->servo, offset, interval, &frequency);
+	if (state == SERVO_JUMP)
+	{
+		if (stepClock(ctx, -offset) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+		ctx->phase -= offset;
+	}
+	if (setFrequency(ctx, frequency) == EXIT_FAILURE)
 	{
 		return EXIT_FAILURE;
 	}
+	ctx->appliedfrequency = frequency;
+	ctx->corrected = 1;
+	if (state == SERVO_LOCKED)
+	{
+		setSynced(ctx, llabs(offset) + ctx->servo.lockthreshold);
+	}
+	holdoverSample(&ctx->holdover, nowNs(ctx), -ctx->servo.drift, llabs(offset) + ctx->servo.lockthreshold,
+		state == SERVO_LOCKED);
+	if (state == SERVO_LOCKED && ctx->driftpath != NULL &&
+		(ctx->driftsaved == 0 || clockMonotonicNs() - ctx->driftsaved >= DRIFT_SAVEPERIOD))
+	{
+		saveDrift(ctx);
+	}
+	latencyMark(LATENCY_CLOCK);
+
+	printf("offset %+9lld ns  bound %6lld ns  frequency %+10.1f ppb  %s\n",
+		(long long)offset, (long long)ctx->estimator.bound, frequency, servoStateName(state));
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Publish a sample to the time daemons
+ *
+ * \param ctx - Program state
+ * \param utctime - GPS UTC time at the edge
+ * \param offset - System time minus GPS time at the edge in ns
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if any exporter failed
+ *
+ */
+static int publishSample(struct ppstime* ctx, const struct gpstime* utctime, int64_t offset)
+{
+	struct gpstime systime = *utctime;
+	struct timespec receive;
+	int result = EXIT_SUCCESS;
+	int i;
+
+	gpsTimeAdd(&systime, offset);
+	gpsTimeToTimespec(&systime, &receive);
+	for (i = 0; i < ctx->refclockcount; i++)
+	{
+		if (refclockPublish(&ctx->refclocks[i], &receive, utctime) == EXIT_FAILURE)
+		{
+			result = EXIT_FAILURE;
+		}
+	}
+	latencyMark(LATENCY_CLOCK);
+	printf("offset %+9lld ns  published\n", (long long)offset);
+	return result;
+}
+
+/**
+ * \brief Steer the clock through an outage
+ *
+ * Call whenever time passes, with or without samples. Once the servo has
+ * had no sample for HOLDOVER_DELAY, apply the predicted oscillator
+ * frequency and publish the growing error bound every HOLDOVER_PERIOD.
+ * Only continuous mode correcting the clock itself holds over, time
+ * daemons do their own.
+ *
+ * \param ctx - Program state
+ *
+ */
+static void holdoverTick(struct ppstime* ctx)
+{
+	struct timespec now;
+	struct gpstime reference;
+	int entering = !ctx->holdover.active;
+	int64_t monotonic = nowNs(ctx);
+	double frequency;
+
+	if (!ctx->continuous || ctx->refclockcount > 0 || !holdoverUpdate(&ctx->holdover, monotonic))
+	{
+		return;
+	}
+	if (entering)
+	{
+		// Samples after the outage must not be judged against the old ones
+		estimatorReset(&ctx->estimator);
+		ctx->lastsequence = 0;
+	}
+
+	// Keep the phase model in step with the frequency change
+	realtimeNow(ctx, &now);
+	gpsTimeFromTimespec(&now, &reference);
+	if (ctx->lasttime != 0)
+	{
+		ctx->phase += (int64_t)(ctx->appliedfrequency * (reference.ns - ctx->lasttime) / 1e9);
+	}
+	ctx->lasttime = reference.ns;
+
+	frequency = ctx->holdover.frequency;
+	if (frequency > ctx->servo.maxfrequency)
+	{
+		frequency = ctx->servo.maxfrequency;
+	}
+	else if (frequency < -ctx->servo.maxfrequency)
+	{
+		frequency = -ctx->servo.maxfrequency;
+	}
+	if (setFrequency(ctx, frequency) == EXIT_FAILURE)
+	{
+		return;
+	}
+	ctx->appliedfrequency = frequency;
+	setSynced(ctx, ctx->holdover.bound);
+	printf("holdover %5lld s  bound %9lld ns  frequency %+10.1f ppb\n",
+		(long long)((monotonic - ctx->holdover.lastsample) / GPSTIME_NS),
+		(long long)ctx->holdover.bound, frequency);
+}
+
+/**
+ * \brief Use one measured offset
+ *
+ * Publish the sample and correct the system time.
+ *
+ * \param ctx - Program state
+ * \param anchor - CLOCK_MONOTONIC_RAW at the edge, used with the time page
+ * \param utctime - UTC time of the edge
+ * \param utcoffset - UTC offset of the time log in ns
+ * \param offset - System time minus GPS time at the edge in ns
+ * \param sequence - Edge sequence number
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int applySample(struct ppstime* ctx, const struct timespec* anchor, const struct gpstime* utctime,
+	int64_t utcoffset, int64_t offset, unsigned long sequence)
+{
+	if (ctx->timepagepath != NULL)
+	{
+		timePagePublish(&ctx->timepage, anchor, utctime, utcoffset);
+	}
+
+	// The time daemon filters and disciplines the clock itself
+	if (ctx->refclockcount > 0)
+	{
+		return publishSample(ctx, utctime, offset);
+	}
+
+	// Without the corrections applied so far the offsets follow a line
+	if (ctx->lasttime != 0)
+	{
+		ctx->phase += (int64_t)(ctx->appliedfrequency * (utctime->ns - ctx->lasttime) / 1e9);
+	}
+	ctx->lasttime = utctime->ns;
+	if (!estimatorSample(&ctx->estimator, utctime->ns, offset - ctx->phase))
+	{
+		printf("offset %+9lld ns  bound %6lld ns  estimating, %d of %d samples used%s\n",
+			(long long)offset,
+			ctx->estimator.bound == INT64_MAX ? -1LL : (long long)ctx->estimator.bound,
+			ctx->estimator.inliers, ctx->estimator.count,
+			ctx->estimator.rejected ? ", outlier" : "");
+		return EXIT_SUCCESS;
+	}
+
+	return correctClock(ctx, ctx->estimator.estimate + ctx->phase, sequence);
+}
+
+/**
+ * \brief Use one edge and its time log
+ *
+ * \param ctx - Program state
+ * \param edge - PPS edge
+ * \param anchor - CLOCK_MONOTONIC_RAW at the edge, used with the time page
+ * \param log - Time log of the edge
+ * \param utctime - UTC time of the edge
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int processSample(struct ppstime* ctx, const struct ppsedge* edge, const struct timespec* anchor,
+	const struct timelog* log, const struct gpstime* utctime)
+{
+	int64_t offset;
+
+    // System clock offset from UTC time
+    if (gpsSectoSystemTime(utctime, edge, &offset) == EXIT_FAILURE)
+    {
+		return EXIT_FAILURE;
+    }
+	latencyMark(LATENCY_PARSE);
+
+	return applySample(ctx, anchor, utctime, log->utcoffset, offset, edge->sequence);
+}
+
+/**
+ * \brief Synchronize once
+ *
+ * Wait for a PPS rising edge, read the time log that follows it and
+ * correct the system time. The time log must already be requested.
+ * Uses only the framer of the source, so every cycle has the same footprint.
+ *
+ * \param ctx - Program state
+ * \param source - Opened receiver and PPS source
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int syncCycle(struct ppstime* ctx, struct gnsssource* source)
+{
+	struct ppsedge edge;
+	struct timelog log;
+	char* frame;
+	size_t length;
+	struct gpstime utctime;
+	struct timespec anchor;
+	struct timespec realtime;
 
     // Wait for the next rising edge of PPS input pin
-    if (waitPPSHigh() == EXIT_FAILURE)
+    if (ppsSourceWait(&source->pps, &edge) == EXIT_FAILURE)
 	{
 		return EXIT_FAILURE;
 	}
-	clock_gettime(CLOCK_MONOTONIC, &ppstime);	// Time stamp PPS rising edge
-	usleep(TIMELOGDELAY); // Wait for Time Log data 10ms + data transfer time 150ms
+	latencyStart(&edge.stamp, edge.clock);
+	// Convert while the edge is recent, the clocks may run at different rates
+	if (ctx->timepagepath != NULL &&
+		clockAt(&edge.stamp, edge.clock, CLOCK_MONOTONIC_RAW, &anchor) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+	if (ctx->capturepath != NULL)
+	{
+		if (clockRealtimeAt(&edge.stamp, edge.clock, &realtime) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+		captureEdge(&ctx->capture, 0, &realtime, edge.sequence);
+	}
+	// Drop anything left from the previous second
+	uartFlush(&source->uart);
+	framerReset(&source->framer);
 
-    // Wait for Time log input
-    if (uartTimelogRead(commandbuffer, CMDBUFFERSIZE) == EXIT_FAILURE)
+    // Wait for Time log input, returns as soon as the frame is complete
+    if (uartTimelogRead(&source->uart, &source->framer, &frame, &length, TIMELOGTIMEOUT) == EXIT_FAILURE)
 	{
 		return EXIT_FAILURE;
 	}
+	latencyMark(LATENCY_FRAME);
 
-    // Parse and check time log and return UTC GPS seconds
-    if (parseTimelog(commandbuffer, &utcseconds) == EXIT_FAILURE)
+    // Parse and check time log and return UTC time
+    if (parseTimelogFrame(frame, length, &log) == EXIT_FAILURE ||
+		timelogUtcTime(&log, &utctime) == EXIT_FAILURE)
     {
 		return EXIT_FAILURE;
     }
 
-    // Update system time from GPS seconds
-    gpsSectoSystemTime(utcseconds, ppstime);
+	return processSample(ctx, &edge, &anchor, &log, &utctime);
+}
+
+/**
+ * \brief Synchronize continuously with the threaded pipeline
+ *
+ * The edge and UART threads capture independently, every matched pair is
+ * processed here until SIGINT or SIGTERM.
+ *
+ * \param ctx - Program state
+ * \param source - Opened receiver and PPS source
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int syncPipeline(struct ppstime* ctx, struct gnsssource* source)
+{
+	struct pipeline pipeline;
+	struct pipelinepair pair;
 
-    // Close UART
-    if (uartClose() == EXIT_FAILURE)
+	framerReset(&source->framer);
+	uartFlush(&source->uart);
+	if (pipelineStart(&pipeline, &source->pps, &source->uart, &source->framer) == EXIT_FAILURE)
 	{
 		return EXIT_FAILURE;
 	}
-	iolib_free();
+	while (running)
+	{
+		if (pipelineNext(&pipeline, &pair, HOLDOVER_PERIOD / 1000000) == EXIT_SUCCESS)
+		{
+			if (processSample(ctx, &pair.edge.realtime, &pair.edge.anchor, &pair.log.log, &pair.log.utctime) == EXIT_FAILURE)
+			{
+				fprintf(stderr, "Synchronization failed at edge %lu\r\n", pair.edge.edge.sequence);
+			}
+			pipelineDone(&pair);
+			flushCapture(ctx);
+		}
+		holdoverTick(ctx);
+		if (dumplatency)
+		{
+			dumplatency = 0;
+			latencyDump(stdout);
+		}
+	}
+	pipelineStop(&pipeline);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Event loop: end the latency cycle when everything is done
+ *
+ * \param state - Loop state
+ *
+ */
+static void loopIdle(struct loopstate* state)
+{
+	int i;
 
-	printf("Time synchronized succesfully\n");
-    return EXIT_SUCCESS;
+	if (!state->cycle || state->round.count > 0)
+	{
+		return;
+	}
+	for (i = 0; i < state->ctx->sourcecount; i++)
+	{
+		if (state->sources[i].waiting)
+		{
+			return;
+		}
+	}
+	state->cycle = 0;
+	latencyEnd();
+	flushCapture(state->ctx);
 }
 
+/**
+ * \brief Event loop: end the cycle of the waiting edge
+ *
+ * \param source - Source state
+ * \param success - The edge was used
+ *
+ */
+static void loopCycleEnd(struct loopsource* source, int success)
+{
+	if (success)
+	{
+		source->cycles++;
+	}
+	else
+	{
+		source->failures++;
+	}
+	source->waiting = 0;
+	eventTimerDisarm(source->timeout.fd);
+	loopIdle(source->state);
+}
 
+/**
+ * \brief Event loop: combine and use the collected round
+ *
+ * \param state - Loop state
+ *
+ */
+static void loopRoundEnd(struct loopstate* state)
+{
+	struct ppstime* ctx = state->ctx;
+	struct loopround* round = &state->round;
+	int64_t offset;
+	int best = 0;
+	int i;
+
+	eventTimerDisarm(state->roundtimer.fd);
+	if (selectCombine(&state->selector, round->samples, round->count, &offset) == EXIT_FAILURE)
+	{
+		state->failures++;
+	}
+	else
+	{
+		for (i = 0; i < round->count; i++)
+		{
+			if (round->samples[i].source == state->selector.selected)
+			{
+				best = i;
+			}
+		}
+		if (round->count < ctx->sourcecount || state->selector.truechimers < round->count)
+		{
+			printf("%d of %d sources, %d agree, source %d selected\n",
+				round->count, ctx->sourcecount, state->selector.truechimers, state->selector.selected);
+		}
+		// The time page follows the edge of the best source
+		if (applySample(ctx, &round->anchor[best], &round->utctime[best], round->utcoffset[best],
+			offset, (unsigned long)round->second) == EXIT_FAILURE)
+		{
+			state->failures++;
+		}
+		else
+		{
+			state->rounds++;
+		}
+	}
+	state->lastround = round->second;
+	round->count = 0;
+	loopIdle(state);
+}
+
+/**
+ * \brief Event loop: add a measured edge to its round
+ *
+ * A round collects the edges of one UTC second. It is combined when every
+ * source has reported, when a sample of a later second arrives or at the
+ * round deadline, so a lost receiver delays nothing.
+ *
+ * \param source - Source state with the waiting edge
+ * \param log - Time log of the edge
+ * \param utctime - UTC time of the edge
+ *
+ */
+static void loopSample(struct loopsource* source, const struct timelog* log, const struct gpstime* utctime)
+{
+	struct loopstate* state = source->state;
+	struct loopround* round = &state->round;
+	struct selectsample* sample;
+	int64_t second = (utctime->ns + GPSTIME_NS / 2) / GPSTIME_NS;
+	int64_t offset;
+	int i;
+
+	if (gpsSectoSystemTime(utctime, &source->edge, &offset) == EXIT_FAILURE)
+	{
+		loopCycleEnd(source, 0);
+		return;
+	}
+	latencyMark(LATENCY_PARSE);
+	if (second <= state->lastround)
+	{
+		fprintf(stderr, "Source %d: time log after its round, dropped\r\n", source->index);
+		loopCycleEnd(source, 0);
+		return;
+	}
+	if (round->count > 0 && round->second != second)
+	{
+		loopRoundEnd(state);
+	}
+	for (i = 0; i < round->count; i++)
+	{
+		if (round->samples[i].source == source->index)
+		{
+			fprintf(stderr, "Source %d: second time log in a round, dropped\r\n", source->index);
+			loopCycleEnd(source, 0);
+			return;
+		}
+	}
+	if (round->count == 0)
+	{
+		round->second = second;
+		eventTimerArm(state->roundtimer.fd, clockMonotonicNs() + SELECTWAITNS, 0);
+	}
+
+	sample = &round->samples[round->count];
+	sample->source = source->index;
+	sample->offset = offset;
+	// Polled edges are only good to the sampling interval
+	sample->error = (source->source->pps.backend == PPS_BACKEND_IOBB ||
+		source->source->pps.backend == PPS_BACKEND_SPIN) ? PPSSAMPLENS : SELECT_BASEERROR;
+	sample->clock = log->clock;
+	round->utctime[round->count] = *utctime;
+	round->anchor[round->count] = source->anchor;
+	round->utcoffset[round->count] = log->utcoffset;
+	round->count++;
+	loopCycleEnd(source, 1);
+
+	if (round->count == state->ctx->sourcecount)
+	{
+		loopRoundEnd(state);
+	}
+}
+
+/**
+ * \brief Event loop: PPS line event or sampling timer
+ *
+ * \param context - Source state
+ * \param events - epoll events
+ *
+ */
+static void loopPPS(void* context, uint32_t events)
+{
+	struct loopsource* source = context;
+	struct loopstate* state = source->state;
+	struct ppsedge edge;
+	int64_t now;
+
+	(void)events;
+	if (ppsSourceFd(&source->source->pps) < 0)
+	{
+		eventTimerRead(source->ppsevent.fd);
+	}
+	if (ppsSourcePoll(&source->source->pps, &edge) <= 0)
+	{
+		return;
+	}
+	if (source->waiting)
+	{
+		fprintf(stderr, "Source %d: no time log for PPS edge %lu\r\n", source->index, source->edge.sequence);
+		loopCycleEnd(source, 0);
+	}
+	now = clockMonotonicNs();
+	// The first edge of a second starts the latency cycle
+	if (!state->cycle)
+	{
+		latencyStart(&edge.stamp, edge.clock);
+		state->cycle = 1;
+	}
+
+	// Convert now, the clocks run at different rates
+	source->edge = edge;
+	source->edge.clock = CLOCK_REALTIME;
+	if (clockRealtimeAt(&edge.stamp, edge.clock, &source->edge.stamp) == EXIT_FAILURE ||
+		clockAt(&edge.stamp, edge.clock, CLOCK_MONOTONIC_RAW, &source->anchor) == EXIT_FAILURE)
+	{
+		loopIdle(state);
+		return;
+	}
+	if (state->ctx->capturepath != NULL)
+	{
+		captureEdge(&state->ctx->capture, source->index, &source->edge.stamp, edge.sequence);
+	}
+	source->waiting = 1;
+	eventTimerArm(source->timeout.fd, now + TIMELOGTIMEOUT * 1000000LL, 0);
+	eventTimerArm(source->watchdog.fd, now + PPSTIMEOUTMS * 1000000LL, 0);
+}
+
+/**
+ * \brief Event loop: UART readable
+ *
+ * \param context - Source state
+ * \param events - epoll events
+ *
+ */
+static void loopUART(void* context, uint32_t events)
+{
+	struct loopsource* source = context;
+	struct gnsssource* receiver = source->source;
+	struct timelog log;
+	struct gpstime utctime;
+	char* frame;
+	size_t length;
+
+	(void)events;
+	if (uartTimelogFeed(&receiver->uart, &receiver->framer) == EXIT_FAILURE)
+	{
+		return;
+	}
+	while (framerNext(&receiver->framer, &frame, &length))
+	{
+		if (!source->waiting)
+		{
+			fprintf(stderr, "Source %d: time log without PPS edge dropped\r\n", source->index);
+			continue;
+		}
+		latencyMark(LATENCY_FRAME);
+		if (parseTimelogFrame(frame, length, &log) == EXIT_FAILURE)
+		{
+			fprintf(stderr, "Source %d: synchronization failed at edge %lu\r\n", source->index, source->edge.sequence);
+			loopCycleEnd(source, 0);
+			continue;
+		}
+		// The clock status is weighed by the selection
+		timelogTime(&log, &utctime);
+		loopSample(source, &log, &utctime);
+	}
+}
+
+/**
+ * \brief Event loop: time log deadline
+ *
+ * \param context - Source state
+ * \param events - epoll events
+ *
+ */
+static void loopTimeout(void* context, uint32_t events)
+{
+	struct loopsource* source = context;
+
+	(void)events;
+	if (eventTimerRead(source->timeout.fd) > 0 && source->waiting)
+	{
+		fprintf(stderr, "%s time log timeout\r\n", source->source->uartdevice);
+		loopCycleEnd(source, 0);
+	}
+}
+
+/**
+ * \brief Event loop: PPS deadline
+ *
+ * \param context - Source state
+ * \param events - epoll events
+ *
+ */
+static void loopWatchdog(void* context, uint32_t events)
+{
+	struct loopsource* source = context;
+
+	(void)events;
+	if (eventTimerRead(source->watchdog.fd) > 0)
+	{
+		fprintf(stderr, "Source %d: PPS signal timeout\r\n", source->index);
+		eventTimerArm(source->watchdog.fd, clockMonotonicNs() + PPSTIMEOUTMS * 1000000LL, 0);
+	}
+}
+
+/**
+ * \brief Event loop: round deadline
+ *
+ * \param context - Loop state
+ * \param events - epoll events
+ *
+ */
+static void loopRoundTimeout(void* context, uint32_t events)
+{
+	struct loopstate* state = context;
+
+	(void)events;
+	if (eventTimerRead(state->roundtimer.fd) > 0 && state->round.count > 0)
+	{
+		loopRoundEnd(state);
+	}
+}
+
+/**
+ * \brief Event loop: holdover period
+ *
+ * \param context - Loop state
+ * \param events - epoll events
+ *
+ */
+static void loopHoldover(void* context, uint32_t events)
+{
+	struct loopstate* state = context;
+
+	(void)events;
+	if (eventTimerRead(state->holdovertimer.fd) > 0)
+	{
+		holdoverTick(state->ctx);
+	}
+}
+
+/**
+ * \brief Event loop: control command
+ *
+ * \param context - Loop state
+ * \param command - Command line
+ * \param reply - Reply stream
+ *
+ */
+static void loopControl(void* context, const char* command, FILE* reply)
+{
+	struct loopstate* state = context;
+	struct ppstime* ctx = state->ctx;
+	struct loopsource* source;
+	int i;
+
+	if (strcmp(command, "status") == 0)
+	{
+		fprintf(reply, "synchronized %lu\nfailed %lu\nservo %s\nfrequency %.3f ppb\nbound %lld ns\nselected %d\n",
+			state->rounds, state->failures,
+			servoStateName(ctx->servo.state), ctx->appliedfrequency,
+			ctx->estimator.bound == INT64_MAX ? -1LL : (long long)ctx->estimator.bound,
+			state->selector.selected);
+		fprintf(reply, "holdover %s\nholdover bound %lld ns\nholdovers %lu\n",
+			ctx->holdover.active ? "yes" : "no", (long long)ctx->holdover.bound, ctx->holdover.entries);
+		for (i = 0; i < ctx->sourcecount; i++)
+		{
+			source = &state->sources[i];
+			fprintf(reply, "source %d %s edges %lu used %lu failed %lu falseticker %lu jitter %.0f ns\n",
+				i, source->source->uartdevice, source->source->pps.sequence, source->cycles, source->failures,
+				state->selector.falsetickers[i], state->selector.jitter[i]);
+		}
+	}
+	else if (strcmp(command, "latency") == 0)
+	{
+		latencyDump(reply);
+	}
+	else if (strcmp(command, "stop") == 0)
+	{
+		running = 0;
+		fprintf(reply, "stopping\n");
+	}
+	else
+	{
+		fprintf(reply, "unknown command, use status, latency or stop\n");
+	}
+}
+
+/**
+ * \brief Event loop: add the events of one source
+ *
+ * \param state - Loop state
+ * \param index - Source number
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int loopSourceAdd(struct loopstate* state, int index)
+{
+	struct loopsource* source = &state->sources[index];
+	struct gnsssource* receiver = &state->ctx->sources[index];
+
+	source->state = state;
+	source->source = receiver;
+	source->index = index;
+	source->ppsevent.fd = ppsSourceFd(&receiver->pps);
+	if (source->ppsevent.fd < 0)
+	{
+		source->ppsevent.fd = eventTimerCreate();
+		if (source->ppsevent.fd < 0 ||
+			eventTimerArm(source->ppsevent.fd, clockMonotonicNs() + PPSSAMPLENS, PPSSAMPLENS) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+	}
+	source->ppsevent.handler = loopPPS;
+	source->ppsevent.context = source;
+	source->uartevent.fd = uartFd(&receiver->uart);
+	source->uartevent.handler = loopUART;
+	source->uartevent.context = source;
+	source->timeout.fd = eventTimerCreate();
+	source->timeout.handler = loopTimeout;
+	source->timeout.context = source;
+	source->watchdog.fd = eventTimerCreate();
+	source->watchdog.handler = loopWatchdog;
+	source->watchdog.context = source;
+	if (source->timeout.fd < 0 || source->watchdog.fd < 0 ||
+		eventTimerArm(source->watchdog.fd, clockMonotonicNs() + PPSTIMEOUTMS * 1000000LL, 0) == EXIT_FAILURE ||
+		eventLoopAdd(&state->loop, &source->ppsevent, EPOLLIN) == EXIT_FAILURE ||
+		eventLoopAdd(&state->loop, &source->uartevent, EPOLLIN) == EXIT_FAILURE ||
+		eventLoopAdd(&state->loop, &source->timeout, EPOLLIN) == EXIT_FAILURE ||
+		eventLoopAdd(&state->loop, &source->watchdog, EPOLLIN) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	uartFlush(&receiver->uart);
+	framerReset(&receiver->framer);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Synchronize continuously in an event loop
+ *
+ * One thread, one epoll_wait() over the PPS line events, the UARTs, the
+ * time log and PPS deadlines and the control socket of every receiver.
+ * Sources without line events are sampled by a periodic timer. The edges
+ * of each second are combined by the source selection. Runs until SIGINT,
+ * SIGTERM or the stop command.
+ *
+ * \param ctx - Program state
+ * \param controlpath - Control socket path, NULL = none
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int syncEventLoop(struct ppstime* ctx, const char* controlpath)
+{
+	struct loopstate state;
+	struct loopsource* source;
+	int result = EXIT_FAILURE;
+	int i;
+
+	memset(&state, 0, sizeof(state));
+	state.ctx = ctx;
+	for (i = 0; i < SOURCEMAX; i++)
+	{
+		state.sources[i].ppsevent.fd = -1;
+		state.sources[i].timeout.fd = -1;
+		state.sources[i].watchdog.fd = -1;
+	}
+	state.roundtimer.fd = -1;
+	state.holdovertimer.fd = -1;
+	state.control.listen.fd = -1;
+	selectInit(&state.selector);
+	if (eventLoopInit(&state.loop) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < ctx->sourcecount; i++)
+	{
+		if (loopSourceAdd(&state, i) == EXIT_FAILURE)
+		{
+			goto done;
+		}
+	}
+	state.roundtimer.fd = eventTimerCreate();
+	state.roundtimer.handler = loopRoundTimeout;
+	state.roundtimer.context = &state;
+	state.holdovertimer.fd = eventTimerCreate();
+	state.holdovertimer.handler = loopHoldover;
+	state.holdovertimer.context = &state;
+	if (state.roundtimer.fd < 0 || state.holdovertimer.fd < 0 ||
+		eventTimerArm(state.holdovertimer.fd, clockMonotonicNs() + HOLDOVER_PERIOD, HOLDOVER_PERIOD) == EXIT_FAILURE ||
+		eventLoopAdd(&state.loop, &state.roundtimer, EPOLLIN) == EXIT_FAILURE ||
+		eventLoopAdd(&state.loop, &state.holdovertimer, EPOLLIN) == EXIT_FAILURE)
+	{
+		goto done;
+	}
+	if (controlpath != NULL &&
+		controlOpen(&state.control, &state.loop, controlpath, loopControl, &state) == EXIT_FAILURE)
+	{
+		goto done;
+	}
+
+	result = EXIT_SUCCESS;
+	while (running && result == EXIT_SUCCESS)
+	{
+		result = eventLoopRun(&state.loop);
+		if (dumplatency)
+		{
+			dumplatency = 0;
+			latencyDump(stdout);
+		}
+	}
+	printf("Event loop: %lu seconds synchronized, %lu failed\n", state.rounds, state.failures);
+	for (i = 0; i < ctx->sourcecount; i++)
+	{
+		printf("Source %d %s: %lu edges used, %lu failed, %lu rounds rejected\n", i, ctx->sources[i].uartdevice,
+			state.sources[i].cycles, state.sources[i].failures, state.selector.falsetickers[i]);
+	}
+
+done:
+	if (state.control.listen.fd >= 0)
+	{
+		controlClose(&state.control);
+	}
+	for (i = 0; i < SOURCEMAX; i++)
+	{
+		source = &state.sources[i];
+		if (source->source != NULL && ppsSourceFd(&source->source->pps) < 0 && source->ppsevent.fd >= 0)
+		{
+			close(source->ppsevent.fd);
+		}
+		if (source->timeout.fd >= 0)
+		{
+			close(source->timeout.fd);
+		}
+		if (source->watchdog.fd >= 0)
+		{
+			close(source->watchdog.fd);
+		}
+	}
+	if (state.roundtimer.fd >= 0)
+	{
+		close(state.roundtimer.fd);
+	}
+	if (state.holdovertimer.fd >= 0)
+	{
+		close(state.holdovertimer.fd);
+	}
+	eventLoopClose(&state.loop);
+	return result;
+}
+
+/**
+ * \brief Print the framer statistics of the receivers
+ *
+ * \param ctx - Program state
+ * \param count - Number of receivers
+ *
+ */
+static void printFramers(const struct ppstime* ctx, int count)
+{
+	const struct framer* framer;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		framer = &ctx->sources[i].framer;
+		printf("Framer %d: %lu frames, %lu malformed, %lu oversize, %lu garbage bytes\n",
+			i, framer->frames, framer->malformed, framer->oversize, framer->garbage);
+	}
+}
+
+/**
+ * \brief Replay: time logs completed by received bytes
+ *
+ * \param ctx - Program state
+ * \param edge - Waiting edge, sequence 0 = none
+ * \param now - Capture time of the bytes in ns
+ * \param samples - Count of samples used
+ * \param failures - Count of failed samples
+ *
+ */
+static void replayFrames(struct ppstime* ctx, struct replayedge* edge, int64_t now,
+	unsigned long* samples, unsigned long* failures)
+{
+	struct framer* framer = &ctx->sources[0].framer;
+	struct timespec anchor = {0, 0};
+	struct timelog log;
+	struct gpstime utctime;
+	char* frame;
+	size_t length;
+
+	while (framerNext(framer, &frame, &length))
+	{
+		// A time log without an edge, or too late for it
+		if (edge->edge.sequence == 0 || now - edge->time > TIMELOGTIMEOUT * 1000000LL)
+		{
+			continue;
+		}
+		if (parseTimelogFrame(frame, length, &log) == EXIT_FAILURE ||
+			timelogUtcTime(&log, &utctime) == EXIT_FAILURE ||
+			processSample(ctx, &edge->edge, &anchor, &log, &utctime) == EXIT_FAILURE)
+		{
+			(*failures)++;
+		}
+		else
+		{
+			(*samples)++;
+		}
+		edge->edge.sequence = 0;
+	}
+}
+
+/**
+ * \brief Replay a capture in simulated time
+ *
+ * Feed the captured bytes and edges of the first receiver through the
+ * framer, the parser, the estimator and the servo as fast as they go.
+ * The servo steers a simulated clock: the recorded edges are moved by
+ * the corrections it applied minus the corrections captured with them.
+ * Gaps between records step the holdover once a HOLDOVER_PERIOD.
+ *
+ * \param ctx - Program state
+ * \param path - Capture file
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int replayCapture(struct ppstime* ctx, const char* path)
+{
+	struct capturereader reader;
+	struct captureevent event;
+	struct captureclock recorded;
+	struct captureclock simulated;
+	struct replayedge edge;
+	struct timespec wallstart;
+	struct timespec wallend;
+	int64_t start;
+	int64_t bias = 0;
+	int64_t now;
+	int64_t tick;
+	int64_t ns;
+	size_t written;
+	unsigned long edges = 0;
+	unsigned long samples = 0;
+	unsigned long failures = 0;
+
+	if (captureReaderOpen(&reader, path) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+	memset(&recorded, 0, sizeof(recorded));
+	memset(&simulated, 0, sizeof(simulated));
+	memset(&edge, 0, sizeof(edge));
+	ctx->simulated = &simulated;
+	framerInit(&ctx->sources[0].framer);
+	start = reader.time;
+	clock_gettime(CLOCK_MONOTONIC, &wallstart);
+
+	while (running && captureRead(&reader, &event))
+	{
+		// A capture appended after a reboot starts over, keep time going forward
+		if (event.time + bias < simulated.time)
+		{
+			bias = simulated.time - event.time;
+		}
+		now = event.time + bias;
+		simulated.epoch = event.epoch - bias;
+		for (tick = simulated.time + HOLDOVER_PERIOD; simulated.time != 0 && tick < now; tick += HOLDOVER_PERIOD)
+		{
+			captureClockAdvance(&simulated, tick);
+			holdoverTick(ctx);
+		}
+		captureClockAdvance(&recorded, now);
+		captureClockAdvance(&simulated, now);
+
+		switch (event.type)
+		{
+		case CAPTURE_TIME:
+			// Restart or a long gap, the byte stream is broken
+			framerReset(&ctx->sources[0].framer);
+			edge.edge.sequence = 0;
+			break;
+		case CAPTURE_FREQUENCY:
+			recorded.frequency = event.frequency;
+			break;
+		case CAPTURE_STEP:
+			recorded.phase += (double)event.step;
+			break;
+		case CAPTURE_EDGE:
+			if (event.source != 0)
+			{
+				break;
+			}
+			if (edge.edge.sequence != 0)
+			{
+				failures++;
+			}
+			ns = (int64_t)event.stamp.tv_sec * GPSTIME_NS + event.stamp.tv_nsec +
+				(int64_t)(simulated.phase - recorded.phase);
+			edge.edge.stamp.tv_sec = ns / GPSTIME_NS;
+			edge.edge.stamp.tv_nsec = ns % GPSTIME_NS;
+			edge.edge.clock = CLOCK_REALTIME;
+			// Sequence 0 marks no edge
+			edge.edge.sequence = event.sequence != 0 ? event.sequence : 1;
+			edge.time = now;
+			edges++;
+			break;
+		case CAPTURE_UART:
+			if (event.source != 0)
+			{
+				break;
+			}
+			while (event.length > 0)
+			{
+				written = framerWrite(&ctx->sources[0].framer, event.data, event.length);
+				replayFrames(ctx, &edge, now, &samples, &failures);
+				if (written == 0)
+				{
+					break;
+				}
+				event.data += written;
+				event.length -= written;
+			}
+			break;
+		}
+		holdoverTick(ctx);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &wallend);
+	captureReaderClose(&reader);
+	ctx->simulated = NULL;
+
+	printf("Replayed %.1f s in %.3f s: %lu edges, %lu samples, %lu failures, %lu holdovers\n",
+		(double)(simulated.time - start) / GPSTIME_NS,
+		(double)(wallend.tv_sec - wallstart.tv_sec) + (wallend.tv_nsec - wallstart.tv_nsec) / 1e9,
+		edges, samples, failures, ctx->holdover.entries);
+	printFramers(ctx, 1);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Measure PPS detection jitter
+ *
+ * Wait for edges under synthetic load and record the edge detection
+ * latency and the deviation of each edge interval from one second. The
+ * interval also shows the jitter of polled edges, whose time stamp is
+ * taken at detection.
+ *
+ * \param pps - Opened PPS source
+ * \param seconds - Measurement length
+ * \param workers - Stress workers, 0 = one per online CPU, -1 = none
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+static int measureJitter(struct ppssource* pps, int seconds, int workers)
+{
+	struct rtstress stress;
+	struct ppsedge edge;
+	struct timespec last;
+	int64_t interval;
+	int havelast = 0;
+	int cycles;
+	int failures = 0;
+
+	memset(&stress, 0, sizeof(stress));
+	if (workers >= 0 && realtimeStressStart(&stress, workers) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+	printf("Measuring PPS jitter for %d s with %d stress workers\n", seconds, stress.workers);
+	for (cycles = 0; running && cycles < seconds; cycles++)
+	{
+		if (ppsSourceWait(pps, &edge) == EXIT_FAILURE)
+		{
+			failures++;
+			havelast = 0;
+			continue;
+		}
+		latencyStart(&edge.stamp, edge.clock);
+		if (havelast)
+		{
+			interval = (int64_t)(edge.stamp.tv_sec - last.tv_sec) * GPSTIME_NS + (edge.stamp.tv_nsec - last.tv_nsec);
+			// A missed edge makes a longer interval, only the fraction counts
+			interval = (interval + GPSTIME_NS / 2) % GPSTIME_NS - GPSTIME_NS / 2;
+			latencyAdd(LATENCY_PERIOD, llabs(interval));
+		}
+		latencyEnd();
+		last = edge.stamp;
+		havelast = 1;
+		if (dumplatency)
+		{
+			dumplatency = 0;
+			latencyDump(stdout);
+		}
+	}
+	realtimeStressStop(&stress);
+	latencyDump(stdout);
+	if (failures > 0)
+	{
+		fprintf(stderr, "%d PPS edges missed\r\n", failures);
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Default receiver and PPS input
+ *
+ * UART1 and P9.23 through libiobb.
+ *
+ * \param source - Source to initialize
+ *
+ */
+static void sourceInit(struct gnsssource* source)
+{
+	memset(source, 0, sizeof(*source));
+	source->uartdevice = UARTDEVICE;
+	source->uart.fd = -1;
+	source->pps.backend = PPS_BACKEND_IOBB;
+	source->pps.port = 9;
+	source->pps.pin = 23;
+	source->pps.device = NULL;
+	source->pps.line = 17;
+	source->pps.spin.guard = PPSSPIN_GUARDUS * 1000LL;
+}
+
+/**
+ * \brief Parse a receiver specification
+ *
+ * "uart:backend[:device[:line]]", e.g. /dev/ttyS2:iobb:P9.15,
+ * /dev/ttyS4:gpiochip:/dev/gpiochip0:26, /dev/ttyS5:kpps:/dev/pps1 or
+ * /dev/ttyS1:spin:1:17.
+ * The specification is split in place.
+ *
+ * \param spec - Specification
+ * \param source - Return the source configuration
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on a bad specification
+ *
+ */
+static int sourceParse(char* spec, struct gnsssource* source)
+{
+	char* backend;
+	char* line;
+
+	sourceInit(source);
+	backend = strchr(spec, ':');
+	if (backend == NULL || backend == spec)
+	{
+		fprintf(stderr, "Bad receiver: %s, use uart:backend[:device[:line]]\r\n", spec);
+		return EXIT_FAILURE;
+	}
+	*backend++ = '\0';
+	source->uartdevice = spec;
+	source->pps.device = strchr(backend, ':');
+	if (source->pps.device != NULL)
+	{
+		*(char*)source->pps.device++ = '\0';
+		line = strchr(source->pps.device, ':');
+		if (line != NULL)
+		{
+			*line++ = '\0';
+			source->pps.line = strtoul(line, NULL, 10);
+		}
+	}
+	return ppsSourceBackend(backend, &source->pps.backend);
+}
+
+/**
+ * \brief Complete the PPS input configuration
+ *
+ * IOBB takes its pin from the device name, the others get their default
+ * device.
+ *
+ * \param source - Source
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on a bad pin name
+ *
+ */
+static int sourceDefaults(struct gnsssource* source)
+{
+	if (source->pps.backend == PPS_BACKEND_IOBB)
+	{
+		return source->pps.device == NULL ? EXIT_SUCCESS : ppsSourcePin(source->pps.device, &source->pps);
+	}
+	if (source->pps.device == NULL)
+	{
+		source->pps.device = (source->pps.backend == PPS_BACKEND_KPPS) ? "/dev/pps0" :
+			(source->pps.backend == PPS_BACKEND_SPIN) ? "1" : "/dev/gpiochip1";
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Close receivers and PPS inputs
+ *
+ * \param ctx - Program state
+ * \param count - Number of opened sources
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if a UART could not be restored
+ *
+ */
+static int sourcesClose(struct ppstime* ctx, int count)
+{
+	int result = EXIT_SUCCESS;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (ctx->sources[i].uart.fd >= 0 && uartClose(&ctx->sources[i].uart) == EXIT_FAILURE)
+		{
+			result = EXIT_FAILURE;
+		}
+		ppsSourceClose(&ctx->sources[i].pps);
+	}
+	return result;
+}
+
+/**
+ * \brief Open receivers and PPS inputs
+ *
+ * Open every PPS input, then configure every receiver.
+ *
+ * \param ctx - Program state
+ * \param receivers - Configure the receivers too
+ * \param baud - Receiver link rate
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure with everything closed
+ *
+ */
+static int sourcesOpen(struct ppstime* ctx, int receivers, int baud)
+{
+	struct gnsssource* source;
+	int i;
+
+	for (i = 0; i < ctx->sourcecount; i++)
+	{
+		if (ppsSourceOpen(&ctx->sources[i].pps) == EXIT_FAILURE)
+		{
+			sourcesClose(ctx, i);
+			return EXIT_FAILURE;
+		}
+	}
+	for (i = 0; receivers && i < ctx->sourcecount; i++)
+	{
+		source = &ctx->sources[i];
+		framerInit(&source->framer);
+		if (uartInit(&source->uart, source->uartdevice) == EXIT_FAILURE)
+		{
+			sourcesClose(ctx, ctx->sourcecount);
+			return EXIT_FAILURE;
+		}
+		// Link rate and time log request
+		if (receiverConfigure(&source->uart, ctx->binary, baud) == EXIT_FAILURE)
+		{
+			sourcesClose(ctx, ctx->sourcecount);
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Main
+ *
+ * This is where the program does its thing.
+ * One shot mode synchronizes once and exits. Continuous mode keeps the
+ * time log stream running and corrects the clock on every PPS edge until
+ * SIGINT or SIGTERM.
+ *
+ * \return 0 on success, -1 on failure
+ *
+ */
+int main(int argc, char* argv[])
+{
+	struct ppstime ctx;
+	struct gnsssource* source;
+	struct sigaction action;
+	int failures = 0;
+	int attempts;
+	int result = EXIT_SUCCESS;
+	int baud = RECEIVERBAUD;
+	int jitterseconds = 0;
+	int threaded = 0;
+	int eventloop = 0;
+	const char* controlpath = NULL;
+	const char* replaypath = NULL;
+	int stressworkers = 0;
+	int64_t spinguard = PPSSPIN_GUARDUS * 1000LL;
+	int confidenceset = 0;
+	int opt;
+	int i;
+	int j;
+
+	memset(&ctx, 0, sizeof(ctx));
+	servoInit(&ctx.servo);
+	estimatorInit(&ctx.estimator);
+	holdoverInit(&ctx.holdover);
+	ctx.realtime.priority = 0;
+	ctx.realtime.cpu = -1;
+	crc32Init();
+
+	// First receiver from -u, -s, -d and -l, -m adds more
+	sourceInit(&ctx.sources[0]);
+	ctx.sourcecount = 1;
+	source = &ctx.sources[0];
+
+	while ((opt = getopt(argc, argv, "cteC:bB:u:s:d:l:G:m:P:I:S:w:E:o:T:D:F:Y:R:A:J:X:h")) != -1)
+	{
+		switch (opt)
+		{
+		case 'c':
+			ctx.continuous = 1;
+			break;
+		case 't':
+			threaded = 1;
+			ctx.continuous = 1;
+			break;
+		case 'C':
+			controlpath = optarg;
+			// fall through
+		case 'e':
+			eventloop = 1;
+			ctx.continuous = 1;
+			break;
+		case 'b':
+			ctx.binary = 1;
+			break;
+		case 'B':
+			baud = strtol(optarg, NULL, 10);
+			break;
+		case 'u':
+			source->uartdevice = optarg;
+			break;
+		case 's':
+			if (ppsSourceBackend(optarg, &source->pps.backend) == EXIT_FAILURE)
+			{
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'd':
+			source->pps.device = optarg;
+			break;
+		case 'l':
+			source->pps.line = strtoul(optarg, NULL, 10);
+			break;
+		case 'G':
+			spinguard = strtoll(optarg, NULL, 10) * 1000LL;
+			if (spinguard < 0)
+			{
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'm':
+			if (ctx.sourcecount == SOURCEMAX ||
+				sourceParse(optarg, &ctx.sources[ctx.sourcecount]) == EXIT_FAILURE)
+			{
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			ctx.sourcecount++;
+			eventloop = 1;
+			ctx.continuous = 1;
+			break;
+		case 'P':
+			ctx.servo.kp = strtod(optarg, NULL);
+			break;
+		case 'I':
+			ctx.servo.ki = strtod(optarg, NULL);
+			break;
+		case 'S':
+			ctx.servo.stepthreshold = (int64_t)(strtod(optarg, NULL) * 1e9);
+			break;
+		case 'w':
+			ctx.estimator.window = atoi(optarg);
+			// Smaller windows than ESTIMATOR_MINSAMPLES could never give an estimate
+			if (ctx.estimator.window < 1 || ctx.estimator.window > ESTIMATORMAX ||
+				(ctx.estimator.window > 1 && ctx.estimator.window < ESTIMATOR_MINSAMPLES))
+			{
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'E':
+			ctx.estimator.confidence = (int64_t)(strtod(optarg, NULL) * 1e9);
+			confidenceset = 1;
+			break;
+		case 'o':
+			if (ctx.refclockcount == REFCLOCKMAX ||
+				refclockParse(optarg, &ctx.refclocks[ctx.refclockcount]) == EXIT_FAILURE)
+			{
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			ctx.refclockcount++;
+			ctx.continuous = 1;
+			break;
+		case 'T':
+			ctx.timepagepath = optarg;
+			ctx.continuous = 1;
+			break;
+		case 'D':
+			ctx.driftpath = optarg;
+			ctx.continuous = 1;
+			break;
+		case 'F':
+			ctx.capturepath = optarg;
+			ctx.continuous = 1;
+			break;
+		case 'Y':
+			replaypath = optarg;
+			break;
+		case 'R':
+			ctx.realtime.priority = atoi(optarg);
+			if (ctx.realtime.priority < 1 || ctx.realtime.priority > 99)
+			{
+				usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'A':
+			ctx.realtime.cpu = atoi(optarg);
+			break;
+		case 'J':
+			jitterseconds = atoi(optarg);
+			break;
+		case 'X':
+			// 0 on the command line means no stress
+			stressworkers = atoi(optarg) > 0 ? atoi(optarg) : -1;
+			break;
+		default:
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	for (i = 0; i < ctx.sourcecount; i++)
+	{
+		if (sourceDefaults(&ctx.sources[i]) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+		ctx.sources[i].pps.spin.guard = spinguard;
+		// Polled edges scatter over the polling interval, the default bound is never reached
+		if (!confidenceset && (ctx.sources[i].pps.backend == PPS_BACKEND_IOBB ||
+			ctx.sources[i].pps.backend == PPS_BACKEND_SPIN))
+		{
+			ctx.estimator.confidence = PPSSAMPLENS;
+		}
+		// Polled edges are only good to the polling interval
+		if (ctx.sources[i].pps.backend == PPS_BACKEND_IOBB)
+		{
+			for (j = 0; j < ctx.refclockcount; j++)
+			{
+				ctx.refclocks[j].precision = REFCLOCK_PRECISIONPOLL;
+			}
+		}
+	}
+	if (ctx.sourcecount > 1 && threaded)
+	{
+		fprintf(stderr, "Several receivers need the event loop mode\r\n");
+		return EXIT_FAILURE;
+	}
+
+	// No hardware, the servo steers a simulated clock
+	if (replaypath != NULL)
+	{
+		ctx.continuous = 1;
+		ctx.refclockcount = 0;
+		ctx.timepagepath = NULL;
+		ctx.driftpath = NULL;
+		ctx.capturepath = NULL;
+		return replayCapture(&ctx, replaypath);
+	}
+
+	for (i = 0; i < ctx.refclockcount; i++)
+	{
+		if (refclockOpen(&ctx.refclocks[i]) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (ctx.timepagepath != NULL && timePageOpen(&ctx.timepage, ctx.timepagepath) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	// Stop continuous mode cleanly so that UART settings are restored
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = stopHandler;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	// Latency histograms on demand
+	action.sa_handler = dumpHandler;
+	action.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &action, NULL);
+
+	// Configure PPS inputs, UARTs and receivers
+	if (sourcesOpen(&ctx, jitterseconds == 0, baud) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	if (jitterseconds > 0)
+	{
+		result = realtimeApply(&ctx.realtime);
+		if (result == EXIT_SUCCESS)
+		{
+			result = measureJitter(&source->pps, jitterseconds, stressworkers);
+		}
+		sourcesClose(&ctx, ctx.sourcecount);
+		return result;
+	}
+
+	if (ctx.capturepath != NULL)
+	{
+		if (captureOpen(&ctx.capture, ctx.capturepath) == EXIT_FAILURE)
+		{
+			sourcesClose(&ctx, ctx.sourcecount);
+			return EXIT_FAILURE;
+		}
+		for (i = 0; i < ctx.sourcecount; i++)
+		{
+			ctx.sources[i].uart.capture = &ctx.capture;
+			ctx.sources[i].uart.source = i;
+		}
+	}
+
+	// Everything is open and allocated, lock it in
+	if (realtimeApply(&ctx.realtime) == EXIT_FAILURE)
+	{
+		if (ctx.capturepath != NULL)
+		{
+			captureClose(&ctx.capture);
+		}
+		sourcesClose(&ctx, ctx.sourcecount);
+		return EXIT_FAILURE;
+	}
+
+	// A time daemon owns the frequency when samples are exported
+	if (ctx.driftpath != NULL && ctx.refclockcount == 0)
+	{
+		loadDrift(&ctx);
+	}
+
+	if (threaded)
+	{
+		result = syncPipeline(&ctx, source);
+	}
+	else if (eventloop)
+	{
+		result = syncEventLoop(&ctx, controlpath);
+	}
+	else if (ctx.continuous)
+	{
+		while (running)
+		{
+			if (syncCycle(&ctx, source) == EXIT_FAILURE)
+			{
+				failures++;
+				fprintf(stderr, "Synchronization failed, %d in a row\r\n", failures);
+			}
+			else
+			{
+				failures = 0;
+			}
+			latencyEnd();
+			flushCapture(&ctx);
+			holdoverTick(&ctx);
+			if (dumplatency)
+			{
+				dumplatency = 0;
+				latencyDump(stdout);
+			}
+		}
+	}
+	else
+	{
+		// Measure until the estimate is good enough, at most two windows
+		for (attempts = 0; running && !ctx.corrected && attempts < 2 * ctx.estimator.window; attempts++)
+		{
+			syncCycle(&ctx, source);
+			latencyEnd();
+		}
+		if (!ctx.corrected)
+		{
+			fprintf(stderr, "No confident estimate in %d seconds\r\n", attempts);
+			result = EXIT_FAILURE;
+		}
+	}
+	printFramers(&ctx, ctx.sourcecount);
+	latencyDump(stdout);
+	saveDrift(&ctx);
+	if (ctx.capturepath != NULL)
+	{
+		captureClose(&ctx.capture);
+	}
+
+    // Close UARTs and PPS inputs
+    if (sourcesClose(&ctx, ctx.sourcecount) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < ctx.refclockcount; i++)
+	{
+		refclockClose(&ctx.refclocks[i]);
+	}
+	if (ctx.timepagepath != NULL)
+	{
+		timePageClose(&ctx.timepage);
+	}
+
+	if (result == EXIT_SUCCESS && !ctx.continuous)
+	{
+		printf("Time synchronized succesfully\n");
+	}
+    return result;
+}
@@ -0,0 +1,367 @@
+/*
+ * Pipeline.c
+ *
+ * Threaded PPS edge and time log pipeline
+ *
+ * The edge thread only waits for PPS edges, so serial I/O never delays an
+ * edge. It converts each edge to CLOCK_REALTIME and CLOCK_MONOTONIC_RAW at
+ * once and queues it. The UART thread reads the time log stream, frames and
+ * parses the logs and queues them. Both queues are lock-free single
+ * producer, single consumer queues and an eventfd wakes the matcher.
+ *
+ * The matcher pairs a time log with the newest edge seen less than
+ * PIPELINEWINDOW before the log was complete. Older waiting edges never
+ * got a log. A log without such an edge has no edge. Each pair is then
+ * checked against the previous one: the edge sequence numbers and the
+ * GPS seconds must have advanced by the same amount, otherwise an edge
+ * or a log was paired with the wrong second. All of these are reported
+ * and never reach the clock.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+#include "Capture.h"
+#include "Clock.h"
+#include "Latency.h"
+#include "Pipeline.h"
+#include "UART.h"
+
+/**
+ * \brief Wake the matcher
+ *
+ * \param pipeline - Pipeline
+ *
+ */
+static void pipelineWake(struct pipeline* pipeline)
+{
+	uint64_t one = 1;
+
+	if (write(pipeline->wakeup, &one, sizeof(one)) < 0)
+	{
+		perror("Pipeline wakeup failed:");
+	}
+}
+
+/**
+ * \brief Edge thread
+ *
+ * \param arg - Pipeline
+ *
+ * \return NULL
+ *
+ */
+static void* edgeThread(void* arg)
+{
+	struct pipeline* pipeline = arg;
+	struct edgeevent event;
+	struct timespec now;
+
+	while (!__atomic_load_n(&pipeline->stop, __ATOMIC_RELAXED))
+	{
+		if (ppsSourceWait(pipeline->pps, &event.edge) == EXIT_FAILURE)
+		{
+			continue;
+		}
+		clock_gettime(event.edge.clock, &now);
+		event.seen = clockMonotonicNs();
+		event.detection = (int64_t)(now.tv_sec - event.edge.stamp.tv_sec) * GPSTIME_NS +
+			(now.tv_nsec - event.edge.stamp.tv_nsec);
+		// Convert now, the clocks run at different rates
+		event.realtime = event.edge;
+		event.realtime.clock = CLOCK_REALTIME;
+		if (clockRealtimeAt(&event.edge.stamp, event.edge.clock, &event.realtime.stamp) == EXIT_FAILURE ||
+			clockAt(&event.edge.stamp, event.edge.clock, CLOCK_MONOTONIC_RAW, &event.anchor) == EXIT_FAILURE)
+		{
+			continue;
+		}
+		if (pipeline->uart->capture != NULL)
+		{
+			captureEdge(pipeline->uart->capture, pipeline->uart->source, &event.realtime.stamp, event.edge.sequence);
+		}
+		if (!queuePush(&pipeline->edges, &event))
+		{
+			fprintf(stderr, "Edge %lu dropped, queue full\r\n", event.edge.sequence);
+			continue;
+		}
+		pipelineWake(pipeline);
+	}
+	return NULL;
+}
+
+/**
+ * \brief UART thread
+ *
+ * \param arg - Pipeline
+ *
+ * \return NULL
+ *
+ */
+static void* uartThread(void* arg)
+{
+	struct pipeline* pipeline = arg;
+	struct logevent event;
+	char* frame;
+	size_t length;
+
+	while (!__atomic_load_n(&pipeline->stop, __ATOMIC_RELAXED))
+	{
+		if (uartTimelogRead(pipeline->uart, pipeline->framer, &frame, &length, PIPELINEUARTTIMEOUT) == EXIT_FAILURE)
+		{
+			continue;
+		}
+		event.framed = clockMonotonicNs();
+		if (parseTimelogFrame(frame, length, &event.log) == EXIT_FAILURE ||
+			timelogUtcTime(&event.log, &event.utctime) == EXIT_FAILURE)
+		{
+			continue;
+		}
+		event.parsed = clockMonotonicNs();
+		if (!queuePush(&pipeline->logs, &event))
+		{
+			fprintf(stderr, "Time log dropped, queue full\r\n");
+			continue;
+		}
+		pipelineWake(pipeline);
+	}
+	return NULL;
+}
+
+/**
+ * \brief Start the edge and UART threads
+ *
+ * The threads inherit the scheduling profile, the stop and dump signals
+ * are only delivered to the calling thread.
+ *
+ * \param pipeline - Pipeline
+ * \param pps - Opened PPS source
+ * \param uart - Opened receiver UART
+ * \param framer - Time log framer
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int pipelineStart(struct pipeline* pipeline, struct ppssource* pps, struct uart* uart, struct framer* framer)
+{
+	sigset_t block, old;
+	int ret;
+
+	memset(pipeline, 0, sizeof(*pipeline));
+	pipeline->pps = pps;
+	pipeline->uart = uart;
+	pipeline->framer = framer;
+	queueInit(&pipeline->edges, pipeline->edgeslots, sizeof(struct edgeevent), PIPELINESLOTS);
+	queueInit(&pipeline->logs, pipeline->logslots, sizeof(struct logevent), PIPELINESLOTS);
+	pipeline->wakeup = eventfd(0, 0);
+	if (pipeline->wakeup < 0)
+	{
+		perror("eventfd failed:");
+		return EXIT_FAILURE;
+	}
+
+	sigfillset(&block);
+	pthread_sigmask(SIG_BLOCK, &block, &old);
+	ret = pthread_create(&pipeline->edgethread, NULL, edgeThread, pipeline);
+	if (ret == 0)
+	{
+		ret = pthread_create(&pipeline->uartthread, NULL, uartThread, pipeline);
+		if (ret != 0)
+		{
+			__atomic_store_n(&pipeline->stop, 1, __ATOMIC_RELAXED);
+			pthread_join(pipeline->edgethread, NULL);
+		}
+	}
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+	if (ret != 0)
+	{
+		fprintf(stderr, "Pipeline thread start failed: %s\r\n", strerror(ret));
+		close(pipeline->wakeup);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Drop the oldest waiting edges
+ *
+ * \param pipeline - Pipeline
+ * \param count - Number of edges to drop
+ *
+ */
+static void pipelineDropEdges(struct pipeline* pipeline, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		fprintf(stderr, "Edge %lu unmatched, no time log\r\n", pipeline->pending[i].edge.sequence);
+		pipeline->unmatchededges++;
+	}
+	pipeline->pendingcount -= count;
+	memmove(pipeline->pending, pipeline->pending + count, pipeline->pendingcount * sizeof(pipeline->pending[0]));
+}
+
+/**
+ * \brief Match a time log with a waiting edge
+ *
+ * \param pipeline - Pipeline
+ * \param log - Time log
+ * \param pair - Return the pair
+ *
+ * \return 1 if a checked pair was returned, 0 otherwise
+ *
+ */
+static int pipelineMatch(struct pipeline* pipeline, const struct logevent* log, struct pipelinepair* pair)
+{
+	int64_t seconds;
+	int i;
+
+	// Newest edge seen before the log and within the window
+	for (i = pipeline->pendingcount - 1; i >= 0; i--)
+	{
+		if (pipeline->pending[i].seen < log->framed)
+		{
+			break;
+		}
+	}
+	if (i < 0 || log->framed - pipeline->pending[i].seen >= PIPELINEWINDOW)
+	{
+		fprintf(stderr, "Time log %lld unmatched, no edge\r\n", (long long)(log->utctime.ns / GPSTIME_NS));
+		pipeline->unmatchedlogs++;
+		return 0;
+	}
+	pair->edge = pipeline->pending[i];
+	pair->log = *log;
+	pipelineDropEdges(pipeline, i);
+	pipeline->pendingcount--;
+	memmove(pipeline->pending, pipeline->pending + 1, pipeline->pendingcount * sizeof(pipeline->pending[0]));
+
+	// Sequence numbers and GPS seconds advance together
+	if (pipeline->havelast)
+	{
+		seconds = (pair->log.utctime.ns - pipeline->lastutc + GPSTIME_NS / 2) / GPSTIME_NS;
+		if (seconds != (int64_t)(pair->edge.edge.sequence - pipeline->lastsequence))
+		{
+			fprintf(stderr, "Edge %lu and time log %lld do not follow edge %lu and time log %lld\r\n",
+				pair->edge.edge.sequence, (long long)(pair->log.utctime.ns / GPSTIME_NS),
+				pipeline->lastsequence, (long long)(pipeline->lastutc / GPSTIME_NS));
+			pipeline->mismatched++;
+			// Start over from this pair
+			pipeline->lastsequence = pair->edge.edge.sequence;
+			pipeline->lastutc = pair->log.utctime.ns;
+			return 0;
+		}
+	}
+	pipeline->havelast = 1;
+	pipeline->lastsequence = pair->edge.edge.sequence;
+	pipeline->lastutc = pair->log.utctime.ns;
+	pipeline->matched++;
+
+	latencyAdd(LATENCY_EDGE, pair->edge.detection);
+	latencyAdd(LATENCY_FRAME, pair->log.framed - pair->edge.seen);
+	latencyAdd(LATENCY_PARSE, pair->log.parsed - pair->log.framed);
+	return 1;
+}
+
+/**
+ * \brief Next matched edge and time log
+ *
+ * Block until a checked pair is available or nothing has arrived for the
+ * timeout. Unmatched events are reported on the way.
+ *
+ * \param pipeline - Pipeline
+ * \param pair - Return the pair
+ * \param timeoutms - Longest wait for the threads in ms, -1 = forever
+ *
+ * \return EXIT_SUCCESS with a pair, EXIT_FAILURE on timeout or if interrupted by a signal
+ *
+ */
+int pipelineNext(struct pipeline* pipeline, struct pipelinepair* pair, int timeoutms)
+{
+	struct pollfd wait;
+	struct logevent log;
+	uint64_t count;
+	int ready;
+
+	for (;;)
+	{
+		// Edges first, the edge of a log is always queued before the log
+		while (queuePop(&pipeline->edges, &pipeline->pending[pipeline->pendingcount]))
+		{
+			pipeline->pendingcount++;
+			if (pipeline->pendingcount == PIPELINEPENDING)
+			{
+				pipelineDropEdges(pipeline, 1);
+			}
+		}
+		while (queuePop(&pipeline->logs, &log))
+		{
+			if (pipelineMatch(pipeline, &log, pair))
+			{
+				return EXIT_SUCCESS;
+			}
+		}
+
+		wait.fd = pipeline->wakeup;
+		wait.events = POLLIN;
+		ready = poll(&wait, 1, timeoutms);
+		if (ready == 0)
+		{
+			return EXIT_FAILURE;
+		}
+		if (ready < 0 || read(pipeline->wakeup, &count, sizeof(count)) < 0)
+		{
+			if (errno != EINTR)
+			{
+				perror("Pipeline wait failed:");
+			}
+			return EXIT_FAILURE;
+		}
+	}
+}
+
+/**
+ * \brief Record the end of a processed pair
+ *
+ * \param pair - Pair returned by pipelineNext()
+ *
+ */
+void pipelineDone(const struct pipelinepair* pair)
+{
+	int64_t now = clockMonotonicNs();
+
+	latencyAdd(LATENCY_CLOCK, now - pair->log.parsed);
+	latencyAdd(LATENCY_TOTAL, now - pair->edge.seen);
+}
+
+/**
+ * \brief Stop the threads
+ *
+ * The threads finish their current wait, at most the PPS and UART timeouts.
+ *
+ * \param pipeline - Pipeline
+ *
+ */
+void pipelineStop(struct pipeline* pipeline)
+{
+	__atomic_store_n(&pipeline->stop, 1, __ATOMIC_RELAXED);
+	pthread_join(pipeline->edgethread, NULL);
+	pthread_join(pipeline->uartthread, NULL);
+	close(pipeline->wakeup);
+	printf("Pipeline: %lu pairs, %lu edges and %lu time logs unmatched, %lu pairs out of sequence\n",
+		pipeline->matched, pipeline->unmatchededges, pipeline->unmatchedlogs, pipeline->mismatched);
+}
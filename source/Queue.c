@@ -0,0 +1,98 @@
+/*
+ * Queue.c
+ *
+ * Lock-free single producer, single consumer queue
+ *
+ * One thread pushes and one thread pops. head and tail are free running
+ * counters, each written by one side only. The producer publishes an
+ * element by storing head with release order after copying it in, the
+ * consumer frees a slot by storing tail with release order after copying
+ * it out. Neither side ever blocks or waits for the other.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Queue.h"
+
+/**
+ * \brief Initialize queue
+ *
+ * \param queue - Queue
+ * \param storage - slots * size bytes for the elements
+ * \param size - Element size in bytes
+ * \param slots - Number of elements, power of two
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if slots is not a power of two
+ *
+ */
+int queueInit(struct queue* queue, void* storage, size_t size, unsigned int slots)
+{
+	if (slots == 0 || (slots & (slots - 1)) != 0)
+	{
+		fprintf(stderr, "Queue size %u is not a power of two\r\n", slots);
+		return EXIT_FAILURE;
+	}
+	queue->head = 0;
+	queue->tail = 0;
+	queue->slots = slots;
+	queue->size = size;
+	queue->data = storage;
+	queue->full = 0;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Push an element, producer only
+ *
+ * \param queue - Queue
+ * \param element - Element to copy in
+ *
+ * \return 1 if pushed, 0 if the queue was full
+ *
+ */
+int queuePush(struct queue* queue, const void* element)
+{
+	unsigned int head = queue->head;
+	unsigned int tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+	if (head - tail == queue->slots)
+	{
+		queue->full++;
+		return 0;
+	}
+	memcpy(queue->data + (head & (queue->slots - 1)) * queue->size, element, queue->size);
+	__atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/**
+ * \brief Pop an element, consumer only
+ *
+ * \param queue - Queue
+ * \param element - Return the element
+ *
+ * \return 1 if popped, 0 if the queue was empty
+ *
+ */
+int queuePop(struct queue* queue, void* element)
+{
+	unsigned int tail = queue->tail;
+	unsigned int head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+
+	if (head == tail)
+	{
+		return 0;
+	}
+	memcpy(element, queue->data + (tail & (queue->slots - 1)) * queue->size, queue->size);
+	__atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+	return 1;
+}
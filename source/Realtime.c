@@ -0,0 +1,214 @@
+/*
+ * Realtime.c
+ *
+ * Real-time execution profile and synthetic load
+ *
+ * A late PPS edge time stamp is a clock error, so the PPS wait can run with
+ * a real-time profile: pinned to one CPU, minimum timer slack, all memory
+ * locked and the stack pre-faulted so that no page fault happens in the
+ * loop, and SCHED_FIFO. SCHED_RESET_ON_FORK keeps children on SCHED_OTHER.
+ *
+ * The stress workers are child processes on SCHED_OTHER spread over all
+ * CPUs. Even workers spin on the CPU, odd ones walk a large buffer to
+ * evict caches and TLBs, so that edge detection latency can be measured
+ * under load.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#define _GNU_SOURCE // sched_setaffinity(), SCHED_RESET_ON_FORK
+#include <sched.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+
+#include "Realtime.h"
+
+#define STRESSSTRIDE 64 // Bytes between memory stress writes, one cache line
+
+/**
+ * \brief Touch the stack
+ *
+ * With mlockall() in effect the touched pages stay resident.
+ *
+ */
+static void prefaultStack(void)
+{
+	volatile unsigned char stack[REALTIME_STACKPREFAULT];
+	size_t i;
+
+	for (i = 0; i < sizeof(stack); i += 4096)
+	{
+		stack[i] = 0;
+	}
+}
+
+/**
+ * \brief Apply the real-time profile
+ *
+ * Call after the PPS source and UART are open, their buffers are locked too.
+ *
+ * \param profile - Profile
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int realtimeApply(const struct rtprofile* profile)
+{
+	struct sched_param param;
+	cpu_set_t cpus;
+
+	if (profile->cpu >= 0)
+	{
+		CPU_ZERO(&cpus);
+		CPU_SET(profile->cpu, &cpus);
+		if (sched_setaffinity(0, sizeof(cpus), &cpus) < 0)
+		{
+			perror("sched_setaffinity failed:");
+			return EXIT_FAILURE;
+		}
+	}
+	if (profile->priority <= 0)
+	{
+		return EXIT_SUCCESS;
+	}
+
+	// 0 would restore the default 50us, 1ns is the minimum
+	if (prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL) < 0)
+	{
+		perror("PR_SET_TIMERSLACK failed:");
+		return EXIT_FAILURE;
+	}
+	if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+	{
+		perror("mlockall failed:");
+		return EXIT_FAILURE;
+	}
+	prefaultStack();
+
+	memset(&param, 0, sizeof(param));
+	param.sched_priority = profile->priority;
+	if (sched_setscheduler(0, SCHED_FIFO | SCHED_RESET_ON_FORK, &param) < 0)
+	{
+		perror("sched_setscheduler failed:");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Stress worker
+ *
+ * Runs until killed.
+ *
+ * \param index - Worker number
+ *
+ */
+static void stressWorker(int index)
+{
+	cpu_set_t cpus;
+	volatile unsigned char* buffer;
+	volatile uint32_t spin = 0;
+	size_t i;
+	int cpu;
+
+	// Not pinned with the parent, not locked: mlockall() is not inherited
+	CPU_ZERO(&cpus);
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		CPU_SET(cpu, &cpus);
+	}
+	sched_setaffinity(0, sizeof(cpus), &cpus);
+
+	if (index % 2 == 0)
+	{
+		for (;;)
+		{
+			spin = spin * 1664525 + 1013904223;
+		}
+	}
+	buffer = malloc(REALTIME_STRESSMEMORY);
+	if (buffer == NULL)
+	{
+		_exit(EXIT_FAILURE);
+	}
+	for (;;)
+	{
+		for (i = 0; i < REALTIME_STRESSMEMORY; i += STRESSSTRIDE)
+		{
+			buffer[i]++;
+		}
+	}
+}
+
+/**
+ * \brief Start stress workers
+ *
+ * \param stress - Return the workers
+ * \param workers - Number of workers, 0 = one per online CPU
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int realtimeStressStart(struct rtstress* stress, int workers)
+{
+	pid_t pid;
+
+	if (workers <= 0)
+	{
+		workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	}
+	if (workers > REALTIME_STRESSMAX)
+	{
+		workers = REALTIME_STRESSMAX;
+	}
+	stress->workers = 0;
+	while (stress->workers < workers)
+	{
+		pid = fork();
+		if (pid < 0)
+		{
+			perror("Stress worker fork failed:");
+			realtimeStressStop(stress);
+			return EXIT_FAILURE;
+		}
+		if (pid == 0)
+		{
+			stressWorker(stress->workers);
+		}
+		stress->pids[stress->workers++] = pid;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Stop stress workers
+ *
+ * \param stress - Workers
+ *
+ */
+void realtimeStressStop(struct rtstress* stress)
+{
+	int i;
+
+	for (i = 0; i < stress->workers; i++)
+	{
+		kill(stress->pids[i], SIGKILL);
+	}
+	for (i = 0; i < stress->workers; i++)
+	{
+		waitpid(stress->pids[i], NULL, 0);
+	}
+	stress->workers = 0;
+}
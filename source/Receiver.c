@@ -0,0 +1,110 @@
+/*
+ * Receiver.c
+ *
+ * GNSS receiver configuration
+ *
+ * Bring the receiver link up at startup. The receiver may be at its factory
+ * rate of 9600 bps or at a rate left by an earlier run, so the rate is
+ * found by sending UNLOGALL at each candidate rate until it is
+ * acknowledged. The receiver is then switched to the requested rate, the
+ * local port follows, and the time log is requested. Every command waits
+ * for its "<OK", so the first log arrives as soon as the receiver is ready.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "Receiver.h"
+#include "UART.h"
+
+// Rates tried when looking for the current receiver rate, most likely first
+static const int receiverbauds[] = {9600, 115200, 230400, 460800, 921600, 57600, 38400, 19200};
+
+/**
+ * \brief Find the current receiver link rate
+ *
+ * Try the requested rate first, then the others. UNLOGALL also stops any
+ * logs left running, so the responses are not lost among them.
+ *
+ * \param uart - Receiver UART
+ * \param baud - Requested rate in bps
+ *
+ * \return Current rate in bps, 0 if the receiver did not respond
+ *
+ */
+static int receiverProbe(struct uart* uart, int baud)
+{
+	unsigned int i;
+
+	if (uartSetSpeed(uart, baud) == EXIT_SUCCESS && uartCommand(uart, "UNLOGALL", RECEIVERPROBEMS) == EXIT_SUCCESS)
+	{
+		return baud;
+	}
+	for (i = 0; i < sizeof(receiverbauds) / sizeof(receiverbauds[0]); i++)
+	{
+		if (receiverbauds[i] == baud)
+		{
+			continue;
+		}
+		if (uartSetSpeed(uart, receiverbauds[i]) == EXIT_SUCCESS &&
+			uartCommand(uart, "UNLOGALL", RECEIVERPROBEMS) == EXIT_SUCCESS)
+		{
+			return receiverbauds[i];
+		}
+	}
+	return 0;
+}
+
+/**
+ * \brief Configure the receiver
+ *
+ * Find the current link rate, switch the receiver and the UART to the
+ * requested rate and request the time log once per second.
+ *
+ * \param uart - Receiver UART
+ * \param binary - Request binary TIMEB instead of ASCII TIMESYNCA
+ * \param baud - Link rate in bps
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int receiverConfigure(struct uart* uart, int binary, int baud)
+{
+	char command[48];
+	int current;
+
+	current = receiverProbe(uart, baud);
+	if (current == 0)
+	{
+		fprintf(stderr, "Receiver on %s does not respond\r\n", uart->device);
+		return EXIT_FAILURE;
+	}
+
+	if (current != baud)
+	{
+		// The receiver answers at the old rate and switches after the response
+		snprintf(command, sizeof(command), "COM COM1 %d N 8 1 N OFF ON", baud);
+		if (uartCommand(uart, command, RECEIVERCMDTIMEOUTMS) == EXIT_FAILURE ||
+			uartSetSpeed(uart, baud) == EXIT_FAILURE ||
+			uartCommand(uart, "UNLOGALL", RECEIVERCMDTIMEOUTMS) == EXIT_FAILURE)
+		{
+			fprintf(stderr, "Receiver rate change from %d to %d bps failed\r\n", current, baud);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// ONTIME 1 keeps the log coming every second
+	if (uartCommand(uart, binary ? "LOG COM1 TIMEB ONTIME 1" : "LOG COM1 TIMESYNCA ONTIME 1",
+		RECEIVERCMDTIMEOUTMS) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,220 @@
+/*
+ * Refclock.c
+ *
+ * Reference clock exporters for ntpd and chronyd
+ *
+ * Instead of adjusting the clock, each PPS sample (system time at the
+ * edge, GPS UTC time at the edge) is handed to a time daemon that already
+ * runs on the host.
+ *
+ * SHM: the NTP shared memory segment, key 0x4e545030 + unit. Units 0 and
+ * 1 are readable by root only. The sample is written with the count/valid
+ * protocol: valid is cleared, count is incremented, the fields are
+ * written, count is incremented again and valid is set. A reader that
+ * sees count change while reading retries.
+ * ntpd: server 127.127.28.0, chronyd: refclock SHM 0
+ *
+ * SOCK: chrony's SOCK refclock, one datagram per sample to the Unix socket
+ * chronyd created. The socket is addressed on every send, so samples reach
+ * chronyd when it starts later or restarts and recreates the socket.
+ * chronyd: refclock SOCK /var/run/chrony.ttyS1.sock
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+#include "GPSTime.h"
+#include "Refclock.h"
+
+/**
+ * \brief Parse exporter specification
+ *
+ * "shm:N" for NTP SHM unit N, "sock:/path" for a chrony SOCK socket.
+ *
+ * \param spec - Specification
+ * \param refclock - Return the exporter configuration
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on unknown specification
+ *
+ */
+int refclockParse(const char* spec, struct refclock* refclock)
+{
+	char* end;
+
+	memset(refclock, 0, sizeof(*refclock));
+	refclock->precision = REFCLOCK_PRECISION;
+	refclock->fd = -1;
+	if (strncmp(spec, "shm:", 4) == 0)
+	{
+		refclock->type = REFCLOCK_SHM;
+		refclock->unit = (int)strtol(spec + 4, &end, 10);
+		if (end != spec + 4 && *end == '\0' && refclock->unit >= 0)
+		{
+			return EXIT_SUCCESS;
+		}
+	}
+	else if (strncmp(spec, "sock:", 5) == 0 && spec[5] != '\0')
+	{
+		refclock->type = REFCLOCK_SOCK;
+		refclock->path = spec + 5;
+		return EXIT_SUCCESS;
+	}
+	fprintf(stderr, "Unknown output %s, use shm:N or sock:/path\r\n", spec);
+	return EXIT_FAILURE;
+}
+
+/**
+ * \brief Open exporter
+ *
+ * Create or attach the SHM segment, or open the datagram socket.
+ *
+ * \param refclock - Exporter
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int refclockOpen(struct refclock* refclock)
+{
+	void* segment;
+	int id;
+
+	if (refclock->type == REFCLOCK_SHM)
+	{
+		// Units 0 and 1 are for root only, as in ntpd
+		id = shmget(REFCLOCK_SHMKEY + refclock->unit, sizeof(struct shmTime),
+			IPC_CREAT | (refclock->unit < 2 ? 0600 : 0666));
+		if (id < 0)
+		{
+			perror("NTP SHM shmget failed:");
+			return EXIT_FAILURE;
+		}
+		segment = shmat(id, NULL, 0);
+		if (segment == (void*)-1)
+		{
+			perror("NTP SHM shmat failed:");
+			return EXIT_FAILURE;
+		}
+		refclock->shm = segment;
+		refclock->shm->mode = 1;
+		refclock->shm->valid = 0;
+		return EXIT_SUCCESS;
+	}
+
+	if (strlen(refclock->path) >= sizeof(refclock->address.sun_path))
+	{
+		fprintf(stderr, "Socket path too long: %s\r\n", refclock->path);
+		return EXIT_FAILURE;
+	}
+	refclock->fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (refclock->fd < 0)
+	{
+		perror("chrony SOCK socket failed:");
+		return EXIT_FAILURE;
+	}
+	memset(&refclock->address, 0, sizeof(refclock->address));
+	refclock->address.sun_family = AF_UNIX;
+	strcpy(refclock->address.sun_path, refclock->path);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Publish one sample
+ *
+ * \param refclock - Exporter
+ * \param receive - System time (CLOCK_REALTIME) at the PPS edge
+ * \param reference - GPS UTC time at the PPS edge
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int refclockPublish(struct refclock* refclock, const struct timespec* receive, const struct gpstime* reference)
+{
+	struct timespec clock;
+	struct timespec truncated;
+	struct socksample sample;
+	struct gpstime system;
+	struct shmTime* shm = refclock->shm;
+
+	gpsTimeToTimespec(reference, &clock);
+
+	if (refclock->type == REFCLOCK_SHM)
+	{
+		shm->valid = 0;
+		shm->count++;
+		__sync_synchronize();
+		shm->clockTimeStampSec = clock.tv_sec;
+		shm->clockTimeStampUSec = (int)(clock.tv_nsec / 1000);
+		shm->clockTimeStampNSec = (unsigned)clock.tv_nsec;
+		shm->receiveTimeStampSec = receive->tv_sec;
+		shm->receiveTimeStampUSec = (int)(receive->tv_nsec / 1000);
+		shm->receiveTimeStampNSec = (unsigned)receive->tv_nsec;
+		shm->leap = 0;
+		shm->precision = refclock->precision;
+		shm->nsamples = 3;
+		__sync_synchronize();
+		shm->count++;
+		shm->valid = 1;
+		return EXIT_SUCCESS;
+	}
+
+	memset(&sample, 0, sizeof(sample));
+	sample.tv.tv_sec = receive->tv_sec;
+	sample.tv.tv_usec = receive->tv_nsec / 1000;
+	// Offset from the microsecond time stamp, so the nanoseconds are kept
+	truncated.tv_sec = sample.tv.tv_sec;
+	truncated.tv_nsec = sample.tv.tv_usec * 1000;
+	gpsTimeFromTimespec(&truncated, &system);
+	sample.offset = gpsTimeDiff(reference, &system) / 1e9;
+	sample.pulse = 0;
+	sample.leap = 0;
+	sample.magic = REFCLOCK_SOCKMAGIC;
+	// chronyd may start later, sendto() fails until then
+	if (sendto(refclock->fd, &sample, sizeof(sample), 0,
+		(const struct sockaddr*)&refclock->address, sizeof(refclock->address)) < 0)
+	{
+		perror(refclock->path);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Close exporter
+ *
+ * The SHM segment stays for the daemon, it is only detached.
+ *
+ * \param refclock - Exporter
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int refclockClose(struct refclock* refclock)
+{
+	if (refclock->shm != NULL)
+	{
+		refclock->shm->valid = 0;
+		shmdt(refclock->shm);
+		refclock->shm = NULL;
+	}
+	if (refclock->fd >= 0)
+	{
+		close(refclock->fd);
+		refclock->fd = -1;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,274 @@
+/*
+ * Select.c
+ *
+ * Source selection and combining
+ *
+ * Every source measures the system clock offset at its own PPS edge of
+ * the same second. Each offset gets an error bound from the edge time
+ * stamping, the scatter of the source around earlier combined offsets and
+ * the receiver clock status. Marzullo's intersection finds the largest
+ * group of sources whose offset intervals overlap. Sources outside the
+ * group are falsetickers. With three or more sources the group must be a
+ * majority; two disagreeing sources are resolved by clock status and then
+ * by the source selected before. The offsets of the group are averaged,
+ * weighted by the inverse square of their error bounds.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Select.h"
+
+/****************************************************************
+ * Types
+ ****************************************************************/
+// Interval end point for the intersection sweep
+struct endpoint
+{
+	int64_t value;	// Offset in ns
+	int type;		// +1 lower end, -1 upper end
+};
+
+/**
+ * \brief Initialize selector
+ *
+ * \param selector - Selector to initialize
+ *
+ */
+void selectInit(struct selector* selector)
+{
+	memset(selector, 0, sizeof(*selector));
+	selector->selected = -1;
+}
+
+/**
+ * \brief Error bound of a sample
+ *
+ * \param selector - Selector
+ * \param sample - Sample
+ *
+ * \return Error bound in ns, 0 if the sample can not be used
+ *
+ */
+static int64_t selectError(const struct selector* selector, const struct selectsample* sample)
+{
+	int64_t error = sample->error;
+
+	if ((double)error < selector->jitter[sample->source])
+	{
+		error = (int64_t)selector->jitter[sample->source];
+	}
+	if (error < 1)
+	{
+		error = 1;
+	}
+	switch (sample->clock)
+	{
+	case CLOCKSTATUS_VALID:
+		return error;
+	case CLOCKSTATUS_CONVERGING:
+		return error * SELECT_CONVERGING;
+	case CLOCKSTATUS_ITERATING:
+		return error * SELECT_ITERATING;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * \brief Intersection of the most intervals
+ *
+ * Sweep the sorted interval end points. Lower ends sort before upper
+ * ends of the same value, so touching intervals overlap.
+ *
+ * \param lower - Lower ends
+ * \param upper - Upper ends
+ * \param count - Number of intervals
+ * \param low - Return the lower end of the intersection
+ * \param high - Return the upper end of the intersection
+ *
+ * \return Number of intervals containing the intersection
+ *
+ */
+static int selectIntersect(const int64_t* lower, const int64_t* upper, int count, int64_t* low, int64_t* high)
+{
+	struct endpoint points[2 * SELECTMAX];
+	struct endpoint point;
+	int total = 2 * count;
+	int overlap = 0;
+	int best = 0;
+	int i;
+	int j;
+
+	for (i = 0; i < count; i++)
+	{
+		points[2 * i].value = lower[i];
+		points[2 * i].type = 1;
+		points[2 * i + 1].value = upper[i];
+		points[2 * i + 1].type = -1;
+	}
+	// Insertion sort, at most 2 * SELECTMAX points
+	for (i = 1; i < total; i++)
+	{
+		point = points[i];
+		for (j = i; j > 0 && (points[j - 1].value > point.value ||
+			(points[j - 1].value == point.value && points[j - 1].type < point.type)); j--)
+		{
+			points[j] = points[j - 1];
+		}
+		points[j] = point;
+	}
+
+	for (i = 0; i < total; i++)
+	{
+		overlap += points[i].type;
+		if (overlap > best)
+		{
+			// Only a lower end raises the overlap, the next point ends the region
+			best = overlap;
+			*low = points[i].value;
+			*high = points[i + 1].value;
+		}
+	}
+	return best;
+}
+
+/**
+ * \brief Combine the samples of one round
+ *
+ * Reject falsetickers, average the truechimers and update the source
+ * scatter. At least one truechimer must have a valid receiver clock.
+ *
+ * \param selector - Selector
+ * \param samples - One sample per source, in any order
+ * \param count - Number of samples, 1-SELECTMAX
+ * \param offset - Return the combined offset in ns
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if the sources do not agree
+ *
+ */
+int selectCombine(struct selector* selector, const struct selectsample* samples, int count, int64_t* offset)
+{
+	int64_t error[SELECTMAX];
+	int64_t lower[SELECTMAX];
+	int64_t upper[SELECTMAX];
+	int index[SELECTMAX];
+	int truechimer[SELECTMAX];
+	int64_t low = 0;
+	int64_t high = 0;
+	int usable = 0;
+	int agree;
+	int valid = 0;
+	int best = -1;
+	double weight;
+	double sum = 0.0;
+	double weights = 0.0;
+	int i;
+	int a;
+	int b;
+
+	for (i = 0; i < count; i++)
+	{
+		error[i] = selectError(selector, &samples[i]);
+		if (error[i] == 0)
+		{
+			continue;
+		}
+		index[usable] = i;
+		lower[usable] = samples[i].offset - error[i];
+		upper[usable] = samples[i].offset + error[i];
+		usable++;
+	}
+	if (usable == 0)
+	{
+		fprintf(stderr, "No source with a usable clock\r\n");
+		return EXIT_FAILURE;
+	}
+
+	agree = selectIntersect(lower, upper, usable, &low, &high);
+	for (i = 0; i < usable; i++)
+	{
+		truechimer[i] = (lower[i] <= low && upper[i] >= high);
+	}
+	if (usable >= 3 && agree <= usable / 2)
+	{
+		fprintf(stderr, "No majority, %d of %d sources agree\r\n", agree, usable);
+		return EXIT_FAILURE;
+	}
+	if (usable == 2 && agree == 1)
+	{
+		// No majority of two, keep the better clock or the source used before
+		a = index[0];
+		b = index[1];
+		if (samples[a].clock != samples[b].clock)
+		{
+			truechimer[0] = samples[a].clock < samples[b].clock;
+		}
+		else if (samples[b].source == selector->selected)
+		{
+			truechimer[0] = 0;
+		}
+		else if (samples[a].source != selector->selected)
+		{
+			truechimer[0] = error[a] <= error[b];
+		}
+		else
+		{
+			truechimer[0] = 1;
+		}
+		truechimer[1] = !truechimer[0];
+		agree = 1;
+	}
+
+	for (i = 0; i < usable; i++)
+	{
+		a = index[i];
+		if (!truechimer[i])
+		{
+			selector->falsetickers[samples[a].source]++;
+			continue;
+		}
+		if (samples[a].clock == CLOCKSTATUS_VALID)
+		{
+			valid = 1;
+		}
+		weight = 1.0 / ((double)error[a] * (double)error[a]);
+		sum += weight * (double)samples[a].offset;
+		weights += weight;
+		// Smallest error wins, the source selected before wins ties
+		if (best < 0 || error[a] < error[best] ||
+			(error[a] == error[best] && samples[a].source == selector->selected))
+		{
+			best = a;
+		}
+	}
+	if (!valid)
+	{
+		fprintf(stderr, "No source with a valid clock among %d agreeing\r\n", agree);
+		return EXIT_FAILURE;
+	}
+
+	*offset = (int64_t)(sum / weights);
+	for (i = 0; i < usable; i++)
+	{
+		a = index[i];
+		if (truechimer[i])
+		{
+			selector->jitter[samples[a].source] += SELECT_JITTERGAIN *
+				((double)llabs(samples[a].offset - *offset) - selector->jitter[samples[a].source]);
+		}
+	}
+	selector->selected = samples[best].source;
+	selector->truechimers = agree;
+	selector->rounds++;
+	return EXIT_SUCCESS;
+}
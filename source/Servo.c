@@ -0,0 +1,168 @@
+/*
+ * Servo.c
+ *
+ * PI clock servo
+ *
+ * The servo turns measured clock offsets into frequency adjustments.
+ * The proportional term corrects the phase, the integrator learns the
+ * oscillator frequency error. Large offsets before lock are reported as
+ * SERVO_JUMP so that the caller can step once. After lock the clock is
+ * only slewed, so time never jumps.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "Servo.h"
+
+/**
+ * \brief Initialize servo
+ *
+ * Set default gains and thresholds and clear the state.
+ * Configuration fields may be changed after this call.
+ *
+ * \param servo - Servo to initialize
+ *
+ */
+void servoInit(struct servo* servo)
+{
+	servo->kp = SERVO_KP;
+	servo->ki = SERVO_KI;
+	servo->stepthreshold = SERVO_STEPTHRESHOLD;
+	servo->lockthreshold = SERVO_LOCKTHRESHOLD;
+	servo->lockcount = SERVO_LOCKCOUNT;
+	servo->maxfrequency = SERVO_MAXFREQ;
+	servo->drift = 0.0;
+	servo->frequency = 0.0;
+	servo->inlock = 0;
+	servo->haslocked = 0;
+	servo->state = SERVO_UNLOCKED;
+}
+
+/**
+ * \brief Limit frequency adjustment
+ *
+ * \param value - Frequency in ppb
+ * \param limit - Limit in ppb
+ *
+ * \return Limited frequency in ppb
+ *
+ */
+static double clampFrequency(double value, double limit)
+{
+	if (value > limit)
+	{
+		return limit;
+	}
+	if (value < -limit)
+	{
+		return -limit;
+	}
+	return value;
+}
+
+/**
+ * \brief Process one offset sample
+ *
+ * Offsets are local clock minus reference, so a positive offset means the
+ * local clock is ahead and must be slowed down.
+ * SERVO_JUMP: the caller steps the clock by -offset and sets the returned
+ * frequency. Otherwise the caller only sets the returned frequency.
+ *
+ * \param servo - Servo
+ * \param offset - Local clock minus reference in ns
+ * \param interval - Time since the previous sample in seconds
+ * \param frequency - Return the frequency adjustment to apply in ppb
+ *
+ * \return Servo state after the sample
+ *
+ */
+enum servostate servoSample(struct servo* servo, int64_t offset, double interval, double* frequency)
+{
+	int64_t magnitude = llabs(offset);
+
+	// Step large initial errors. Once locked, never step
+	if (!servo->haslocked && servo->stepthreshold > 0 && magnitude > servo->stepthreshold)
+	{
+		servo->inlock = 0;
+		servo->state = SERVO_JUMP;
+		servo->frequency = clampFrequency(-servo->drift, servo->maxfrequency);
+		*frequency = servo->frequency;
+		return servo->state;
+	}
+
+	// 1ns offset over 1s is 1ppb
+	servo->drift = clampFrequency(servo->drift + servo->ki * offset * interval, servo->maxfrequency);
+	servo->frequency = clampFrequency(-(servo->kp * offset + servo->drift), servo->maxfrequency);
+	*frequency = servo->frequency;
+
+	if (magnitude <= servo->lockthreshold)
+	{
+		if (servo->inlock < servo->lockcount)
+		{
+			servo->inlock++;
+		}
+	}
+	else
+	{
+		servo->inlock = 0;
+	}
+	if (servo->inlock >= servo->lockcount)
+	{
+		servo->state = SERVO_LOCKED;
+		servo->haslocked = 1;
+	}
+	else
+	{
+		// Losing lock only changes the reported state, steps stay disabled
+		servo->state = SERVO_UNLOCKED;
+	}
+
+	return servo->state;
+}
+
+/**
+ * \brief Continue after holdover
+ *
+ * Load the integrator with the frequency the clock was steered with, so
+ * that the next sample continues from it. A locked servo stays locked if
+ * the offset is still inside the lock threshold.
+ *
+ * \param servo - Servo
+ * \param frequency - Frequency adjustment in effect in ppb
+ *
+ */
+void servoResume(struct servo* servo, double frequency)
+{
+	servo->drift = clampFrequency(-frequency, servo->maxfrequency);
+	servo->frequency = clampFrequency(frequency, servo->maxfrequency);
+}
+
+/**
+ * \brief Servo state name
+ *
+ * \param state - Servo state
+ *
+ * \return Printable state name
+ *
+ */
+const char* servoStateName(enum servostate state)
+{
+	switch (state)
+	{
+	case SERVO_UNLOCKED:
+		return "UNLOCKED";
+	case SERVO_JUMP:
+		return "JUMP";
+	case SERVO_LOCKED:
+		return "LOCKED";
+	}
+	return "UNKNOWN";
+}
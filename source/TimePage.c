@@ -0,0 +1,201 @@
+/*
+ * TimePage.c
+ *
+ * Time page publisher
+ *
+ * Every PPS edge updates the shared time page read by TimePageReader.h:
+ * the CLOCK_MONOTONIC_RAW time of the edge, the GPS time of the edge, GPS
+ * minus UTC and the ratio of GPS to CLOCK_MONOTONIC_RAW frequency. The
+ * ratio comes from consecutive edges and is averaged over
+ * TIMEPAGE_RATEWEIGHT samples. CLOCK_MONOTONIC_RAW is never adjusted, so
+ * the page stays valid while this or any other program steers the clock.
+ *
+ *  Version:    1.0
+ *  Created on: 17.10.2026
+ *  Author:     Pasi
+ */
+
+/****************************************************************
+ * Includes
+ ****************************************************************/
+#define _GNU_SOURCE // memfd_create()
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "GPSTime.h"
+#include "TimePage.h"
+
+/**
+ * \brief Create and map the time page
+ *
+ * The page is a file, e.g. on /dev/shm, or TIMEPAGE_MEMFD for an anonymous
+ * memfd that readers open through /proc/<pid>/fd/<fd>.
+ *
+ * \param publisher - Publisher
+ * \param path - Page file or TIMEPAGE_MEMFD
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int timePageOpen(struct timepublisher* publisher, const char* path)
+{
+	void* map;
+
+	memset(publisher, 0, sizeof(*publisher));
+	publisher->path = path;
+	if (strcmp(path, TIMEPAGE_MEMFD) == 0)
+	{
+		publisher->fd = memfd_create("ppstime", 0);
+	}
+	else
+	{
+		publisher->fd = open(path, O_RDWR | O_CREAT, 0644);
+	}
+	if (publisher->fd < 0)
+	{
+		perror(path);
+		return EXIT_FAILURE;
+	}
+	if (ftruncate(publisher->fd, TIMEPAGE_SIZE) < 0)
+	{
+		perror("Time page ftruncate failed:");
+		close(publisher->fd);
+		return EXIT_FAILURE;
+	}
+	map = mmap(NULL, TIMEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, publisher->fd, 0);
+	if (map == MAP_FAILED)
+	{
+		perror("Time page mmap failed:");
+		close(publisher->fd);
+		return EXIT_FAILURE;
+	}
+	publisher->page = map;
+
+	// Readers check magic and version before anything else
+	timePageInvalidate(publisher);
+	publisher->page->version = TIMEPAGE_VERSION;
+	__atomic_store_n(&publisher->page->magic, TIMEPAGE_MAGIC, __ATOMIC_RELEASE);
+	if (strcmp(path, TIMEPAGE_MEMFD) == 0)
+	{
+		printf("Time page at /proc/%d/fd/%d\n", (int)getpid(), publisher->fd);
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Begin a page update
+ *
+ * \param page - Page
+ *
+ */
+static inline void timePageBegin(struct timepage* page)
+{
+	__atomic_store_n(&page->sequence, page->sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * \brief End a page update
+ *
+ * \param page - Page
+ *
+ */
+static inline void timePageEnd(struct timepage* page)
+{
+	__atomic_store_n(&page->sequence, page->sequence + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief Publish a PPS edge
+ *
+ * \param publisher - Publisher
+ * \param anchor - CLOCK_MONOTONIC_RAW at the edge
+ * \param utctime - GPS UTC time at the edge
+ * \param utcoffset - UTC minus GPS time in ns, from the time log
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int timePagePublish(struct timepublisher* publisher, const struct timespec* anchor, const struct gpstime* utctime, int64_t utcoffset)
+{
+	struct timepage* page = publisher->page;
+	int64_t raw = anchor->tv_sec * GPSTIME_NS + anchor->tv_nsec;
+	int64_t gps = utctime->ns - utcoffset;
+	int64_t interval = raw - publisher->lastanchor;
+	double ratio;
+
+	if (publisher->lastanchor != 0 && interval > 0 && interval <= TIMEPAGE_MAXGAP)
+	{
+		ratio = (double)(gps - publisher->lastgps - interval) / interval;
+		if (!publisher->rated)
+		{
+			publisher->frequency = ratio;
+			publisher->rated = 1;
+		}
+		else
+		{
+			publisher->frequency += (ratio - publisher->frequency) / TIMEPAGE_RATEWEIGHT;
+		}
+	}
+	else
+	{
+		publisher->frequency = 0.0;
+		publisher->rated = 0;
+	}
+	publisher->lastanchor = raw;
+	publisher->lastgps = gps;
+
+	timePageBegin(page);
+	page->anchor = raw;
+	page->gps = gps;
+	page->leap = -utcoffset;
+	page->frequency = publisher->frequency;
+	page->valid = 1;
+	page->updates++;
+	timePageEnd(page);
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Mark the page invalid
+ *
+ * Readers fail until the next timePagePublish().
+ *
+ * \param publisher - Publisher
+ *
+ */
+void timePageInvalidate(struct timepublisher* publisher)
+{
+	timePageBegin(publisher->page);
+	publisher->page->valid = 0;
+	timePageEnd(publisher->page);
+	publisher->lastanchor = 0;
+}
+
+/**
+ * \brief Invalidate and unmap the time page
+ *
+ * A page file stays in place, readers see it invalid.
+ *
+ * \param publisher - Publisher
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int timePageClose(struct timepublisher* publisher)
+{
+	if (publisher->page == NULL)
+	{
+		return EXIT_SUCCESS;
+	}
+	timePageInvalidate(publisher);
+	munmap(publisher->page, TIMEPAGE_SIZE);
+	publisher->page = NULL;
+	close(publisher->fd);
+	return EXIT_SUCCESS;
+}
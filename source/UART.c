@@ -17,42 +17,85 @@
 #include <string.h>
 #include <unistd.h>
 #include <termios.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include "Capture.h"
+#include "Framer.h"
+#include "Latency.h"
+#include "UART.h"
 #include "tools.h"
 
-// Preserved UART settings
-static struct termios oldcomconfig;
-// File descriptor for UART
-static int ttys1;
+#define RESPONSEMAX 128 // Longest command response line
+
+/**
+ * \brief Deadline after a timeout
+ *
+ * \param timeoutms - Timeout in ms
+ * \param deadline - Return CLOCK_MONOTONIC deadline
+ *
+ */
+static void deadlineAfter(int timeoutms, struct timespec* deadline)
+{
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+	deadline->tv_sec += timeoutms / 1000;
+	deadline->tv_nsec += (timeoutms % 1000) * 1000000L;
+	if (deadline->tv_nsec >= 1000000000L)
+	{
+		deadline->tv_nsec -= 1000000000L;
+		deadline->tv_sec++;
+	}
+}
+
+/**
+ * \brief Time left to a deadline
+ *
+ * \param deadline - CLOCK_MONOTONIC deadline
+ *
+ * \return Remaining time in ms, 0 or less when passed
+ *
+ */
+static int deadlineRemaining(const struct timespec* deadline)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (deadline->tv_sec - now.tv_sec) * 1000 + (deadline->tv_nsec - now.tv_nsec) / 1000000L;
+}
 
 /**
  * \brief Initialize UART communication
  *
- * Initialize UART communication to ttys1 and open it.
- * Global: oldcomconfig - Stored UART settings
- * Global: ttys1 - File descriptor for UART
+ * Initialize UART communication and open it. The device is normally
+ * UART1 /dev/ttyS1, or the pty of the receiver emulator (host/gpssim.c).
  *
+ * \param  uart Return the opened UART
+ * \param  device Serial device, e.g. /dev/ttyS1
  * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
  *
  */
-int uartInit()
+int uartInit(struct uart* uart, const char* device)
 {
 	struct termios comconfig;
 
-    // UART1 P9.24,P9.26 /dev/ttyS1, 9600bps, np, 8, 1, nh, echo off, break on
-    ttys1 = open("/dev/ttyS1",O_RDWR | O_NOCTTY); // Open for reading and writing, not as controlling tty
-    if(ttys1 < 0)
+	uart->device = device;
+	uart->capture = NULL;
+	uart->source = 0;
+    // UART1 P9.24,P9.26 /dev/ttyS1, 9600bps until receiverConfigure(), np, 8, 1, nh, echo off, break on
+    uart->fd = open(device,O_RDWR | O_NOCTTY); // Open for reading and writing, not as controlling tty
+    if(uart->fd < 0)
     {
- 	   perror("/dev/ttyS1 failed to open.");
+ 	   perror(device);
  	   return EXIT_FAILURE;
     }
-    if(tcgetattr(ttys1,&oldcomconfig) < 0)
+    if(tcgetattr(uart->fd,&uart->oldconfig) < 0)
     {
- 	   perror("tcgetattr of /dev/ttyS1 failed:");
+ 	   perror("UART1 tcgetattr failed:");
  	   return EXIT_FAILURE;
     }
-    if(tcgetattr(ttys1,&comconfig) < 0)
+    if(tcgetattr(uart->fd,&comconfig) < 0)
     {
- 	   perror("tcgetattr of /dev/ttyS1 failed:");
+ 	   perror("UART1 tcgetattr failed:");
  	   return EXIT_FAILURE;
     }
 	bzero(&comconfig, sizeof(comconfig)); // clear struct for new port settings
@@ -77,14 +120,14 @@ int uartInit()
     comconfig.c_cflag |= CLOCAL;    // Ignore modem control lines
     comconfig.c_oflag &= ~OPOST;    // Prevent special interpretation of output bytes (e.g. newline chars)
     comconfig.c_oflag &= ~ONLCR;    // Prevent conversion of newline to carriage return/line feed
-    comconfig.c_cc[VTIME] = 5;      // Wait for up to 0.5s, returning as soon as any data is received. Expected delay is 10ms + packet time ~200ms
+    comconfig.c_cc[VTIME] = 0;      // Non-blocking read, poll() waits for the data
     comconfig.c_cc[VMIN] = 0;
-    if(tcsetattr(ttys1,TCSANOW,&comconfig) < 0)
+    if(tcsetattr(uart->fd,TCSANOW,&comconfig) < 0)
     {
  	   perror("tcsetattr failed:");
  	   return EXIT_FAILURE;
     }
-    if(tcflush(ttys1, TCIFLUSH) < 0)
+    if(tcflush(uart->fd, TCIFLUSH) < 0)
     {
  	   perror("tcflush failed:");
  	   return EXIT_FAILURE;
@@ -94,23 +137,22 @@ int uartInit()
 }
 
 /**
- * \brief Closes UART ttys1
+ * \brief Closes UART
  *
  * Restores previous UART settings and closes UART file.
- * Global: oldcomconfig - Stored UART settings
- * Global: ttys1 - File descriptor for UART
  *
+ * \param  uart UART
  * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
  *
  */
-int uartClose()
+int uartClose(struct uart* uart)
 {
-    if(tcsetattr(ttys1,TCSADRAIN,&oldcomconfig) < 0)
+    if(tcsetattr(uart->fd,TCSADRAIN,&uart->oldconfig) < 0)
     {
  	   perror("UART1 tcsetattr failed:");
  	   return EXIT_FAILURE;
     }
-    if(close(ttys1) < 0)
+    if(close(uart->fd) < 0)
     {
  	   perror("UART1 close failed");
  	   return EXIT_FAILURE;
@@ -120,46 +162,263 @@ int uartClose()
 }
 
 /**
- * \brief Send Time Log command
+ * \brief Set UART speed
  *
- * Send Time Log command to ttys1 UART port.
- * Global: ttys1 - File descriptor for UART
+ * Change the local line speed and drop data received at the old speed.
  *
+ * \param  uart UART
+ * \param  baud Line speed in bps, e.g. 115200
  * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
  *
  */
-int uartTimelogCmd()
+int uartSetSpeed(struct uart* uart, int baud)
 {
-	char timelogcmd[] = "LOG COM1 TIMESYNCA ONTIME 1\r";
+	struct termios comconfig;
+	speed_t speed;
+
+	switch (baud)
+	{
+	case 9600: speed = B9600; break;
+	case 19200: speed = B19200; break;
+	case 38400: speed = B38400; break;
+	case 57600: speed = B57600; break;
+	case 115200: speed = B115200; break;
+	case 230400: speed = B230400; break;
+	case 460800: speed = B460800; break;
+	case 921600: speed = B921600; break;
+	default:
+		fprintf(stderr, "Unsupported UART speed %d\r\n", baud);
+		return EXIT_FAILURE;
+	}
 
-	if(write(ttys1, timelogcmd, sizeof(timelogcmd)) < 0)
+    if(tcgetattr(uart->fd,&comconfig) < 0)
+    {
+ 	   perror("UART1 tcgetattr failed:");
+ 	   return EXIT_FAILURE;
+    }
+    if(cfsetspeed(&comconfig,speed) < 0)
+    {
+ 	   perror("cfsetspeed failed:");
+ 	   return EXIT_FAILURE;
+    }
+    if(tcsetattr(uart->fd,TCSADRAIN,&comconfig) < 0) // Let pending output go at the old speed
+    {
+ 	   perror("tcsetattr failed:");
+ 	   return EXIT_FAILURE;
+    }
+    return uartFlush(uart);
+}
+
+/**
+ * \brief Send receiver command and wait for the response
+ *
+ * Send one abbreviated ASCII command terminated with CR LF and wait for
+ * the "<OK" response. Lines that are not responses (logs still running)
+ * are skipped, a "[COM1]" prompt in front of the response is ignored.
+ *
+ * \param  uart UART
+ * \param  command Command without line end, e.g. "UNLOGALL"
+ * \param  timeoutms Time to wait for the response in ms
+ * \return EXIT_SUCCESS on "<OK", EXIT_FAILURE on error response, timeout or failure
+ *
+ */
+int uartCommand(struct uart* uart, const char* command, int timeoutms)
+{
+	struct timespec start, now;
+	struct timespec deadline;
+	struct pollfd pfd;
+	char response[RESPONSEMAX];
+	char* line;
+	char* prompt;
+	char c;
+	ssize_t count;
+	int used = 0;
+	int remaining;
+	int ret;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if(write(uart->fd, command, strlen(command)) < 0 || write(uart->fd, "\r\n", 2) < 0)
     {
  	   perror("UART1 write failed:");
  	   return EXIT_FAILURE;
     }
-    return EXIT_SUCCESS;
+
+	deadlineAfter(timeoutms, &deadline);
+	pfd.fd = uart->fd;
+	pfd.events = POLLIN;
+	while ((remaining = deadlineRemaining(&deadline)) > 0)
+	{
+		ret = poll(&pfd, 1, remaining);
+		if (ret < 0 && errno != EINTR)
+		{
+			perror("UART1 poll failed:");
+			return EXIT_FAILURE;
+		}
+		if (ret <= 0)
+		{
+			continue;
+		}
+		while ((count = read(uart->fd, &c, 1)) == 1)
+		{
+			if (c != '\r' && c != '\n')
+			{
+				if (used < RESPONSEMAX - 1)
+				{
+					response[used++] = c;
+				}
+				continue;
+			}
+			response[used] = '\0';
+			used = 0;
+			// The "[COM1]" prompt after a response has no line end
+			line = response;
+			if (line[0] == '[' && (prompt = strchr(line, ']')) != NULL)
+			{
+				line = prompt + 1;
+			}
+			if (strncmp(line, "<OK", 3) == 0)
+			{
+				clock_gettime(CLOCK_MONOTONIC, &now);
+				latencyAdd(LATENCY_COMMAND, (int64_t)(now.tv_sec - start.tv_sec) * 1000000000LL + (now.tv_nsec - start.tv_nsec));
+				return EXIT_SUCCESS;
+			}
+			if (strncmp(line, "<ERROR", 6) == 0)
+			{
+				fprintf(stderr, "%s: %s\r\n", command, line);
+				return EXIT_FAILURE;
+			}
+		}
+		if (count < 0 && errno != EINTR && errno != EAGAIN)
+		{
+		 	perror("UART1 read failed:");
+		    return EXIT_FAILURE;
+		}
+	}
+	fprintf(stderr, "%s %s: no response\r\n", uart->device, command);
+	return EXIT_FAILURE;
 }
 
 /**
  * \brief Read Time Log
  *
- * Read Time Log to a fixed length buffer. 1ms per character.
- * Estimated size of the log is 150 characters.
- * UART is configured to wait data for 500ms
- * Global: ttys1 - File descriptor for UART
+ * Feed received bytes to the framer until it has a complete time log
+ * frame or the timeout expires. The frame is returned the moment its last
+ * byte arrives, split and merged reads are handled by the framer.
+ * At 9600bps the ~150 character log takes ~160ms after the PPS edge,
+ * at 115200bps ~13ms.
  *
- * \param  logbuffer Buffer for the read data
- * \param  size Size of the buffer
+ * \param  uart UART
+ * \param  framer Framer for the received bytes
+ * \param  frame Return the NUL terminated frame
+ * \param  length Return the frame length
+ * \param  timeoutms Time to wait for the frame in ms
  * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
  *
  */
-int uartTimelogRead(char* logbuffer, int size)
+int uartTimelogRead(struct uart* uart, struct framer* framer, char** frame, size_t* length, int timeoutms)
 {
-	if(read(ttys1, logbuffer, size) > 0)
+	struct timespec deadline;
+	struct pollfd pfd;
+	int remaining;
+	int ret;
+
+	deadlineAfter(timeoutms, &deadline);
+	pfd.fd = uart->fd;
+	pfd.events = POLLIN;
+	while (framerNext(framer, frame, length) == 0)
+	{
+		remaining = deadlineRemaining(&deadline);
+		if (remaining <= 0)
+		{
+			fprintf(stderr, "%s time log timeout\r\n", uart->device);
+			return EXIT_FAILURE;
+		}
+		ret = poll(&pfd, 1, remaining);
+		if (ret < 0 && errno != EINTR)
+		{
+			perror("UART1 poll failed:");
+			return EXIT_FAILURE;
+		}
+		if (ret <= 0)
+		{
+			continue;
+		}
+
+		// Read straight into the framer ring
+		if (uartTimelogFeed(uart, framer) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Feed received bytes to the framer
+ *
+ * One read straight into the framer ring. For the event loop, call when
+ * uartFd() is readable and then take frames with framerNext().
+ *
+ * \param  uart UART
+ * \param  framer Framer for the received bytes
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int uartTimelogFeed(struct uart* uart, struct framer* framer)
+{
+	unsigned char* space;
+	size_t size;
+	ssize_t count;
+
+	space = framerSpace(framer, &size);
+	count = read(uart->fd, space, size);
+	if(count < 0 && errno != EINTR && errno != EAGAIN)
 	{
 	 	perror("UART1 read failed:");
 	    return EXIT_FAILURE;
 	}
+	if(count > 0)
+	{
+		latencyMark(LATENCY_FIRSTBYTE);
+		if(uart->capture != NULL)
+		{
+			captureBytes(uart->capture, uart->source, space, count);
+		}
+		framerCommit(framer, count);
+	}
 	return EXIT_SUCCESS;
 }
 
+/**
+ * \brief UART file descriptor
+ *
+ * For polling in the event loop.
+ *
+ * \param  uart UART
+ * \return File descriptor
+ *
+ */
+int uartFd(const struct uart* uart)
+{
+	return uart->fd;
+}
+
+/**
+ * \brief Flush UART receive buffer
+ *
+ * Discard received but not yet read data.
+ *
+ * \param  uart UART
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ *
+ */
+int uartFlush(struct uart* uart)
+{
+    if(tcflush(uart->fd, TCIFLUSH) < 0)
+    {
+ 	   perror("tcflush failed:");
+ 	   return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
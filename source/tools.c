@@ -16,220 +16,615 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <string.h>
-#include <math.h>
-#include <BBBiolib.h>
 #include <time.h>
 
+#include "Clock.h"
+#include "CRC32.h"
+#include "GPSTime.h"
+#include "PPSEdge.h"
 #include "tools.h"
 
+#define MAXDIGITS 18 // Significant digits that fit int64_t
+#define WEEKMAX 65535 // Highest accepted GPS week, binary headers carry 16 bits
+#define WEEKMS (GPSTIME_WEEKSECONDS * 1000) // ms in a GPS week
+#define BINSYNC1 0xAA // Binary log sync bytes
+#define BINSYNC2 0x44
+#define BINSYNC3 0x12
+#define BINHEADERMIN 28 // Binary header length
+#define BINCRCSIZE 4 // Binary CRC length
+#define BINTIMEID 101 // TIMEB message id
+#define BINTIMELENGTH 44 // TIMEB message length
+#define BINTIMESYNCID 492 // TIMESYNCB message id
+#define BINTIMESYNCLENGTH 12 // TIMESYNCB message length
+#define BINFINE 160 // GPS time status values that are good enough
+#define BINFINEBACKUPSTEERING 170
+#define BINFINESTEERING 180
+
+// Clock status names for messages
+static const char* const clockstatusnames[CLOCKSTATUS_INVALID + 1] =
+{
+	"VALID",
+	"CONVERGING",
+	"ITERATING",
+	"INVALID"
+};
+
 /**
- * \brief Wait PPS rising edge
+ * \brief Parse integer field
  *
- * Wait until PPS is low. Then wait for PPS rising edge.
- * Return 0 when rising edge has been detected.
- * Failure if signal stays low or high for more than 3 seconds
+ * Parse a decimal integer between start and end without strtol.
  *
- * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ * \param start - First character of the field
+ * \param end - One past the last character of the field
+ * \param value - Return the value
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if not an integer
+ *
+ */
+static int parseInteger(const char* start, const char* end, int64_t* value)
+{
+	int negative = 0;
+	int64_t result = 0;
+
+	if (start < end && (*start == '-' || *start == '+'))
+	{
+		negative = (*start == '-');
+		start++;
+	}
+	if (start == end || end - start > MAXDIGITS)
+	{
+		return EXIT_FAILURE;
+	}
+	for (; start < end; start++)
+	{
+		if (*start < '0' || *start > '9')
+		{
+			return EXIT_FAILURE;
+		}
+		result = result * 10 + (*start - '0');
+	}
+	*value = negative ? -result : result;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Parse GPS week field
+ *
+ * \param start - First character of the field
+ * \param end - One past the last character of the field
+ * \param week - Return the week
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if not a week number
+ *
+ */
+static int parseWeek(const char* start, const char* end, int* week)
+{
+	int64_t value;
+
+	if (parseInteger(start, end, &value) == EXIT_FAILURE || value < 0 || value > WEEKMAX)
+	{
+		return EXIT_FAILURE;
+	}
+	*week = (int)value;
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Message name to log id
+ *
+ * \param start - First character of the name
+ * \param end - One past the last character of the name
+ *
+ * \return Log id
+ *
+ */
+static enum timelogid timelogId(const char* start, const char* end)
+{
+	size_t length = end - start;
+
+	if (length == 5 && memcmp(start, "TIMEA", 5) == 0)
+	{
+		return TIMELOG_TIMEA;
+	}
+	if (length == 9 && memcmp(start, "TIMESYNCA", 9) == 0)
+	{
+		return TIMELOG_TIMESYNCA;
+	}
+	return TIMELOG_UNKNOWN;
+}
+
+/**
+ * \brief Clock status name to clock status
+ *
+ * TIMEA reports the clock model status (VALID, CONVERGING, ...).
+ * TIMESYNCA reports the GPS time status (FINESTEERING, ...). Only the fine
+ * time states are good enough to set the clock.
+ *
+ * \param start - First character of the name
+ * \param end - One past the last character of the name
+ *
+ * \return Clock status
+ *
+ */
+static enum clockstatus timelogClockStatus(const char* start, const char* end)
+{
+	size_t length = end - start;
+
+	if ((length == 5 && memcmp(start, "VALID", 5) == 0) ||
+		(length == 12 && memcmp(start, "FINESTEERING", 12) == 0) ||
+		(length == 4 && memcmp(start, "FINE", 4) == 0) ||
+		(length == 18 && memcmp(start, "FINEBACKUPSTEERING", 18) == 0))
+	{
+		return CLOCKSTATUS_VALID;
+	}
+	if (length == 10 && memcmp(start, "CONVERGING", 10) == 0)
+	{
+		return CLOCKSTATUS_CONVERGING;
+	}
+	if (length == 9 && memcmp(start, "ITERATING", 9) == 0)
+	{
+		return CLOCKSTATUS_ITERATING;
+	}
+	return CLOCKSTATUS_INVALID;
+}
+
+/**
+ * \brief Store one time log field
+ *
+ * \param log - Record being filled
+ * \param header - 1 for header fields, 0 for data fields
+ * \param index - Field index within the header or data
+ * \param start - First character of the field
+ * \param end - One past the last character of the field
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on a bad field
  *
  */
-int waitPPSHigh()
+static int timelogField(struct timelog* log, int header, int index, const char* start, const char* end)
 {
-	#define PPSTIMEOUT (3000000/SLEEPTIMER) // 3 second timeout
-	#define SLEEPTIMER 1000 // Sleep delay in microseconds. 1ms delay = 1ms error
+	int64_t value;
+
+	if (header)
+	{
+		switch (index)
+		{
+		case 0: // Message name
+			log->id = timelogId(start, end);
+			return log->id == TIMELOG_UNKNOWN ? EXIT_FAILURE : EXIT_SUCCESS;
+		case 5: // Reference week
+			return parseWeek(start, end, &log->week);
+		case 6: // Reference seconds
+			return gpsTimeParseDecimal(start, end, &log->seconds);
+		default:
+			return EXIT_SUCCESS;
+		}
+	}
+
+	if (log->id == TIMELOG_TIMESYNCA)
+	{
+		switch (index)
+		{
+		case 0: // Week
+			return parseWeek(start, end, &log->week);
+		case 1: // Milliseconds of week
+			if (parseInteger(start, end, &value) == EXIT_FAILURE || value < 0 || value >= WEEKMS)
+			{
+				return EXIT_FAILURE;
+			}
+			log->seconds = value * 1000000LL;
+			return EXIT_SUCCESS;
+		case 2: // Time status
+			log->clock = timelogClockStatus(start, end);
+			log->complete = 1;
+			return EXIT_SUCCESS;
+		default:
+			return EXIT_SUCCESS;
+		}
+	}
 
+	switch (index)
+	{
+	case 0: // Clock model status
+		log->clock = timelogClockStatus(start, end);
+		return EXIT_SUCCESS;
+	case 1: // Receiver clock offset
+		return gpsTimeParseDecimal(start, end, &log->offset);
+	case 3: // UTC offset
+		if (gpsTimeParseDecimal(start, end, &log->utcoffset) == EXIT_FAILURE)
+		{
+			return EXIT_FAILURE;
+		}
+		log->hasutc = 1;
+		log->complete = 1;
+		return EXIT_SUCCESS;
+	default:
+		return EXIT_SUCCESS;
+	}
+}
+
+/**
+ * \brief Parse time log frame
+ *
+ * Check the CRC and split the fields in one pass over the frame without
+ * copying or modifying it. Numbers are parsed straight to integers and
+ * nanoseconds. Understands TIMEA and TIMESYNCA. Binary frames are passed
+ * to parseTimelogBinary().
+ *
+ * Example time log string:
+ * #TIMEA,USB1,0,50.5,FINESTEERING,2209,515163.000,02000020,9924,16809;VALID,-2.501488425e-09,6.133312031e-10,-17.99999999630,2022,5,13,23,5,45000,VALID*1100ad64
+ * reference week = 2209
+ * reference seconds = 515163.000
+ * Clock status = VALID
+ * offset = -2.501488425e-09
+ * UTC offset = -17.99999999630
+ *
+ * \param frame - Frame from '#' to '\r', or a binary frame
+ * \param length - Frame length
+ * \param log - Return the time log record
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if malformed, oversized or CRC fails
+ *
+ */
+int parseTimelogFrame(const char* frame, size_t length, struct timelog* log)
+{
+	const char* end = frame + length;
+	const char* field;
+	const char* p;
+	uint32_t crccalc = 0;
+	unsigned long crcref = 0;
+	int header = 1;
+	int index = 0;
+	int digit;
 	int i;
 
-	// wait until PPS is low
-	i=0;
-	while (is_high(9, 23))
+	if (length > 0 && (unsigned char)frame[0] == BINSYNC1)
+	{
+		return parseTimelogBinary((const unsigned char*)frame, length, log);
+	}
+
+	memset(log, 0, sizeof(*log));
+	log->id = TIMELOG_UNKNOWN;
+	log->clock = CLOCKSTATUS_INVALID;
+
+	if (length > TIMELOGMAX || length < 2 || frame[0] != '#')
 	{
-		// Timeout check
-		if(i > PPSTIMEOUT)
+		fprintf(stderr, "Time log malformed\r\n");
+		return EXIT_FAILURE;
+	}
+
+	// CRC and fields in one pass up to '*'
+	field = frame + 1;
+	for (p = frame + 1; p < end && *p != '*'; p++)
+	{
+		crccalc = crc32Byte(crccalc, (unsigned char)*p);
+		if (*p == ',' || *p == ';')
 		{
-	 	    perror("PPS signal stuck high.");
+			if (timelogField(log, header, index, field, p) == EXIT_FAILURE)
+			{
+				fprintf(stderr, "Time log field %d malformed\r\n", index);
+				return EXIT_FAILURE;
+			}
+			index++;
+			if (*p == ';')
+			{
+				if (!header)
+				{
+					break;
+				}
+				header = 0;
+				index = 0;
+			}
+			field = p + 1;
+		}
+	}
+	if (p == end || *p != '*' || header)
+	{
+		fprintf(stderr, "Time log malformed\r\n");
+		return EXIT_FAILURE;
+	}
+	if (timelogField(log, header, index, field, p) == EXIT_FAILURE)
+	{
+		fprintf(stderr, "Time log field %d malformed\r\n", index);
+		return EXIT_FAILURE;
+	}
+
+	// Reference CRC, 8 hex digits after '*'
+	p++;
+	for (i = 0; i < 8; i++, p++)
+	{
+		digit = (p < end) ? *p : -1;
+		if (digit >= '0' && digit <= '9')
+		{
+			digit -= '0';
+		}
+		else if ((digit | 0x20) >= 'a' && (digit | 0x20) <= 'f')
+		{
+			digit = (digit | 0x20) - 'a' + 10;
+		}
+		else
+		{
+			fprintf(stderr, "Time log CRC malformed\r\n");
 			return EXIT_FAILURE;
 		}
-		i++;
-		usleep(SLEEPTIMER); // Don't hang
+		crcref = (crcref << 4) | digit;
 	}
+	if (crcref != crccalc)
+	{
+		printf("CRC32 fail. Reference : 0x%.8X, Calculated : 0x%.8X \r\n", (unsigned int)crcref, (unsigned int)crccalc);
+		return EXIT_FAILURE;
+	}
+	if (!log->complete)
+	{
+		fprintf(stderr, "Time log too short\r\n");
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief Little endian 16 bit field
+ *
+ * \param p - Field
+ *
+ * \return Value
+ *
+ */
+static uint16_t getLE16(const unsigned char* p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
 
-	// Wait for a rising edge on PPS signal
-	i=0;
-	while (is_low(9, 23))
+/**
+ * \brief Little endian 32 bit field
+ *
+ * \param p - Field
+ *
+ * \return Value
+ *
+ */
+static uint32_t getLE32(const unsigned char* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * \brief Little endian double field in nanoseconds
+ *
+ * \param p - Field, IEEE 754 double in seconds
+ *
+ * \return Value in ns, rounded
+ *
+ */
+static int64_t getLEDoubleNs(const unsigned char* p)
+{
+	uint64_t bits = (uint64_t)getLE32(p) | ((uint64_t)getLE32(p + 4) << 32);
+	double value;
+
+	memcpy(&value, &bits, sizeof(value));
+	value *= GPSTIME_NS;
+	return (int64_t)(value < 0 ? value - 0.5 : value + 0.5);
+}
+
+/**
+ * \brief Binary time status to clock status
+ *
+ * \param status - GPS time status from the header or TIMESYNCB
+ *
+ * \return Clock status
+ *
+ */
+static enum clockstatus binaryTimeStatus(uint32_t status)
+{
+	switch (status)
 	{
-		// Timeout check
-		if(i > PPSTIMEOUT)
+	case BINFINE:
+	case BINFINEBACKUPSTEERING:
+	case BINFINESTEERING:
+		return CLOCKSTATUS_VALID;
+	default:
+		return CLOCKSTATUS_INVALID;
+	}
+}
+
+/**
+ * \brief Parse binary time log frame
+ *
+ * Decode a TIMEB or TIMESYNCB frame from the little endian structures.
+ * The header is at least 28 bytes:
+ * sync(3) header length(1) message id(2) message type(1) port(1)
+ * message length(2) sequence(2) idle(1) time status(1) week(2) ms(4) ...
+ * TIMEB message: clock status(4) offset(8) offset std(8) UTC offset(8) ...
+ * TIMESYNCB message: week(4) ms(4) time status(4)
+ * The CRC (4) follows the message and covers the header and the message.
+ *
+ * \param frame - Frame from the first sync byte to the end of the CRC
+ * \param length - Frame length
+ * \param log - Return the time log record
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if malformed, oversized or CRC fails
+ *
+ */
+int parseTimelogBinary(const unsigned char* frame, size_t length, struct timelog* log)
+{
+	const unsigned char* message;
+	unsigned int headerlength;
+	unsigned int messagelength;
+	uint32_t clockstatus;
+
+	memset(log, 0, sizeof(*log));
+	log->id = TIMELOG_UNKNOWN;
+	log->clock = CLOCKSTATUS_INVALID;
+
+	if (length > TIMELOGMAX || length < BINHEADERMIN + BINCRCSIZE ||
+		frame[0] != BINSYNC1 || frame[1] != BINSYNC2 || frame[2] != BINSYNC3)
+	{
+		fprintf(stderr, "Binary time log malformed\r\n");
+		return EXIT_FAILURE;
+	}
+	headerlength = frame[3];
+	messagelength = getLE16(frame + 8);
+	if (headerlength < BINHEADERMIN || headerlength + messagelength + BINCRCSIZE != length)
+	{
+		fprintf(stderr, "Binary time log length mismatch\r\n");
+		return EXIT_FAILURE;
+	}
+	if (getLE32(frame + length - BINCRCSIZE) != crc32Update(0, frame, length - BINCRCSIZE))
+	{
+		printf("CRC32 fail. Reference : 0x%.8X, Calculated : 0x%.8X \r\n",
+			(unsigned int)getLE32(frame + length - BINCRCSIZE),
+			(unsigned int)crc32Update(0, frame, length - BINCRCSIZE));
+		return EXIT_FAILURE;
+	}
+
+	message = frame + headerlength;
+	log->week = getLE16(frame + 14);
+	log->seconds = (int64_t)getLE32(frame + 16) * 1000000L; // ms of week
+
+	switch (getLE16(frame + 4))
+	{
+	case BINTIMEID:
+		if (messagelength < BINTIMELENGTH)
+		{
+			break;
+		}
+		log->id = TIMELOG_TIMEB;
+		clockstatus = getLE32(message);
+		log->clock = (clockstatus <= CLOCKSTATUS_INVALID) ? (enum clockstatus)clockstatus : CLOCKSTATUS_INVALID;
+		log->offset = getLEDoubleNs(message + 4);
+		log->utcoffset = getLEDoubleNs(message + 20);
+		log->hasutc = 1;
+		log->complete = 1;
+		break;
+	case BINTIMESYNCID:
+		if (messagelength < BINTIMESYNCLENGTH)
+		{
+			break;
+		}
+		if (getLE32(message) > WEEKMAX)
 		{
-	 	    perror("PPS signal stuck low.");
+			fprintf(stderr, "Binary time log week out of range\r\n");
 			return EXIT_FAILURE;
 		}
-		i++;
-		usleep(SLEEPTIMER); // Don't hang
+		log->id = TIMELOG_TIMESYNCB;
+		log->week = (int)getLE32(message);
+		log->seconds = (int64_t)getLE32(message + 4) * 1000000L;
+		log->clock = binaryTimeStatus(getLE32(message + 8));
+		log->complete = 1;
+		break;
+	default:
+		break;
+	}
+	if (!log->complete)
+	{
+		fprintf(stderr, "Unknown binary log %u\r\n", (unsigned int)getLE16(frame + 4));
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+/**
+ * \brief UTC time from time log without status check
+ *
+ * Calculate UTC time counted from the GPS epoch whatever the clock status.
+ * GPS time = receiver time - offset, UTC = GPS time + UTC offset.
+ * TIMESYNCA has no UTC offset, GPSUTCLEAPSECONDS is used instead.
+ *
+ * \param log - Parsed time log
+ * \param oututctime - Return calculated UTC time
+ *
+ */
+void timelogTime(const struct timelog* log, struct gpstime* oututctime)
+{
+	// Seconds of week may go below 0 or past the week, the sum is still exact
+	gpsTimeFromWeek(log->week, log->seconds, oututctime);
+	gpsTimeAdd(oututctime, -log->offset);
+	gpsTimeAdd(oututctime, log->hasutc ? log->utcoffset : -(int64_t)GPSUTCLEAPSECONDS * GPSTIME_NS);
+}
+
+/**
+ * \brief UTC time from time log
+ *
+ * Check clock status and calculate UTC time counted from the GPS epoch.
+ *
+ * \param log - Parsed time log
+ * \param oututctime - Return calculated UTC time
+ *
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE if the clock is not valid
+ *
+ */
+int timelogUtcTime(const struct timelog* log, struct gpstime* oututctime)
+{
+	if (log->clock != CLOCKSTATUS_VALID)
+	{
+		fprintf(stderr, "Clock not ready: %s\r\n", clockstatusnames[log->clock]);
+		return EXIT_FAILURE;
 	}
 
-    return EXIT_SUCCESS;
+	timelogTime(log, oututctime);
+	return EXIT_SUCCESS;
 }
 
 /**
  * \brief Parse time log
  *
- * Parse and check time log and return UTC GPS seconds
+ * Parse and check a NUL terminated time log and return UTC time.
  * Check CRC and clock status.
- * Retrieve following information from time log.
- * - GPS reference weeks
- * - GPS reference seconds
- * - clock status
- * - offset
- * - UTC offset
- * Calculate offsets and UTC time. Convert UTC GPS time to seconds.
+ *
+ * Time logs for testing
+ * Good reference
+ * "#TIMEA,USB1,0,50.5,FINESTEERING,2209,515163.000,02000020,9924,16809;VALID,-2.501488425e-09,6.133312031e-10,-17.99999999630,2022,5,13,23,5,45000,VALID*1100ad64\r"
+ * Failed ID, seconds go negative
+ * "#TIMEB,USB1,0,50.5,FINESTEERING,2209,1000.000,02000020,9924,16809;VALID,-2.501488425e-09,6.133312031e-10,2000.9999,2022,5,13,23,5,45000,VALID*1100ad64\r"
+ * Clock not valid, seconds roll over
+ * "#TIMEA,USB1,0,50.5,FINESTEERING,2209,515163.000,02000020,9924,16809;CONVERGING,-2.501488425e-09,6.133312031e-10,-17.99999999630,2022,5,13,23,5,45000,VALID*1100ad64\r"
  *
  * \param logbuffer - Time log string to be parsed
- * \param oututcseconds - Return calculated UTC time in seconds
+ * \param oututctime - Return calculated UTC time
  *
  * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
  *
  */
-#define SECONDSINWEEK 604800L
-int parseTimelog(char* logbuffer, long double* oututcseconds)
+int parseTimelog(char* logbuffer, struct gpstime* oututctime)
 {
-	enum returnstate { FAIL, SUCCESS };
-	enum returnstate returnval = SUCCESS;
-	unsigned char ucbuffer[200];
-	unsigned long crcref;
-	unsigned long crccalc;
-	int crclength;
-	const char* clockstatus;
-	int refweeks;
-	int utcweeks;
-	long double refseconds;
-	long double offset;
-	long double utcoffset;
-	long double utcseconds;
-	const char* stringtoken;
-	char* parsestring;
-	const char clockstatusok[] = "VALID"; // Clock data is valid
-
-	/* Example time log string:
-	 * #TIMEA,USB1,0,50.5,FINESTEERING,2209,515163.000,02000020,9924,16809;VALID,-2.501488425e-09,6.133312031e-10,-17.99999999630,2022,5,13,23,5,45000,VALID*1100ad64
-	 * reference week = 2209
-	 * reference seconds = 515163.000
-	 * Clock status = VALID
-	 * offset = -2.501488425e-09
-	 * UTC offset = -17.99999999630
-	 *
-	 */
-
-	// Time logs for testing
-	// Good reference
-	//char testlog1[] = "#TIMEA,USB1,0,50.5,FINESTEERING,2209,515163.000,02000020,9924,16809;VALID,-2.501488425e-09,6.133312031e-10,-17.99999999630,2022,5,13,23,5,45000,VALID*1100ad64\r";
-	// Failed ID, seconds go negative
-	//char testlog2[] = "#TIMEB,USB1,0,50.5,FINESTEERING,2209,1000.000,02000020,9924,16809;VALID,-2.501488425e-09,6.133312031e-10,2000.9999,2022,5,13,23,5,45000,VALID*1100ad64\r";
-	// Clock not valid, seconds roll over
-	//char testlog3[] = "#TIMEA,USB1,0,50.5,FINESTEERING,2209,515163.000,02000020,9924,16809;CONVERGING,-2.501488425e-09,6.133312031e-10,-17.99999999630,2022,5,13,23,5,45000,VALID*1100ad64\r";
-
-	parsestring = logbuffer; // For testing
-
-	// Retrieve reference CRC and calculate CRC32 from our data
-	stringtoken = strtok(parsestring, "*");
-	crclength = strlen(stringtoken) - 1;
-	memcpy(ucbuffer, parsestring+1, crclength); // Skip # character in the beginning
-	stringtoken = strtok(NULL, "\r");
-	crcref = strtol(stringtoken, NULL, 16);
-	crccalc = calculateBlockCRC32(crclength, ucbuffer);
-
-	// Skip unused fields
-	strtok(parsestring, ","); // Skip #TIMEA
-	strtok(NULL, ","); // Skip USB1
-	strtok(NULL, ","); // Skip 0
-	strtok(NULL, ","); // Skip 50.5
-	strtok(NULL, ","); // Skip FINESTEERING
-	stringtoken = strtok(NULL, ","); // Reference weeks (example 2209)
-	refweeks = strtol(stringtoken, NULL, 10);
-	stringtoken = strtok(NULL, ","); // Reference seconds (515163.000)
-	refseconds = strtold(stringtoken, NULL);
-	// Skip the rest of the log header
-	strtok(NULL, ";");
-	clockstatus = strtok(NULL, ","); // Clock valid or not valid
-	stringtoken = strtok(NULL, ","); // Offset
-	offset = strtold(stringtoken, NULL);
-	strtok(NULL, ","); // skip
-	stringtoken = strtok(NULL, ","); // UTC offset
-	utcoffset = strtold(stringtoken, NULL);
-
-	// Calculate offsets
-	utcweeks = refweeks;
-	utcseconds = refseconds - offset - utcoffset;
-	if (refseconds >= 0 && utcseconds < 0) // Check if we went to negative
-	{
-		utcweeks--;
-	} // impossible to roll over with long double
-
-	// Add weeks to seconds
-	utcseconds = utcseconds + (long double)utcweeks * SECONDSINWEEK;
-	*oututcseconds = utcseconds;
-
-	/* For debugging
-	printf("Clock status: %s \r\n", clockstatus);
-	printf("Ref weeks: %i \r\n", refweeks);
-	printf("Ref seconds: %f \r\n", refseconds);
-	printf("Offset: %f \r\n", offset);
-	printf("UTC offset: %f \r\n", utcoffset);
-	printf("UTC seconds: %f \r\n", utcseconds);
-	printf("UTC weeks: %i \r\n", utcweeks);
-	//*/
-
-	// Check CRC, ID and clock state
-	if (crcref != crccalc)
-	{
-		printf("CRC32 fail. Reference : 0x%.8X, Calculated : 0x%.8X \r\n", (unsigned int)crcref, (unsigned int)crccalc);
-		returnval = FAIL;
-	}
-	if (strcmp(clockstatus, clockstatusok))
+	struct timelog log;
+	const char* end;
+
+	end = memchr(logbuffer, '\r', strnlen(logbuffer, TIMELOGMAX + 1));
+	if (end == NULL)
 	{
-		printf("Clock not ready: %s \r\n", clockstatus);
-		returnval = FAIL;
+		fprintf(stderr, "Time log malformed\r\n");
+		return EXIT_FAILURE;
 	}
-
-	if (returnval == FAIL)
+	if (parseTimelogFrame(logbuffer, end - logbuffer, &log) == EXIT_FAILURE)
 	{
 		fprintf(stderr, "Time log data not valid\r\n");
 		return EXIT_FAILURE;
 	}
-	return EXIT_SUCCESS;
+	return timelogUtcTime(&log, oututctime);
 }
 
 /**
  * \brief CRC value calculation
  *
  * Calculate a CRC value to be used by CRC calculation functions.
+ * The value comes from the compile time table in CRC32.c.
  *
  * \param CRC input value
  *
  * \return CRC value
  *
  */
-#define CRC32_POLYNOMIAL 0xEDB88320L
 unsigned long CRC32Value(int i)
 {
-	int j;
-	unsigned long ulCRC;
-	ulCRC = i;
-
-	for (j = 8; j > 0; j--) {
-
-		if (ulCRC & 1)
-
-			ulCRC = (ulCRC >> 1) ^ CRC32_POLYNOMIAL;
-		else
-			ulCRC >>= 1;
-	}
-	return ulCRC;
+	return crc32Table[i & 0xFF];
 }
 
 /**
  * \brief Calculates the CRC-32 of a block of data
  *
  * Calculates the CRC-32 of a block of data all at once
+ * with the CRC engine selected by crc32Init().
  *
  * \param ulCount - Number of bytes in the data block
  * \param ucBuffer - Data block
@@ -239,66 +634,40 @@ unsigned long CRC32Value(int i)
  */
 unsigned long calculateBlockCRC32(unsigned long ulCount, unsigned char* ucBuffer)
 {
-	unsigned long ulCRC = 0;
-
-	while (ulCount-- != 0) {
-		unsigned long ulTemp1;
-		unsigned long ulTemp2;
-		ulTemp1 = (ulCRC >> 8) & 0x00FFFFFFL;
-		ulTemp2 = CRC32Value(((int)ulCRC ^ *ucBuffer++) & 0xFF);
-		ulCRC = ulTemp1 ^ ulTemp2;
-	}
-
-	return(ulCRC);
+	return crc32Update(0, ucBuffer, ulCount);
 }
 
 /**
- * \brief Calculate UTC time and set system time
+ * \brief Calculate system clock offset
+ *
+ * Compare UTC time from the receiver to the system time (CLOCK_REALTIME)
+ * at the PPS rising edge. Edges time stamped with another clock are
+ * converted to CLOCK_REALTIME first. The comparison is done in integer
+ * ns since the GPS epoch.
+ * The system time is not changed here, see the servo in PPSTime.c.
  *
- * Convert GPS epoch to Unix epoch, calculate difference between
- * PPS rising edge and now. Set system time.
+ * \param utctime - UTC time from the receiver (GPS epoch)
+ * \param edge - PPS rising edge time stamp
+ * \param offset - Return system time minus GPS time at the edge in ns
  *
- * \param utcseconds - GPS seconds from modem with offsets (GPS epoch)
- * \param ppstime - Time stamp from PPS rising edge
+ * \return EXIT_SUCCESS on success, EXIT_FAILURE on failure
  *
  */
-#define NS_PER_SECOND 1000000000L // Used for time calculations. ns per second
-#define UNIXGPSTICKS 315964800L // Ticks between Unix epoch and GPS epoch
-void gpsSectoSystemTime(long double utcseconds, struct timespec ppstime)
+int gpsSectoSystemTime(const struct gpstime* utctime, const struct ppsedge* edge, int64_t* offset)
 {
-	struct timespec currtime, delta, gpstime;
-	double frag;
-	double integr;
-
-	clock_gettime(CLOCK_MONOTONIC, &currtime);	// mark the end time
-	delta.tv_nsec = currtime.tv_nsec - ppstime.tv_nsec;
-	delta.tv_sec  = currtime.tv_sec - ppstime.tv_sec;
-    if (delta.tv_sec > 0 && delta.tv_nsec < 0)
-    {
-    	delta.tv_nsec += NS_PER_SECOND;
-    	delta.tv_sec--;
-    }
-    else if (delta.tv_sec < 0 && delta.tv_nsec > 0)
-    {
-    	delta.tv_nsec -= NS_PER_SECOND;
-    	delta.tv_sec++;
-    }
-
-	// Convert to Unix seconds
-    // GPS utcseconds starts from 00:00 6th January, 1980 UTC
-    // Unix settime starts from 00:00 1st January, 1970 UTC
-    utcseconds += UNIXGPSTICKS;
-
-    // utcseconds to seconds and nanoseconds
-	frag = modf(utcseconds, &integr);
-	gpstime.tv_sec = (long)integr;
-	gpstime.tv_nsec = (long)(frag * NS_PER_SECOND);
-
-    // Add ppstime delta to utcseconds
-	gpstime.tv_sec += delta.tv_sec;
-	gpstime.tv_nsec += delta.tv_nsec;
-
-    // Update system time
-	clock_settime(CLOCK_MONOTONIC, &gpstime);	// Update system time
+	struct timespec systime;
+	struct gpstime sysgps;
 
+	// System time at the PPS rising edge
+	if (clockRealtimeAt(&edge->stamp, edge->clock, &systime) == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
+
+	// Unix time starts from 00:00 1st January, 1970 UTC
+	// GPS time starts from 00:00 6th January, 1980 UTC
+	gpsTimeFromTimespec(&systime, &sysgps);
+	*offset = gpsTimeDiff(&sysgps, utctime);
+
+	return EXIT_SUCCESS;
 }